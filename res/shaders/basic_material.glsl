@@ -4,8 +4,15 @@ struct Material
 	vec3 Specular;
 	vec3 Diffuse;
 	float Shininess;
+};
 
-	sampler2D AlbedoMap;
+// Written when the material changes (SceneMaterialData). Binding must match SCENE_MATERIAL_DATA_BINDING
+layout (std140, binding = 2) uniform MaterialData
+{
+	Material uMaterial;
 };
 
+// Samplers can not live in a uniform block
+uniform sampler2D uAlbedoMap;
+
 
@@ -1,34 +1,39 @@
-#version 330 core
+#version 430 core
+#include "res/shaders/frame_data.glsl"
 #include "res/shaders/basic_material.glsl"
 #include "res/shaders/lights.glsl"
+#include "res/shaders/ocean_waves.glsl"
 out vec4 FragColor;
 
 in vec3 vPos;
 in vec3 vFragPos;
 in vec3 vLocalPos;
-in vec2 vTexCoord;
+in vec2 vRestPos;
+in vec3 vTangentX;
+in vec3 vTangentZ;
+in float vVertexFootprint;
+flat in int vFirstPartialOctave;
 
-uniform Material uMaterial;
-
-uniform vec3 uViewPosition;
-
-
-uniform int uWaveCount;
-uniform vec2 uWaveDirection;
-uniform float uSpeed;
-uniform float uTime;
-uniform float uSteepness;
-
-uniform float uFrequency;
 uniform float uAmplitude;
-uniform float uPersistance;
-uniform float uLacunarity;
-uniform float uInitialSeed;
-uniform float uSeedIter;
-uniform float uSpeedRamp;
+
+#ifndef OCEAN_SIMULATION_TYPE
+uniform int uSimulationType;
+#define OCEAN_SIMULATION_TYPE uSimulationType
+#endif
+uniform sampler2DArray uSlopeMap;
+uniform int uCascadeCount;
+uniform float uCascadeTileSize[3];
 
 uniform samplerCube uSkybox;
 
+// Octave loop statistics, read by ocean_octave_split_benchmark. Binding must match OCEAN_OCTAVE_STATS_BINDING
+uniform int uCollectOctaveStats;
+layout(std430, binding = 1) buffer OceanOctaveStats
+{
+    uint uStatFragments;
+    uint uStatOctaveIterations;
+};
+
 float uWavePeakScatterStrength = 0.7;
 float uScatterStrength = 0.5;
 float uScatterShadowStrength = 0.9;
@@ -51,6 +56,16 @@ uniform vec3 uSeaColorSurface;
 
 uniform float uFogDistance;
 
+// Foam and fog switches
+#ifndef OCEAN_FOAM
+uniform int uFoam;
+#define OCEAN_FOAM uFoam
+#endif
+#ifndef OCEAN_FOG
+uniform int uFog;
+#define OCEAN_FOG uFog
+#endif
+
 vec3 water_lighting_simple(vec3 N, vec3 V, vec3 L, vec3 sunColor)
 {
     
@@ -74,50 +89,81 @@ vec3 water_lighting_simple(vec3 N, vec3 V, vec3 L, vec3 sunColor)
 }
 
 
-vec3 compute_normal_of_wave(vec3 pos)
+// First octave the vertex stage did not apply in full at this pixel. vFirstPartialOctave comes from the
+// provoking vertex only, the other vertices of the triangle may have a coarser footprint
+int get_first_partial_octave(int geometricOctaves)
 {
-    vec3 N = vec3(0.0);
-    vec2 P = pos.xz;
+    int first = min(vFirstPartialOctave, geometricOctaves);
+    float fullK = 6.28318530718 / (OCEAN_LOD_FADE_START * vVertexFootprint);
+    while(OCEAN_OCTAVE_LOD != 0 && first > 0 && uWaves[first - 1].K > fullK)
+    {
+        first--;
+    }
+    return first;
+}
 
-    float a = uAmplitude;
-    float w = uFrequency;
-    float s = uSpeed;
-    float seed = uInitialSeed;
+vec3 compute_normal_of_wave(vec2 restPos, float viewDistance)
+{
+    // Tangents of the displaced surface along the rest position axes, same as ocean_evaluate_normals
+    vec3 tangentX = vec3(1.0, 0.0, 0.0);
+    vec3 tangentZ = vec3(0.0, 0.0, 1.0);
+    int firstOctave = 0;
+    int endOctave = OCEAN_WAVE_COUNT;
+    int geometricOctaves = 0;
+    float detailFade = 1.0;
+
+    if(OCEAN_OCTAVE_SPLIT != 0)
+    {
+        // The geometric octaves come interpolated from the vertex stage. Those it faded or skipped on its
+        // coarser footprint get their remaining weight here. Detail octaves fade out with the foam
+        tangentX = vTangentX;
+        tangentZ = vTangentZ;
+        geometricOctaves = get_geometric_octave_count();
+        firstOctave = get_first_partial_octave(geometricOctaves);
+        detailFade = 1.0 - smoothstep(0.8 * uFoamDistanceFade, uFoamDistanceFade, viewDistance);
+        if(detailFade <= 0.0)
+        {
+            endOctave = geometricOctaves;
+        }
+    }
 
-    float sumX = 0.0;
-    float sumY = 0.0;
-    float sumZ = 0.0;
+    // Size of this pixel on the rest plane
+    float footprint = max(length(dFdx(restPos)), length(dFdy(restPos)));
 
-    for(int i = 0; i < uWaveCount; ++i)
+    int iterations = 0;
+    for(int i = firstOctave; i < endOctave; ++i)
     {
-        float Q = uSteepness / (w * a * float(uWaveCount));
-        vec2 d = normalize(vec2(cos(seed), sin(seed)));
-        float k = w;
-        float A = a;
-
-        float phi = k * dot(d, P) + s * uTime;
-        float C = cos(phi);
-        float S = sin(phi);
-
-        // Gerstner normal derivatives
-        sumX += d.x * Q * A * k * C;
-        sumY += A * k * S;
-        sumZ += d.y * Q * A * k * C;
-
-        // fractal wave update
-        w *= uLacunarity;
-        a *= uPersistance;
-        s *= uSpeedRamp;
-        seed += uSeedIter;
+        Wave wave = uWaves[i];
+        float weight = get_octave_lod_weight(wave.K, footprint);
+        if(weight <= 0.0)
+        {
+            break;
+        }
+        weight *= i < geometricOctaves ? 1.0 - get_octave_lod_weight(wave.K, vVertexFootprint) : detailFade;
+
+        float phi = wave.K * dot(wave.Direction, restPos) + uTime * wave.Speed;
+        add_wave_tangents(wave, weight, sin(phi), cos(phi), tangentX, tangentZ);
+        iterations++;
     }
 
-    vec3 normal = normalize(vec3(
-        -sumX,
-        1 - sumY,
-        -sumZ
-    ));
+    if(uCollectOctaveStats != 0)
+    {
+        atomicAdd(uStatFragments, 1u);
+        atomicAdd(uStatOctaveIterations, uint(iterations));
+    }
 
-    return normal;
+    return normalize(cross(tangentZ, tangentX));
+}
+
+vec3 compute_normal_of_fft(vec2 restPos)
+{
+    // Mipmapped, distant pixels get the filtered slope of the small cascades
+    vec2 slope = vec2(0.0);
+    for(int i = 0; i < uCascadeCount; ++i)
+    {
+        slope += texture(uSlopeMap, vec3(restPos / uCascadeTileSize[i], float(i))).xy;
+    }
+    return normalize(vec3(-slope.x, 1.0, -slope.y));
 }
 
 float dot_clamped(vec3 a, vec3 b)
@@ -163,51 +209,59 @@ void main()
     vec3 waterHitPos = vLocalPos;
 
     float totalWaveHeight = vLocalPos.y;
-    vec3 normal = normalize(compute_normal_of_wave(vLocalPos));
+    float viewDistance = length(uViewPosition - vFragPos);
+    vec3 normal = OCEAN_SIMULATION_TYPE == 1 ? compute_normal_of_fft(vRestPos) : compute_normal_of_wave(vRestPos, viewDistance);
     vec3 viewDir = normalize(uViewPosition - vFragPos);  // or from camera pos
     vec3 lightDir = normalize(-uDirectionalLight.Direction);
 
     vec3 baseWater = water_lighting_simple(normal, viewDir, lightDir, uDirectionalLight.DiffuseColor);
     //vec3 scatter   = 
 
+    vec3 color = baseWater;// + scatter;
+
     // ======================
     // FOAM / WHITECAPS
     // ======================
-    // 1. Steepness-based foam (Jacobian approximation via normal.y)
-    float steepness = 1 - normal.y; // 0 = flat, 1 = vertical
+    if(OCEAN_FOAM != 0)
+    {
+        // 1. Steepness-based foam (Jacobian approximation via normal.y)
+        float steepness = 1 - normal.y; // 0 = flat, 1 = vertical
 
-    // 2. Height-based foam bias
-    float heightFactor = totalWaveHeight / (uAmplitude * 2.0); // rough normalization
+        // 2. Height-based foam bias
+        float heightFactor = totalWaveHeight / (uAmplitude * 2.0); // rough normalization
 
-    // Combine
-    float foamRaw = steepness;
-    foamRaw = pow(foamRaw, 2.0); // make it appear only on real peaks
+        // Combine
+        float foamRaw = steepness;
+        foamRaw = pow(foamRaw, 2.0); // make it appear only on real peaks
 
-    // Smooth but sharp threshold
-    float foamMask = smoothstep(uFoamThreshold, uFoamThreshold + 0.15, foamRaw);
-    foamMask = pow(foamMask, uFoamHardness);
+        // Smooth but sharp threshold
+        float foamMask = smoothstep(uFoamThreshold, uFoamThreshold + 0.15, foamRaw);
+        foamMask = pow(foamMask, uFoamHardness);
 
-    // Fade foam with distance to avoid noisy far-away foam
-    float dist = length(uViewPosition - vFragPos);
-    foamMask *= clamp(1.0 - dist / uFoamDistanceFade, 0.0, 1.0);
+        // Fade foam with distance to avoid noisy far-away foam
+        float dist = length(uViewPosition - vFragPos);
+        foamMask *= clamp(1.0 - dist / uFoamDistanceFade, 0.0, 1.0);
 
-    // Final foam contribution
-    vec3 foam = uFoamColor * foamMask * uFoamIntensity * (uDirectionalLight.DiffuseColor);
+        // Final foam contribution
+        vec3 foam = uFoamColor * foamMask * uFoamIntensity * (uDirectionalLight.DiffuseColor);
 
-    // Composite: water + scatter + foam on top
-    vec3 color = baseWater;// + scatter;
-    color = mix(color, foam, foamMask); // foam overrides everything where present
+        // Composite: water + scatter + foam on top
+        color = mix(color, foam, foamMask); // foam overrides everything where present
+    }
 
     // add fog
-    vec3 I = normalize(vFragPos - uViewPosition);
-    vec3 R = reflect(I, normal); 
-    R.y = abs(R.y);
-    vec3 sky = vec3(texture(uSkybox, R).rgb);
+    if(OCEAN_FOG != 0)
+    {
+        vec3 I = normalize(vFragPos - uViewPosition);
+        vec3 R = reflect(I, normal); 
+        R.y = abs(R.y);
+        vec3 sky = vec3(texture(uSkybox, R).rgb);
     
-    float fogDistance = distance(uViewPosition, vFragPos);
-    float fogFactor = clamp(fogDistance / uFogDistance, 0.0, 1.0);
+        float fogDistance = distance(uViewPosition, vFragPos);
+        float fogFactor = clamp(fogDistance / uFogDistance, 0.0, 1.0);
 
-    color = mix(color, sky, fogFactor);
+        color = mix(color, sky, fogFactor);
+    }
 
     FragColor = vec4(color , 1.0);
 } 
\ No newline at end of file
@@ -1,89 +1,286 @@
-#version 330 core
+#version 430 core
 #include "res/shaders/transforms.glsl"
+#include "res/shaders/ocean_waves.glsl"
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec3 aTangent;
-layout (location = 3) in vec2 aTexCoord;
+// Integer grid coordinates of the vertex inside its tile (ocean/ocean_mesh.h)
+layout (location = 0) in vec2 aGridPos;
 
+// OCEAN_DEPTH_ONLY: depth pre-pass build, paired with depth_only.frag. Only the position is computed, it must
+// match the color pass exactly for its GL_EQUAL depth test
+invariant gl_Position;
+
+#ifndef OCEAN_DEPTH_ONLY
 out vec3 vPos;
 out vec3 vFragPos;
 out vec3 vLocalPos;
-out vec2 vTexCoord;
-
-uniform int uWaveCount;
-uniform vec2 uWaveDirection;
-uniform float uSpeed;
-uniform float uTime;
-uniform float uSteepness;
-
-uniform float uFrequency;
-uniform float uAmplitude;
-uniform float uPersistance;
-uniform float uLacunarity;
-uniform float uInitialSeed;
-uniform float uSeedIter;
-uniform float uSpeedRamp;
-
-vec3 get_wave_pos(vec3 worldPos)
+out vec2 vRestPos;
+out vec3 vTangentX;
+out vec3 vTangentZ;
+// Footprint the geometric octaves were faded with, and the first one not applied in full (ocean_waves.glsl)
+out float vVertexFootprint;
+flat out int vFirstPartialOctave;
+#endif
+
+// Octave LOD footprint: distance between grid vertices and size of a pixel at 1m (radians)
+uniform float uVertexSpacing;
+uniform float uPixelAngle;
+
+// 0: fixed grid, 1: CDLOD patches, 2: clipmap rings, 3: projected grid (ocean/ocean_mesh.h)
+uniform int uOceanMeshType;
+
+// Fixed and projected grids: tiles of uGridTileResolution quads, one per instance, row by row
+uniform float uGridTileResolution;
+uniform int uGridTilesPerSide;
+
+// CDLOD: aGridPos are the integer vertex coordinates inside the patch, the patch is picked by gl_InstanceID.
+// Binding must match OCEAN_PATCH_BINDING and the levels OCEAN_CDLOD_LEVELS
+#define OCEAN_CDLOD_LEVELS 9
+struct OceanPatch
+{
+    vec2 Origin;
+    float Size;
+    float Level;
+};
+
+layout(std430, binding = 2) readonly buffer OceanPatchBuffer
+{
+    OceanPatch uPatches[];
+};
+
+uniform float uCdlodPatchResolution;
+// Per level: morph = 1 - clamp(x - distance * y, 0, 1)
+uniform vec2 uCdlodMorph[OCEAN_CDLOD_LEVELS];
+
+// Clipmap: no vertex attributes, the quad is decoded from gl_VertexID. Must match OCEAN_CLIPMAP_LEVELS and
+// OCEAN_CLIPMAP_RESOLUTION. The last OCEAN_CLIPMAP_MORPH_WIDTH quads before the outer border of a ring morph
+#define OCEAN_CLIPMAP_LEVELS 8
+#define OCEAN_CLIPMAP_RESOLUTION 128
+#define OCEAN_CLIPMAP_MORPH_WIDTH 16.0
+
+// Per ring: origin (xy) and first quad of the hole (zw) in quads of the ring
+uniform vec4 uClipmapLevels[OCEAN_CLIPMAP_LEVELS];
+uniform float uClipmapSpacing;
+
+// Projected grid: the tiled grid coordinates are, spread over uProjectedGridRange (NDC min, max)
+uniform mat4x4 uProjectedGridInverseViewProjection;
+uniform vec4 uProjectedGridRange;
+uniform float uProjectedGridResolution;
+
+// 0: Gerstner, 1: FFT
+#ifndef OCEAN_SIMULATION_TYPE
+uniform int uSimulationType;
+#define OCEAN_SIMULATION_TYPE uSimulationType
+#endif
+
+// FFT cascades, one layer each (OCEAN_MAX_CASCADES)
+uniform sampler2DArray uDisplacementMap;
+uniform int uCascadeCount;
+uniform float uCascadeTileSize[3];
+
+// Grid coordinates of the vertex in the whole grid
+vec2 get_tiled_grid_pos()
+{
+    vec2 tile = vec2(gl_InstanceID % uGridTilesPerSide, gl_InstanceID / uGridTilesPerSide);
+    return aGridPos + tile * uGridTileResolution;
+}
+
+// Rest positions of the CDLOD patches, clipmap rings and projected grid are placed in world space, the ocean model matrix is the identity
+
+vec3 get_cdlod_rest_pos(out float spacing)
+{
+    OceanPatch oceanPatch = uPatches[gl_InstanceID];
+    float quadSize = oceanPatch.Size / uCdlodPatchResolution;
+    vec2 gridPos = aGridPos;
+    vec2 restPos = oceanPatch.Origin + gridPos * quadSize;
+
+    // Near the end of its range the odd vertices slide onto the even ones, matching the next level
+    vec2 morphConstants = uCdlodMorph[int(oceanPatch.Level)];
+    float morph = 1.0 - clamp(morphConstants.x - distance(uViewPosition, vec3(restPos.x, 0.0, restPos.y)) * morphConstants.y, 0.0, 1.0);
+    gridPos -= fract(gridPos * 0.5) * 2.0 * morph;
+    restPos = oceanPatch.Origin + gridPos * quadSize;
+
+    spacing = quadSize * (1.0 + morph);
+    return vec3(restPos.x, 0.0, restPos.y);
+}
+
+vec3 get_clipmap_rest_pos(out float spacing)
+{
+    const int resolution = OCEAN_CLIPMAP_RESOLUTION;
+    const int holeSize = resolution / 2;
+    const int holeQuads = holeSize * holeSize;
+    const int ringQuads = resolution * resolution - holeQuads;
+    const ivec2 corners[6] = ivec2[6](ivec2(0, 0), ivec2(0, 1), ivec2(1, 1), ivec2(0, 0), ivec2(1, 1), ivec2(1, 0));
+
+    // Vertices are laid out as: hole of the finest ring, then each ring as the rows below the hole,
+    // the rows beside it and the rows above it
+    int quad = gl_VertexID / 6;
+    int level = 0;
+    ivec2 hole = ivec2(uClipmapLevels[0].zw);
+    ivec2 quadPos;
+    if(quad < holeQuads)
+    {
+        quadPos = hole + ivec2(quad % holeSize, quad / holeSize);
+    }
+    else
+    {
+        quad -= holeQuads;
+        level = quad / ringQuads;
+        quad -= level * ringQuads;
+        hole = ivec2(uClipmapLevels[level].zw);
+
+        int belowQuads = hole.y * resolution;
+        int besideQuads = holeSize * (resolution - holeSize);
+        if(quad < belowQuads)
+        {
+            quadPos = ivec2(quad % resolution, quad / resolution);
+        }
+        else if(quad < belowQuads + besideQuads)
+        {
+            quad -= belowQuads;
+            int column = quad % (resolution - holeSize);
+            quadPos = ivec2(column < hole.x ? column : column + holeSize, hole.y + quad / (resolution - holeSize));
+        }
+        else
+        {
+            quad -= belowQuads + besideQuads;
+            quadPos = ivec2(quad % resolution, hole.y + holeSize + quad / resolution);
+        }
+    }
+
+    float quadSize = uClipmapSpacing * float(1 << level);
+    vec2 origin = uClipmapLevels[level].xy;
+    vec2 gridPos = vec2(quadPos + corners[gl_VertexID % 6]);
+
+    // The origin is on the grid of the next ring, the odd vertices slide onto the even ones near the border
+    vec2 restPos = origin + gridPos * quadSize;
+    vec2 toCamera = abs(restPos - uViewPosition.xz) / quadSize;
+    float borderDistance = float(resolution / 2 - 2) - max(toCamera.x, toCamera.y);
+    float morph = level == OCEAN_CLIPMAP_LEVELS - 1 ? 0.0 : clamp(1.0 - borderDistance / OCEAN_CLIPMAP_MORPH_WIDTH, 0.0, 1.0);
+    gridPos -= fract(gridPos * 0.5) * 2.0 * morph;
+    restPos = origin + gridPos * quadSize;
+
+    spacing = quadSize * (1.0 + morph);
+    return vec3(restPos.x, 0.0, restPos.y);
+}
+
+// Point of the rest plane seen through gridPos. The grid X runs along the screen Y so the triangles keep their winding.
+// Rays that miss the plane, or meet it past the far plane, end at the far plane
+vec2 get_projected_grid_point(vec2 gridPos)
+{
+    vec2 ndc = mix(uProjectedGridRange.xy, uProjectedGridRange.zw, gridPos.yx / uProjectedGridResolution);
+    vec4 nearPoint = uProjectedGridInverseViewProjection * vec4(ndc, -1.0, 1.0);
+    vec4 farPoint = uProjectedGridInverseViewProjection * vec4(ndc, 1.0, 1.0);
+    vec3 rayOrigin = nearPoint.xyz / nearPoint.w;
+    vec3 ray = farPoint.xyz / farPoint.w - rayOrigin;
+
+    float t = ray.y != 0.0 ? -rayOrigin.y / ray.y : 1.0;
+    t = t < 0.0 ? 1.0 : min(t, 1.0);
+    return rayOrigin.xz + ray.xz * t;
+}
+
+vec3 get_projected_grid_rest_pos(out float spacing)
+{
+    vec2 gridPos = get_tiled_grid_pos();
+    vec2 restPos = get_projected_grid_point(gridPos);
+    spacing = max(distance(restPos, get_projected_grid_point(gridPos + vec2(1.0, 0.0))),
+                  distance(restPos, get_projected_grid_point(gridPos + vec2(0.0, 1.0))));
+    return vec3(restPos.x, 0.0, restPos.y);
+}
+
+// Rest position of the vertex and distance to its neighbours
+vec3 get_rest_pos(out float spacing)
+{
+    if(uOceanMeshType == 1)
+    {
+        return get_cdlod_rest_pos(spacing);
+    }
+    if(uOceanMeshType == 2)
+    {
+        return get_clipmap_rest_pos(spacing);
+    }
+    if(uOceanMeshType == 3)
+    {
+        return get_projected_grid_rest_pos(spacing);
+    }
+
+    vec2 restPos = get_tiled_grid_pos() * uVertexSpacing;
+    spacing = uVertexSpacing;
+    return vec3(restPos.x, 0.0, restPos.y);
+}
+
+vec3 get_grestner_wave_pos(vec3 worldPos, float vertexSpacing, out vec3 tangentX, out vec3 tangentZ, out float footprint, out int firstPartialOctave)
 {
     vec3 vpos = vec3(worldPos.x, 0.0, worldPos.z);
     vec2 coord = worldPos.xz;
-    float h = 0.0;
-    float a = 0.5;
-    float w = 0.4;
-    for(int i = 0; i < uWaveCount; ++i)
+
+    // Geometry can not show waves shorter than the grid, nor the screen smaller than a pixel
+    float viewDistance = distance(uViewPosition, vec3(Model * vec4(worldPos, 1.0)));
+    footprint = max(vertexSpacing, viewDistance * uPixelAngle);
+
+    tangentX = vec3(1.0, 0.0, 0.0);
+    tangentZ = vec3(0.0, 0.0, 1.0);
+
+    int octaveCount = get_geometric_octave_count();
+    firstPartialOctave = octaveCount;
+    for(int i = 0; i < octaveCount; ++i)
     {
-        float W = a * sin(dot(uWaveDirection, coord) * w + uTime * uSpeed);
+        Wave wave = uWaves[i];
+        float weight = get_octave_lod_weight(wave.K, footprint);
+        if(weight < 1.0)
+        {
+            firstPartialOctave = min(firstPartialOctave, i);
+        }
+        if(weight <= 0.0)
+        {
+            break;
+        }
+
+        float x = wave.K * dot(wave.Direction, coord) + uTime * wave.Speed;
+        float c = cos(x);
+        float s = sin(x);
 
-        h += W;
+        vpos.xz += weight * wave.QA * wave.Direction * c;
+        vpos.y += weight * wave.A * s;
+
+#ifndef OCEAN_DEPTH_ONLY
+        add_wave_tangents(wave, weight, s, c, tangentX, tangentZ);
+#endif
     }
-    vpos.y = h;
+
     return vpos;
 }
 
-vec3 get_grestner_wave_pos(vec3 worldPos) 
-{ 
-    vec3 vpos = vec3(worldPos.x, 0.0, worldPos.z); 
-    vec2 coord = worldPos.xz; 
-    float a = uAmplitude; 
-    float w = uFrequency; 
-    float s = uSpeed; 
-    float seed = uInitialSeed; 
-
-    for(int i = 0; i < uWaveCount; ++i) 
-    { 
-        float angle = (i + 1.0) * 1.6180339887 * seed;
-        vec2 d = vec2(cos(angle), sin(angle));
-        float q = uSteepness / (w*a*uWaveCount); 
-
-        float x = w * dot(d, coord) + uTime * s;
-
-        vpos.x += q * a * d.x * cos(x); 
-        vpos.z += q * a * d.y * cos(x);
-
-        float wave = a * sin(x);
-        vpos.y +=  wave;
-
-        float dx = wave * cos(x) * a;
-        
-        w *= uLacunarity; 
-        a *= uPersistance; 
-        s *= uSpeedRamp; 
-        seed += uSeedIter; 
-    } 
-        
-    return vpos;  
+vec3 get_fft_wave_pos(vec3 worldPos)
+{
+    vec3 displacement = vec3(0.0);
+    for(int i = 0; i < uCascadeCount; ++i)
+    {
+        displacement += textureLod(uDisplacementMap, vec3(worldPos.xz / uCascadeTileSize[i], float(i)), 0.0).xyz;
+    }
+    return vec3(worldPos.x, 0.0, worldPos.z) + displacement;
 }
+
 void main()
 {
-    vec3 pos = get_grestner_wave_pos( aPos);
+    vec3 tangentX = vec3(1.0, 0.0, 0.0);
+    vec3 tangentZ = vec3(0.0, 0.0, 1.0);
+    float vertexSpacing;
+    float footprint = 0.0;
+    int firstPartialOctave = 0;
+    vec3 restPos = get_rest_pos(vertexSpacing);
+    vec3 pos = OCEAN_SIMULATION_TYPE == 1 ? get_fft_wave_pos(restPos) : get_grestner_wave_pos(restPos, vertexSpacing, tangentX, tangentZ, footprint, firstPartialOctave);
+    VertexPosition vPositions = get_vertex_positions(pos);
+    gl_Position = vPositions.CS_Position;
+
+#ifndef OCEAN_DEPTH_ONLY
+    vTangentX = tangentX;
+    vTangentZ = tangentZ;
+    vVertexFootprint = footprint;
+    vFirstPartialOctave = firstPartialOctave;
+    vRestPos = restPos.xz;
 
     vLocalPos = pos;
-    VertexPosition vPositions = get_vertex_positions(pos);
     vFragPos = vPositions.WS_Position;
     vPos = vPositions.VS_Position;
-    gl_Position = vPositions.CS_Position;
-
-    vTexCoord = aTexCoord; 
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,6 @@
+#version 430 core
+
+// Depth pre-pass: no color output, only the depth of the fragment is written
+void main()
+{
+}
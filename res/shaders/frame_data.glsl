@@ -0,0 +1,8 @@
+// Written once per camera and frame by begin_render (SceneFrameData). Binding must match SCENE_FRAME_DATA_BINDING
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4x4 View;
+    mat4x4 Projection;
+    vec3 uViewPosition;
+    float uTime;
+};
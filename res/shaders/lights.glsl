@@ -10,7 +10,21 @@ struct PointLight
     float Quadratic;
 };
 
-uniform PointLight uPointLight;
+struct DirectionalLight
+{
+    vec3 AmbientColor;
+    vec3 DiffuseColor;
+    vec3 SpecularColor;
+    vec3 Direction;
+};
+
+// Written once per camera and frame by begin_render (SceneLightData), zero for missing lights.
+// Binding must match SCENE_LIGHT_DATA_BINDING
+layout (std140, binding = 1) uniform LightData
+{
+    DirectionalLight uDirectionalLight;
+    PointLight uPointLight;
+};
 
 vec4 compute_point_light_color(vec3 normal, vec3 fragPosition, vec3 viewPosition, Material material)
 {
@@ -37,15 +51,6 @@ vec4 compute_point_light_color(vec3 normal, vec3 fragPosition, vec3 viewPosition
 }
 
 
-struct DirectionalLight
-{
-    vec3 AmbientColor;
-    vec3 DiffuseColor;
-    vec3 SpecularColor;
-    vec3 Direction;
-};
-
-uniform DirectionalLight uDirectionalLight;
 
 vec4 compute_directional_light_color(vec3 normal, vec3 fragPosition, vec3 viewPosition, Material material)
 {
@@ -0,0 +1,69 @@
+// Gerstner wave table, built on the CPU whenever a wave parameter changes (ocean/wave_table.h).
+// Binding must match OCEAN_WAVE_TABLE_BINDING
+struct Wave
+{
+    vec2 Direction;
+    float K;        // Angular wavenumber
+    float A;        // Amplitude
+    float QA;       // Horizontal Gerstner amplitude (q * a)
+    float Speed;
+    vec2 Padding;
+};
+
+layout(std430, binding = 0) readonly buffer WaveTableBuffer
+{
+    int uWaveTableCount;
+    int uWaveTablePadding0;
+    int uWaveTablePadding1;
+    int uWaveTablePadding2;
+    Wave uWaves[];
+};
+
+// Specialized variants (ocean_get_shader_defines) define the OCEAN_* switches below as constants, so the
+// compiler can unroll and fold the octave loops. The generic variant reads the uniforms instead
+#ifndef OCEAN_WAVE_COUNT
+#define OCEAN_WAVE_COUNT uWaveTableCount
+#endif
+
+// Octave LOD: octaves whose wavelength is below the local sampling footprint only alias. They are faded
+// out and the loops stop at the first octave fully removed, the table is sorted by increasing K
+#ifndef OCEAN_OCTAVE_LOD
+uniform int uOctaveLod;
+#define OCEAN_OCTAVE_LOD uOctaveLod
+#endif
+
+// Samples per wavelength where an octave starts to fade and where it is gone (Nyquist limit)
+#define OCEAN_LOD_FADE_START 4.0
+#define OCEAN_LOD_FADE_END 2.0
+
+float get_octave_lod_weight(float k, float footprint)
+{
+    float samplesPerWave = 6.28318530718 / (k * footprint);
+    return OCEAN_OCTAVE_LOD == 0 ? 1.0 : smoothstep(OCEAN_LOD_FADE_END, OCEAN_LOD_FADE_START, samplesPerWave);
+}
+
+// Octave split: the first uGeometricOctaves octaves (the longest waves) displace the geometry and give an
+// interpolated normal. The rest are only evaluated per pixel, as detail normal
+#ifndef OCEAN_OCTAVE_SPLIT
+uniform int uOctaveSplit;
+#define OCEAN_OCTAVE_SPLIT uOctaveSplit
+#endif
+#ifndef OCEAN_GEOMETRIC_OCTAVES
+uniform int uGeometricOctaves;
+#define OCEAN_GEOMETRIC_OCTAVES uGeometricOctaves
+#endif
+
+int get_geometric_octave_count()
+{
+    return OCEAN_OCTAVE_SPLIT != 0 ? min(OCEAN_GEOMETRIC_OCTAVES, OCEAN_WAVE_COUNT) : OCEAN_WAVE_COUNT;
+}
+
+// Adds the derivatives of one octave to the tangents of the displaced surface along the rest X and Z axes.
+// s and c are the sine and cosine of the octave phase
+void add_wave_tangents(Wave wave, float weight, float s, float c, inout vec3 tangentX, inout vec3 tangentZ)
+{
+    vec2 k = weight * wave.K * wave.Direction;
+    vec3 dPos = vec3(-wave.QA * wave.Direction.x * s, wave.A * c, -wave.QA * wave.Direction.y * s);
+    tangentX += dPos * k.x;
+    tangentZ += dPos * k.y;
+}
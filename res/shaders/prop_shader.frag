@@ -0,0 +1,18 @@
+#version 430 core
+#include "res/shaders/frame_data.glsl"
+#include "res/shaders/basic_material.glsl"
+#include "res/shaders/lights.glsl"
+out vec4 FragColor;
+
+in vec3 vFragPos;
+in vec3 vNormal;
+in vec2 vTexCoord;
+
+void main()
+{
+    vec3 albedo = texture(uAlbedoMap, vTexCoord).rgb;
+    vec3 light = compute_directional_light_color(vNormal, vFragPos, uViewPosition, uMaterial).rgb;
+    light += compute_point_light_color(vNormal, vFragPos, uViewPosition, uMaterial).rgb;
+
+    FragColor = vec4(albedo * light, 1.0);
+}
@@ -0,0 +1,41 @@
+#version 430 core
+// Buoys and other props sharing a model are drawn in one instanced draw
+#define SCENE_INSTANCED
+#include "res/shaders/transforms.glsl"
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec3 vFragPos;
+out vec3 vNormal;
+out vec2 vTexCoord;
+
+// Quantized meshes: aPos is normalized in the mesh bounds given by the instance and aNormal.xy is octahedral
+
+vec3 decode_octahedral(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
+void main()
+{
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+    SceneInstance instance = uInstances[aInstanceIndex];
+    if(instance.PositionOffset.w != 0.0)
+    {
+        position = instance.PositionOffset.xyz + aPos * instance.PositionScale.xyz;
+        normal = decode_octahedral(aNormal.xy);
+    }
+
+    VertexPosition vPositions = get_vertex_positions(position);
+    vFragPos = vPositions.WS_Position;
+    vNormal = get_normal_positions(normal).WS_Normal;
+    vTexCoord = aTexCoord;
+    gl_Position = vPositions.CS_Position;
+}
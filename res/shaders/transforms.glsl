@@ -1,6 +1,26 @@
+#include "res/shaders/frame_data.glsl"
+
+// SCENE_INSTANCED: per instance data is read from the instance buffer at aInstanceIndex, which is the base instance
+// of the draw plus gl_InstanceID (VAO_INSTANCE_INDEX_LOCATION). Binding must match SCENE_INSTANCE_DATA_BINDING and
+// the layout SceneInstanceData
+#ifdef SCENE_INSTANCED
+struct SceneInstance
+{
+	mat4x4 Model;
+	// Quantized meshes (Mesh::Quantized): position = PositionOffset.xyz + aPos * PositionScale.xyz, PositionOffset.w is 1
+	vec4 PositionOffset;
+	vec4 PositionScale;
+};
+
+layout(std430, binding = 3) readonly buffer InstanceData
+{
+	SceneInstance uInstances[];
+};
+layout(location = 7) in uint aInstanceIndex;
+#define Model uInstances[aInstanceIndex].Model
+#else
 uniform mat4x4 Model;
-uniform mat4x4 View;
-uniform mat4x4 Projection;
+#endif
 
 struct VertexPosition
 {
@@ -72,12 +72,14 @@ void al_load_textures()
 enum class ShaderName
 {
 	basic_shader,
+	prop_shader,
 	
 	COUNT
 };
 static ShaderAssetState _ShaderAssets[] =
 {
-	ShaderAssetState{ ShaderAsset { Asset{ "res/shaders/basic_shader.frag"}, Asset{ "res/shaders/basic_shader.vert"}} }
+	ShaderAssetState{ ShaderAsset { Asset{ "res/shaders/basic_shader.frag"}, Asset{ "res/shaders/basic_shader.vert"}} },
+	ShaderAssetState{ ShaderAsset { Asset{ "res/shaders/prop_shader.frag"}, Asset{ "res/shaders/prop_shader.vert"}} }
 };
 
 
@@ -1,12 +1,45 @@
 #include "_assimp_mesh_importer.h"
 
 #include <iostream>
+#include <chrono>
+#include <glm/gtc/packing.hpp>
 #include "../public/assets_handler.h"
 #include "../../core/memory_utils.h"
+#include "../../renderer/data/mesh_optimizer.h"
+#include "../../physics/buoyancy.h"
+#include "_mesh_cache.h"
 
 static std::vector<Vertex> s_Vertices;
 static std::vector<unsigned int> s_Indices;
 
+// Positions and indices of every submesh, kept to build the buoyancy points of the model
+static std::vector<glm::vec3> s_ModelPositions;
+static std::vector<unsigned int> s_ModelIndices;
+
+// Vertices and submeshes of the whole model, uploaded once every submesh is read
+static std::vector<Vertex> s_ModelVertices;
+static std::vector<Submesh> s_ModelSubmeshes;
+
+// Imported models are stored quantized, 16 bytes per vertex instead of 32:
+// position snorm16 in the model bounds (w is padding), octahedral normal snorm16 and half float UV
+typedef struct
+{
+    short Position[4];
+    short Normal[2];
+    unsigned short UV[2];
+} QuantizedVertex;
+
+static VertexAttribute s_QuantizedAttributes[] =
+{
+    VertexAttribute{VertexAttributeType::SHORT, 4, true},       // Position, padding
+    VertexAttribute{VertexAttributeType::SHORT, 2, true},       // Octahedral normal
+    VertexAttribute{VertexAttributeType::HALF_FLOAT, 2, false}  // UV
+};
+
+// GPU data of the last imported model, written to the mesh cache
+static std::vector<QuantizedVertex> s_QuantizedVertices;
+static std::vector<unsigned short> s_ShortIndices;
+
 // TODO: this should maybe done in a better way?
 static unsigned int s_SubmeshCount = 0;
 static unsigned int s_TotalIndexCount = 0;
@@ -14,9 +47,17 @@ static unsigned int s_TotalVertexCount = 0;
 
 void import_model(Model* rp_model, std::string r_path)
 {
+    auto start = std::chrono::high_resolution_clock::now();
+    if (mesh_cache_load(rp_model, r_path, ASSIMP_IMPORT_FLAGS, s_QuantizedAttributes, 3))
+    {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "ASSIMP::IMPORT - " << r_path << ": cooked mesh loaded in " << ms << " ms" << std::endl;
+        return;
+    }
+
     Assimp::Importer importer;
 
-    const aiScene* scene = importer.ReadFile(r_path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    const aiScene* scene = importer.ReadFile(r_path, ASSIMP_IMPORT_FLAGS);
     
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
@@ -24,33 +65,43 @@ void import_model(Model* rp_model, std::string r_path)
         return;
     }
 
-    VertexAttribute vertexAttributes[] =
-    {
-        VertexAttribute{VertexAttributeType::FLOAT, 3},	    // Position
-        VertexAttribute{VertexAttributeType::FLOAT, 3},	    // Normal
-        VertexAttribute{VertexAttributeType::FLOAT, 2}		// UV
-    };
-
-    /// vvv ---------------------------
-    // TODO: should this be done here so it can allocate buffers for the mesh being created now
-    // or it should be done after processing the whole mesh and then passing all data when
-    // creating the mesh?
-    unsigned int vertexCount = 0;
-    unsigned int indexCount = 0;
-    for (unsigned int i = 0; i < scene->mNumMeshes; i++)
-    {
-        vertexCount += scene->mMeshes[i]->mNumVertices;
-        indexCount += scene->mMeshes[i]->mNumFaces*3;
-    }
-    rp_model->p_Mesh = (Mesh*)CE_MALLOC(sizeof(Mesh));
-    create_mesh(rp_model->p_Mesh, vertexAttributes, 3, nullptr, vertexCount, nullptr, indexCount, scene->mNumMeshes, GL_STATIC_DRAW);
-    // ^^^ ---------------------------
-
     s_SubmeshCount = 0;
     s_TotalIndexCount = 0;
     s_TotalVertexCount = 0;
+    s_ModelPositions.clear();
+    s_ModelIndices.clear();
+    s_ModelVertices.clear();
+    s_ModelSubmeshes.clear();
+
+    rp_model->p_MaterialHandles = nullptr;
+    rp_model->MaterialCount = 0;
     
     process_node(scene->mRootNode, scene, rp_model);
+
+    rp_model->BoundsMin = glm::vec3(0.0f);
+    rp_model->BoundsMax = glm::vec3(0.0f);
+    if (!s_ModelPositions.empty())
+    {
+        rp_model->BoundsMin = s_ModelPositions[0];
+        rp_model->BoundsMax = s_ModelPositions[0];
+        for (const glm::vec3& position : s_ModelPositions)
+        {
+            rp_model->BoundsMin = glm::min(rp_model->BoundsMin, position);
+            rp_model->BoundsMax = glm::max(rp_model->BoundsMax, position);
+        }
+    }
+
+    create_model_mesh(rp_model, r_path);
+
+    buoyancy_voxelize_mesh(s_ModelPositions.data(), (unsigned int)s_ModelPositions.size(), s_ModelIndices.data(), (unsigned int)s_ModelIndices.size(),
+        BUOYANCY_VOXEL_RESOLUTION, &rp_model->p_BuoyancyPoints, &rp_model->BuoyancyPointCount, &rp_model->BuoyancyPointVolume);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "ASSIMP::IMPORT - " << r_path << ": imported in " << ms << " ms" << std::endl;
+
+    const void* pIndices = rp_model->p_Mesh->IndexType == GL_UNSIGNED_SHORT ? (const void*)s_ShortIndices.data() : (const void*)s_ModelIndices.data();
+    mesh_cache_write(rp_model, r_path, ASSIMP_IMPORT_FLAGS, s_QuantizedVertices.data(), (unsigned int)s_QuantizedVertices.size(),
+        sizeof(QuantizedVertex), pIndices);
 }
 
 void process_node(aiNode* rp_node, const aiScene* rp_scene, Model* rp_model)
@@ -133,10 +184,25 @@ void process_mesh(aiMesh* rp_aiMesh, const aiScene* rp_scene, Model* rp_model)
         aiFace face = rp_aiMesh->mFaces[i];
         for (unsigned int j = 0; j < face.mNumIndices; j++)
         {
-            s_Indices.push_back(face.mIndices[j] + s_TotalVertexCount);
+            s_Indices.push_back(face.mIndices[j]);
         }
     }
 
+    // Reordered per submesh, so the triangles stay in their own index range
+    std::string meshName = std::string("import ") + rp_aiMesh->mName.C_Str();
+    vertexCount = (int)mesh_optimize(s_Vertices.data(), s_Vertices.size(), sizeof(Vertex), s_Indices.data(), s_Indices.size(), meshName.c_str());
+
+    s_ModelVertices.insert(s_ModelVertices.end(), s_Vertices.begin(), s_Vertices.begin() + vertexCount);
+    for (int i = 0; i < vertexCount; i++)
+    {
+        s_ModelPositions.push_back(s_Vertices[i].Position);
+    }
+    for (unsigned int& index : s_Indices)
+    {
+        index += s_TotalVertexCount;
+    }
+    s_ModelIndices.insert(s_ModelIndices.end(), s_Indices.begin(), s_Indices.end());
+
 
     // TODO: Add option to not load any materials nor textures so the game can handle it on its own
     // Otherwise: Texture should be registered inside the assets handler and material
@@ -162,14 +228,83 @@ void process_mesh(aiMesh* rp_aiMesh, const aiScene* rp_scene, Model* rp_model)
         // TODO: add default material
         //meshMaterial = DEFAULT_MAT;
     }
-    Mesh* p_Mesh = rp_model->p_Mesh;
-    vbo_set_data(p_Mesh->Vbo, s_Vertices.data(), sizeof(Vertex) * vertexCount, s_TotalVertexCount);
-    ibo_set_data(p_Mesh->Ibo, s_Indices.data(), sizeof(unsigned int) * indexCount, s_TotalIndexCount);
-
-    p_Mesh->Submeshes[s_SubmeshCount] = Submesh{ s_TotalIndexCount, indexCount };
+    s_ModelSubmeshes.push_back(Submesh{ s_TotalIndexCount, indexCount });
     //TODO: rp_mesh->Materials[s_SubmeshCount] = meshMaterial;
     
     s_TotalIndexCount += indexCount;
     s_TotalVertexCount += vertexCount;
     ++s_SubmeshCount;
-}
\ No newline at end of file
+}
+
+// Octahedral mapping of a unit vector to [-1, 1]^2. Zero vectors map to (0, 0), decoded as +Z
+static glm::vec2 _encode_octahedral(glm::vec3 r_normal)
+{
+    float length = fabsf(r_normal.x) + fabsf(r_normal.y) + fabsf(r_normal.z);
+    if (length <= 0.0f)
+    {
+        return glm::vec2(0.0f);
+    }
+
+    glm::vec2 encoded = glm::vec2(r_normal.x, r_normal.y) / length;
+    if (r_normal.z < 0.0f)
+    {
+        glm::vec2 signs(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+        encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signs;
+    }
+    return encoded;
+}
+
+void create_model_mesh(Model* rp_model, const std::string& r_path)
+{
+    size_t vertexCount = s_ModelVertices.size();
+    size_t indexCount = s_ModelIndices.size();
+
+    glm::vec3 center = (rp_model->BoundsMin + rp_model->BoundsMax) * 0.5f;
+    glm::vec3 halfExtent = glm::max((rp_model->BoundsMax - rp_model->BoundsMin) * 0.5f, glm::vec3(1e-6f));
+
+    std::vector<QuantizedVertex>& vertices = s_QuantizedVertices;
+    vertices.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const Vertex& vertex = s_ModelVertices[i];
+        glm::vec3 position = (vertex.Position - center) / halfExtent;
+        glm::vec2 normal = _encode_octahedral(vertex.Normal);
+
+        QuantizedVertex& quantized = vertices[i];
+        quantized.Position[0] = (short)glm::packSnorm1x16(position.x);
+        quantized.Position[1] = (short)glm::packSnorm1x16(position.y);
+        quantized.Position[2] = (short)glm::packSnorm1x16(position.z);
+        quantized.Position[3] = 0;
+        quantized.Normal[0] = (short)glm::packSnorm1x16(normal.x);
+        quantized.Normal[1] = (short)glm::packSnorm1x16(normal.y);
+        quantized.UV[0] = glm::packHalf1x16(vertex.UV.x);
+        quantized.UV[1] = glm::packHalf1x16(vertex.UV.y);
+    }
+
+    // 0xFFFF is the primitive restart index of 16 bit indices
+    bool shortIndices = vertexCount < 0xFFFF;
+    s_ShortIndices.clear();
+    if (shortIndices)
+    {
+        s_ShortIndices.assign(s_ModelIndices.begin(), s_ModelIndices.end());
+    }
+
+    rp_model->p_Mesh = (Mesh*)CE_MALLOC(sizeof(Mesh));
+    Mesh* p_Mesh = rp_model->p_Mesh;
+    create_mesh_in_heap(p_Mesh, s_QuantizedAttributes, 3, vertices.data(), (int)vertexCount,
+        shortIndices ? (const void*)s_ShortIndices.data() : (const void*)s_ModelIndices.data(), (int)indexCount,
+        shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (int)s_ModelSubmeshes.size());
+    for (size_t i = 0; i < s_ModelSubmeshes.size(); i++)
+    {
+        p_Mesh->Submeshes[i] = s_ModelSubmeshes[i];
+    }
+
+    p_Mesh->Quantized = true;
+    p_Mesh->PositionOffset = center;
+    p_Mesh->PositionScale = halfExtent;
+
+    size_t floatBytes = vertexCount * sizeof(Vertex) + indexCount * sizeof(unsigned int);
+    size_t quantizedBytes = vertexCount * sizeof(QuantizedVertex) + indexCount * (shortIndices ? sizeof(unsigned short) : sizeof(unsigned int));
+    std::cout << "ASSIMP::IMPORT - " << r_path << ": " << vertexCount << " vertices, " << indexCount << " indices, "
+        << floatBytes / 1024 << " KB -> " << quantizedBytes / 1024 << " KB" << std::endl;
+}
@@ -9,9 +9,20 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+// Post processing of every import. Part of the mesh cache key
+#define ASSIMP_IMPORT_FLAGS (aiProcess_Triangulate | aiProcess_FlipUVs)
+
+/// <summary>
+/// Loads the cooked mesh of r_path if it is up to date, else imports it with Assimp and cooks it
+/// </summary>
 void import_model(Model* rp_model, std::string r_path);
 
 void process_node(aiNode* rp_node, const aiScene* rp_scene, Model* rp_model);
 void process_mesh(aiMesh* rp_aiMesh, const aiScene* rp_scene, Model* rp_model);
 
+/// <summary>
+/// Uploads the submeshes read by process_node in the quantized layout, with 16 bit indices when they fit
+/// </summary>
+void create_model_mesh(Model* rp_model, const std::string& r_path);
+
 #endif // !ASSIMP_MESH_IMPORTER_H
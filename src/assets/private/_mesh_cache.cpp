@@ -0,0 +1,256 @@
+#include "_mesh_cache.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include "../../core/mapped_file.h"
+#include "../../core/memory_utils.h"
+#include "../../physics/buoyancy.h"
+
+#define MESH_CACHE_ALIGNMENT 16
+
+typedef struct
+{
+    char Magic[4];
+    unsigned int Version;
+
+    // Key
+    unsigned long long SourcePathHash;
+    long long SourceWriteTime;
+    unsigned int ImportFlags;
+    unsigned int VoxelResolution;
+
+    unsigned int VertexStride;
+    unsigned int VertexCount;
+    unsigned int IndexType;
+    unsigned int IndexCount;
+    unsigned int SubmeshCount;
+    unsigned int BuoyancyPointCount;
+
+    float BoundsMin[3];
+    float BoundsMax[3];
+    float PositionOffset[3];
+    float PositionScale[3];
+    float BuoyancyPointVolume;
+    unsigned int Quantized;
+
+    // Byte offsets from the start of the file
+    unsigned long long SubmeshOffset;
+    unsigned long long VertexOffset;
+    unsigned long long IndexOffset;
+    unsigned long long BuoyancyOffset;
+    unsigned long long FileSize;
+} MeshCacheHeader;
+
+typedef struct
+{
+    unsigned int StartIndex;
+    unsigned int IndexCount;
+} MeshCacheSubmesh;
+
+static const char MESH_CACHE_MAGIC[4] = { 'O', 'C', 'M', 'H' };
+
+// FNV-1a
+static unsigned long long _hash_path(const std::string& r_path)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    for (char c : r_path)
+    {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static bool _get_write_time(const std::string& r_path, long long* rp_outTime)
+{
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(r_path, error);
+    if (error)
+    {
+        return false;
+    }
+    *rp_outTime = (long long)time.time_since_epoch().count();
+    return true;
+}
+
+static std::string _get_cache_path(const std::string& r_sourcePath)
+{
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", _hash_path(r_sourcePath));
+    return std::string(MESH_CACHE_DIRECTORY) + std::filesystem::path(r_sourcePath).stem().string() + "_" + hash + MESH_CACHE_EXTENSION;
+}
+
+static unsigned long long _align(unsigned long long r_offset)
+{
+    return (r_offset + MESH_CACHE_ALIGNMENT - 1) & ~(unsigned long long)(MESH_CACHE_ALIGNMENT - 1);
+}
+
+static unsigned int _get_index_size(unsigned int r_indexType)
+{
+    return r_indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+// Offsets of every block after the header, from the counts in it
+static void _set_offsets(MeshCacheHeader* rp_header)
+{
+    rp_header->SubmeshOffset = _align(sizeof(MeshCacheHeader));
+    rp_header->VertexOffset = _align(rp_header->SubmeshOffset + sizeof(MeshCacheSubmesh) * rp_header->SubmeshCount);
+    rp_header->IndexOffset = _align(rp_header->VertexOffset + (unsigned long long)rp_header->VertexStride * rp_header->VertexCount);
+    rp_header->BuoyancyOffset = _align(rp_header->IndexOffset + (unsigned long long)_get_index_size(rp_header->IndexType) * rp_header->IndexCount);
+    rp_header->FileSize = rp_header->BuoyancyOffset + sizeof(glm::vec3) * rp_header->BuoyancyPointCount;
+}
+
+static bool _is_header_valid(const MeshCacheHeader& r_header, const MappedFile& r_file, const std::string& r_sourcePath,
+    unsigned int r_importFlags, unsigned int r_vertexStride)
+{
+    long long writeTime = 0;
+    if (memcmp(r_header.Magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 || r_header.Version != MESH_CACHE_VERSION
+        || r_header.SourcePathHash != _hash_path(r_sourcePath) || !_get_write_time(r_sourcePath, &writeTime)
+        || r_header.SourceWriteTime != writeTime || r_header.ImportFlags != r_importFlags
+        || r_header.VoxelResolution != BUOYANCY_VOXEL_RESOLUTION || r_header.VertexStride != r_vertexStride)
+    {
+        return false;
+    }
+    if (r_header.IndexType != GL_UNSIGNED_SHORT && r_header.IndexType != GL_UNSIGNED_INT)
+    {
+        return false;
+    }
+
+    MeshCacheHeader expected = r_header;
+    _set_offsets(&expected);
+    return memcmp(&expected.SubmeshOffset, &r_header.SubmeshOffset, sizeof(unsigned long long) * 5) == 0 && r_header.FileSize <= r_file.Size;
+}
+
+bool mesh_cache_load(Model* rp_model, const std::string& r_sourcePath, unsigned int r_importFlags,
+    VertexAttribute* rp_vertexAttributes, int r_vertexAttrCount)
+{
+    MappedFile file;
+    if (!map_file(&file, _get_cache_path(r_sourcePath).c_str()))
+    {
+        return false;
+    }
+
+    unsigned int stride = create_vertex_buffer_layout(rp_vertexAttributes, r_vertexAttrCount).Stride;
+    MeshCacheHeader header;
+    if (file.Size < sizeof(MeshCacheHeader))
+    {
+        unmap_file(&file);
+        return false;
+    }
+    memcpy(&header, file.pData, sizeof(MeshCacheHeader));
+    if (!_is_header_valid(header, file, r_sourcePath, r_importFlags, stride))
+    {
+        unmap_file(&file);
+        return false;
+    }
+
+    const unsigned char* pBytes = (const unsigned char*)file.pData;
+    rp_model->p_Mesh = (Mesh*)CE_MALLOC(sizeof(Mesh));
+    Mesh* p_Mesh = rp_model->p_Mesh;
+    create_mesh_in_heap(p_Mesh, rp_vertexAttributes, r_vertexAttrCount, pBytes + header.VertexOffset, (int)header.VertexCount,
+        pBytes + header.IndexOffset, (int)header.IndexCount, header.IndexType, (int)header.SubmeshCount);
+
+    const MeshCacheSubmesh* pSubmeshes = (const MeshCacheSubmesh*)(pBytes + header.SubmeshOffset);
+    for (unsigned int i = 0; i < header.SubmeshCount; i++)
+    {
+        p_Mesh->Submeshes[i] = Submesh{ pSubmeshes[i].StartIndex, pSubmeshes[i].IndexCount };
+    }
+    p_Mesh->Quantized = header.Quantized != 0;
+    p_Mesh->PositionOffset = glm::vec3(header.PositionOffset[0], header.PositionOffset[1], header.PositionOffset[2]);
+    p_Mesh->PositionScale = glm::vec3(header.PositionScale[0], header.PositionScale[1], header.PositionScale[2]);
+
+    rp_model->p_MaterialHandles = nullptr;
+    rp_model->MaterialCount = 0;
+    rp_model->BoundsMin = glm::vec3(header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2]);
+    rp_model->BoundsMax = glm::vec3(header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2]);
+
+    rp_model->p_BuoyancyPoints = nullptr;
+    rp_model->BuoyancyPointCount = header.BuoyancyPointCount;
+    rp_model->BuoyancyPointVolume = header.BuoyancyPointVolume;
+    if (header.BuoyancyPointCount > 0)
+    {
+        size_t pointBytes = sizeof(glm::vec3) * header.BuoyancyPointCount;
+        rp_model->p_BuoyancyPoints = (glm::vec3*)CE_MALLOC(pointBytes);
+        memcpy(rp_model->p_BuoyancyPoints, pBytes + header.BuoyancyOffset, pointBytes);
+    }
+
+    unmap_file(&file);
+    return true;
+}
+
+void mesh_cache_write(const Model* rp_model, const std::string& r_sourcePath, unsigned int r_importFlags,
+    const void* rp_vertices, unsigned int r_vertexCount, unsigned int r_vertexStride, const void* rp_indices)
+{
+    const Mesh* p_Mesh = rp_model->p_Mesh;
+
+    MeshCacheHeader header = {};
+    memcpy(header.Magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.Version = MESH_CACHE_VERSION;
+    header.SourcePathHash = _hash_path(r_sourcePath);
+    if (!_get_write_time(r_sourcePath, &header.SourceWriteTime))
+    {
+        return;
+    }
+    header.ImportFlags = r_importFlags;
+    header.VoxelResolution = BUOYANCY_VOXEL_RESOLUTION;
+
+    header.VertexStride = r_vertexStride;
+    header.VertexCount = r_vertexCount;
+    header.IndexType = p_Mesh->IndexType;
+    header.IndexCount = (unsigned int)p_Mesh->IndexCount;
+    header.SubmeshCount = p_Mesh->SubmeshCount;
+    header.BuoyancyPointCount = rp_model->BuoyancyPointCount;
+
+    for (int i = 0; i < 3; i++)
+    {
+        header.BoundsMin[i] = rp_model->BoundsMin[i];
+        header.BoundsMax[i] = rp_model->BoundsMax[i];
+        header.PositionOffset[i] = p_Mesh->PositionOffset[i];
+        header.PositionScale[i] = p_Mesh->PositionScale[i];
+    }
+    header.BuoyancyPointVolume = rp_model->BuoyancyPointVolume;
+    header.Quantized = p_Mesh->Quantized ? 1 : 0;
+    _set_offsets(&header);
+
+    std::vector<unsigned char> bytes(header.FileSize, 0);
+    memcpy(bytes.data(), &header, sizeof(MeshCacheHeader));
+    MeshCacheSubmesh* pSubmeshes = (MeshCacheSubmesh*)(bytes.data() + header.SubmeshOffset);
+    for (unsigned int i = 0; i < header.SubmeshCount; i++)
+    {
+        pSubmeshes[i] = MeshCacheSubmesh{ p_Mesh->Submeshes[i].StartIndex, p_Mesh->Submeshes[i].IndexCount };
+    }
+    if (header.VertexCount > 0)
+    {
+        memcpy(bytes.data() + header.VertexOffset, rp_vertices, (size_t)header.VertexStride * header.VertexCount);
+    }
+    if (header.IndexCount > 0)
+    {
+        memcpy(bytes.data() + header.IndexOffset, rp_indices, (size_t)_get_index_size(header.IndexType) * header.IndexCount);
+    }
+    if (header.BuoyancyPointCount > 0)
+    {
+        memcpy(bytes.data() + header.BuoyancyOffset, rp_model->p_BuoyancyPoints, sizeof(glm::vec3) * header.BuoyancyPointCount);
+    }
+
+    // Written aside and renamed, so an interrupted write never leaves a valid looking file
+    std::string path = _get_cache_path(r_sourcePath);
+    std::string tempPath = path + ".tmp";
+    std::error_code error;
+    std::filesystem::create_directories(MESH_CACHE_DIRECTORY, error);
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+        if (!out)
+        {
+            std::cout << "ERROR::MESH_CACHE - Could not write " << tempPath << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::cout << "ERROR::MESH_CACHE - Could not write " << path << ": " << error.message() << std::endl;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "../../renderer/data/model.h"
+#include <string>
+
+// Cooked models (.ocmesh), written on the first import of a source file so the next launches skip Assimp.
+// Layout: MeshCacheHeader, submesh table, vertex blob, index blob and buoyancy points, each 16 byte aligned.
+// The blobs are already in the GPU layout, so a load maps the file and uploads them as they are.
+// A cooked file is used only while the source path, its modification time, the import flags, the vertex
+// stride and the buoyancy voxel resolution all match. Bump MESH_CACHE_VERSION when the importer output changes.
+
+#define MESH_CACHE_DIRECTORY "mesh_cache/"
+#define MESH_CACHE_EXTENSION ".ocmesh"
+#define MESH_CACHE_VERSION 1
+
+/// <summary>
+/// Loads the cooked model of r_sourcePath if it is up to date. Returns false otherwise, rp_model is untouched
+/// </summary>
+/// <param name="rp_vertexAttributes">Layout of the cooked vertices</param>
+bool mesh_cache_load(Model* rp_model, const std::string& r_sourcePath, unsigned int r_importFlags,
+    VertexAttribute* rp_vertexAttributes, int r_vertexAttrCount);
+
+/// <summary>
+/// Writes the cooked model of r_sourcePath. The vertex and index data must be what was uploaded to rp_model->p_Mesh
+/// </summary>
+void mesh_cache_write(const Model* rp_model, const std::string& r_sourcePath, unsigned int r_importFlags,
+    const void* rp_vertices, unsigned int r_vertexCount, unsigned int r_vertexStride, const void* rp_indices);
+
+#endif // !MESH_CACHE_H
@@ -0,0 +1,155 @@
+#include "job_system.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+static std::vector<std::thread> s_Workers;
+static std::mutex s_Mutex;
+static std::condition_variable s_WakeCondition;
+static std::condition_variable s_DoneCondition;
+static bool s_Running = false;
+
+// Current parallel for. Only one can be in flight, submitted from the main thread
+static const JobRangeFunc* sp_CurrentJob = nullptr;
+static unsigned int s_JobCount = 0;
+static unsigned int s_JobGrain = 1;
+static std::atomic<unsigned int> s_NextIndex{ 0 };
+static std::atomic<unsigned int> s_PendingRanges{ 0 };
+static unsigned int s_JobGeneration = 0;
+static unsigned int s_ActiveWorkers = 0;
+
+static thread_local bool s_IsInsideJob = false;
+
+static void _run_ranges()
+{
+	s_IsInsideJob = true;
+	while (true)
+	{
+		unsigned int begin = s_NextIndex.fetch_add(s_JobGrain);
+		if (begin >= s_JobCount)
+		{
+			break;
+		}
+		unsigned int end = std::min(begin + s_JobGrain, s_JobCount);
+		(*sp_CurrentJob)(begin, end);
+
+		s_PendingRanges.fetch_sub(end - begin);
+	}
+	s_IsInsideJob = false;
+}
+
+static void _worker_loop()
+{
+	unsigned int seenGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(s_Mutex);
+			s_WakeCondition.wait(lock, [&]() { return !s_Running || s_JobGeneration != seenGeneration; });
+			if (!s_Running)
+			{
+				return;
+			}
+			seenGeneration = s_JobGeneration;
+			if (sp_CurrentJob == nullptr)
+			{
+				// Woke up too late, the job was already finished by the other threads
+				continue;
+			}
+			++s_ActiveWorkers;
+		}
+
+		_run_ranges();
+
+		{
+			std::lock_guard<std::mutex> lock(s_Mutex);
+			--s_ActiveWorkers;
+		}
+		s_DoneCondition.notify_all();
+	}
+}
+
+void job_system_init(unsigned int rThreadCount)
+{
+	if (s_Running)
+	{
+		return;
+	}
+
+	if (rThreadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		rThreadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	s_Running = true;
+	for (unsigned int i = 0; i < rThreadCount; i++)
+	{
+		s_Workers.emplace_back(_worker_loop);
+	}
+}
+
+void job_system_terminate()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_Mutex);
+		s_Running = false;
+	}
+	s_WakeCondition.notify_all();
+	for (std::thread& worker : s_Workers)
+	{
+		worker.join();
+	}
+	s_Workers.clear();
+}
+
+unsigned int job_system_get_thread_count()
+{
+	return (unsigned int)s_Workers.size() + 1;
+}
+
+void job_parallel_for(unsigned int rCount, unsigned int rGrainSize, const JobRangeFunc& rJob)
+{
+	if (rCount == 0)
+	{
+		return;
+	}
+
+	if (rGrainSize == 0)
+	{
+		rGrainSize = std::max(1u, (rCount + job_system_get_thread_count() - 1) / job_system_get_thread_count());
+	}
+
+	// Nested calls, or no workers: run inline
+	if (s_IsInsideJob || s_Workers.empty() || rCount <= rGrainSize)
+	{
+		for (unsigned int begin = 0; begin < rCount; begin += rGrainSize)
+		{
+			rJob(begin, std::min(begin + rGrainSize, rCount));
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(s_Mutex);
+		sp_CurrentJob = &rJob;
+		s_JobCount = rCount;
+		s_JobGrain = rGrainSize;
+		s_NextIndex = 0;
+		s_PendingRanges = rCount;
+		++s_JobGeneration;
+	}
+	s_WakeCondition.notify_all();
+
+	_run_ranges();
+
+	// Wait until every range is done and no worker is still inside the job,
+	// so a late worker can never pick ranges of the next job with stale data
+	std::unique_lock<std::mutex> lock(s_Mutex);
+	s_DoneCondition.wait(lock, []() { return s_PendingRanges.load() == 0 && s_ActiveWorkers == 0; });
+	sp_CurrentJob = nullptr;
+}
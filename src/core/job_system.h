@@ -0,0 +1,33 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <functional>
+
+// Minimal fork-join thread pool. The calling thread takes part in the work and
+// job_parallel_for only returns once every range has been processed.
+
+typedef std::function<void(unsigned int rBegin, unsigned int rEnd)> JobRangeFunc;
+
+/// <summary>
+/// Creates the worker threads
+/// </summary>
+/// <param name="rThreadCount">Number of workers. If 0, one less than the hardware threads is used</param>
+void job_system_init(unsigned int rThreadCount = 0);
+
+void job_system_terminate();
+
+/// <summary>
+/// Returns the number of threads that take part in a parallel for (workers + caller)
+/// </summary>
+unsigned int job_system_get_thread_count();
+
+/// <summary>
+/// Splits [0, rCount) in ranges of rGrainSize elements and runs them on all threads.
+/// If called from inside a job, the ranges are run inline on the calling thread
+/// </summary>
+/// <param name="rCount">Number of elements</param>
+/// <param name="rGrainSize">Elements per range. If 0, the count is split evenly between threads</param>
+/// <param name="rJob">Function called for each [begin, end) range</param>
+void job_parallel_for(unsigned int rCount, unsigned int rGrainSize, const JobRangeFunc& rJob);
+
+#endif // !JOB_SYSTEM_H
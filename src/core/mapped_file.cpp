@@ -0,0 +1,92 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+bool map_file(MappedFile* rpFile, const char* rpPath)
+{
+	*rpFile = MappedFile{ nullptr, 0, nullptr, nullptr, -1 };
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(rpPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* pData = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!pData)
+	{
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+
+	rpFile->pData = pData;
+	rpFile->Size = (size_t)size.QuadPart;
+	rpFile->pFileHandle = file;
+	rpFile->pMappingHandle = mapping;
+#else
+	int descriptor = open(rpPath, O_RDONLY);
+	if (descriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+	{
+		close(descriptor);
+		return false;
+	}
+
+	void* pData = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (pData == MAP_FAILED)
+	{
+		close(descriptor);
+		return false;
+	}
+
+	rpFile->pData = pData;
+	rpFile->Size = (size_t)info.st_size;
+	rpFile->FileDescriptor = descriptor;
+#endif
+	return true;
+}
+
+void unmap_file(MappedFile* rpFile)
+{
+	if (!rpFile->pData)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(rpFile->pData);
+	CloseHandle((HANDLE)rpFile->pMappingHandle);
+	CloseHandle((HANDLE)rpFile->pFileHandle);
+#else
+	munmap((void*)rpFile->pData, rpFile->Size);
+	close(rpFile->FileDescriptor);
+#endif
+	*rpFile = MappedFile{ nullptr, 0, nullptr, nullptr, -1 };
+}
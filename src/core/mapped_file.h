@@ -0,0 +1,27 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The pages are read by the OS on first access,
+// so a file can be validated and uploaded without copying it to the heap first.
+
+typedef struct
+{
+	const void* pData;
+	size_t Size;
+
+	// Platform handles
+	void* pFileHandle;
+	void* pMappingHandle;
+	int FileDescriptor;
+} MappedFile;
+
+/// <summary>
+/// Maps rpPath. Returns false if it can not be opened or is empty
+/// </summary>
+bool map_file(MappedFile* rpFile, const char* rpPath);
+
+void unmap_file(MappedFile* rpFile);
+
+#endif // !MAPPED_FILE_H
@@ -73,6 +73,47 @@ void imgui_render()
             }
             break;
         }
+        case ImGuiComponentType::Button:
+        {
+            auto &d = std::get<ButtonComponent>(c->Data);
+            if (ImGui::Button(c->Name.c_str()))
+                d.callback();
+            break;
+        }
+        case ImGuiComponentType::Combo:
+        {
+            auto &d = std::get<ComboComponent>(c->Data);
+            const char* preview = d.currentValue >= 0 && d.currentValue < (int)d.items.size() ? d.items[d.currentValue].c_str() : "";
+            if (ImGui::BeginCombo(c->Name.c_str(), preview))
+            {
+                for (int i = 0; i < (int)d.items.size(); i++)
+                {
+                    bool selected = i == d.currentValue;
+                    if (ImGui::Selectable(d.items[i].c_str(), selected) && !selected)
+                    {
+                        d.currentValue = i;
+                        d.callback(d.currentValue);
+                    }
+                    if (selected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+            break;
+        }
+        case ImGuiComponentType::Bool:
+        {
+            auto &d = std::get<BoolComponent>(c->Data);
+            if (ImGui::Checkbox(c->Name.c_str(), &d.currentValue))
+                d.callback(d.currentValue);
+            break;
+        }
+        case ImGuiComponentType::Text:
+        {
+            auto &d = std::get<TextComponent>(c->Data);
+            ImGui::Text("%s: %s", c->Name.c_str(), d.getText().c_str());
+            break;
+        }
         default:
             break;
         }
@@ -104,4 +145,9 @@ bool imgui_has_cursor()
 {
     ImGuiIO& io = ImGui::GetIO();
 	return io.WantCaptureMouse;
+}
+
+bool imgui_is_editing()
+{
+    return ImGui::IsAnyItemActive();
 }
\ No newline at end of file
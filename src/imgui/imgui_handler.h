@@ -5,6 +5,7 @@
 #include <functional>
 #include <string>
 #include <variant>
+#include <vector>
 #include <glm/glm.hpp>
 
 enum class ImGuiComponentType
@@ -13,7 +14,11 @@ enum class ImGuiComponentType
     Int,
     Vec3,
     Vec2,
-    Color
+    Color,
+    Button,
+    Combo,
+    Bool,
+    Text
 };
 
 typedef struct
@@ -55,11 +60,35 @@ typedef struct
     std::function<void(glm::vec3)> callback;
 } ColorComponent;
 
+typedef struct
+{
+    std::function<void()> callback;
+} ButtonComponent;
+
+typedef struct
+{
+    std::vector<std::string> items;
+    int currentValue;
+    std::function<void(int)> callback;
+} ComboComponent;
+
+typedef struct
+{
+    bool currentValue;
+    std::function<void(bool)> callback;
+} BoolComponent;
+
+typedef struct
+{
+    // Called every frame, the result is shown next to the name
+    std::function<std::string()> getText;
+} TextComponent;
+
 typedef struct
 {
     std::string Name;
     ImGuiComponentType Type;
-    std::variant<FloatComponent, IntComponent, Vec3Component, Vec2Component, ColorComponent> Data;
+    std::variant<FloatComponent, IntComponent, Vec3Component, Vec2Component, ColorComponent, ButtonComponent, ComboComponent, BoolComponent, TextComponent> Data;
     
 } ImGuiComponent;
 
@@ -69,4 +98,6 @@ void imgui_finish_render();
 void imgui_terminate();
 void imgui_add_component(ImGuiComponent *comp);
 bool imgui_has_cursor();
+// True while a widget is being dragged or typed into
+bool imgui_is_editing();
 #endif
\ No newline at end of file
@@ -1,8 +1,10 @@
 #include <iostream>
+#include <chrono>
 
 #include "core/window.h"
 
 #include "renderer/data/shader.h"
+#include "renderer/data/shader_variants.h"
 #include "renderer/data/texture.h"
 
 #include <glm/glm.hpp>
@@ -12,6 +14,7 @@
 
 #include "core/input_handler.h"
 #include "renderer/renderer.h"
+#include "renderer/gl_state_cache.h"
 #include "renderer/camera.h"
 #include "core/time_manager.h"
 #include "meshes.h"
@@ -31,9 +34,110 @@
 
 #include "imgui/imgui_handler.h"
 
+#include "ocean/ocean.h"
+#include "ocean/ocean_mesh.h"
+#include "core/job_system.h"
+#include "physics/buoyancy.h"
+
 
 const float DESIRED_FPS = 120;
 
+// Floating spheres, laid out in a BUOYS_PER_ROW grid
+const int BUOY_COUNT = 100;
+const int BUOYS_PER_ROW = 10;
+const float BUOY_SPACING = 12.0f;
+const float BUOY_SIZE = 2.0f;
+const float BUOY_DENSITY = 500.0f;
+
+// Gerstner CPU mirror of basic_shader and FFT simulation
+static Ocean s_Ocean;
+static OceanMesh s_OceanMesh;
+static BuoyancyWorld s_Buoyancy;
+
+// Set from ImGui, the benchmarks run at the start of the next frame
+static bool s_LodBenchmarkRequested = false;
+static bool s_SplitBenchmarkRequested = false;
+static bool s_MeshBenchmarkRequested = false;
+static bool s_VariantBenchmarkRequested = false;
+static bool s_DepthPrepassBenchmarkRequested = false;
+
+// basic_shader variants with the ocean settings compiled in. The generic one is used while a widget is edited,
+// so dragging a slider does not compile a program per value
+static ShaderVariants s_OceanVariants;
+static bool s_SpecializedOceanShader = true;
+static bool s_Foam = true;
+static bool s_Fog = true;
+
+// Ocean look settings, kept here because the uniforms of a feature compiled out of the active variant are
+// inactive there. They are written again to every program selected
+typedef struct
+{
+	glm::vec3 FoamColor;
+	float FoamThreshold;
+	float FoamHardness;
+	float FoamIntensity;
+	float FoamDistanceFade;
+	glm::vec3 SeaColor;
+	glm::vec3 SeaColorSurface;
+	float FogDistance;
+} OceanLookSettings;
+
+static OceanLookSettings s_OceanLook = {
+	glm::vec3(1.0f), 0.9f, 0.5f, 2.0f, 1000.0f,
+	glm::vec3(0.01f, 0.05f, 0.05f), glm::vec3(0.01f, 0.05f, 0.05f),
+	500.0f
+};
+
+// Depth only build of basic_shader for the ocean depth pre-pass, switched to the same variants as basic_shader
+// so both passes displace the vertices with the same code
+static Shader s_OceanDepthShader;
+static ShaderVariants s_OceanDepthVariants;
+
+// The pre-pass pays off with the overdraw of folded crests, so it is profiled with the steepest waves
+const float DEPTH_PREPASS_BENCHMARK_STEEPNESS = 1.0f;
+
+// Uniform writes, GL state calls and draw calls of the last frame, shown in ImGui
+static ShaderUniformStats s_FrameUniformStats = {};
+static GLStateStats s_FrameStateStats = {};
+static SceneDrawStats s_FrameDrawStats = {};
+const unsigned int RENDER_BENCHMARK_FRAMES = 60;
+
+static std::vector<ShaderDefine> _get_ocean_shader_defines()
+{
+	std::vector<ShaderDefine> defines;
+	ocean_get_shader_defines(&s_Ocean, &defines);
+	defines.push_back({ "OCEAN_FOAM", s_Foam ? 1 : 0 });
+	defines.push_back({ "OCEAN_FOG", s_Fog ? 1 : 0 });
+	return defines;
+}
+
+static void _write_ocean_look(Shader* rpShader)
+{
+	set_uniform_vec3(rpShader, "uFoamColor", s_OceanLook.FoamColor);
+	set_uniform_float(rpShader, "uFoamThreshold", s_OceanLook.FoamThreshold);
+	set_uniform_float(rpShader, "uFoamHardness", s_OceanLook.FoamHardness);
+	set_uniform_float(rpShader, "uFoamIntensity", s_OceanLook.FoamIntensity);
+	set_uniform_float(rpShader, "uFoamDistanceFade", s_OceanLook.FoamDistanceFade);
+	set_uniform_vec3(rpShader, "uSeaColor", s_OceanLook.SeaColor);
+	set_uniform_vec3(rpShader, "uSeaColorSurface", s_OceanLook.SeaColorSurface);
+	set_uniform_float(rpShader, "uFogDistance", s_OceanLook.FogDistance);
+	set_uniform_int(rpShader, "uFoam", s_Foam ? 1 : 0);
+	set_uniform_int(rpShader, "uFog", s_Fog ? 1 : 0);
+}
+
+// The settings compiled out of the previous variant were not written to the new one
+static void _select_ocean_shader_variant(const std::vector<ShaderDefine>& rDefines)
+{
+	unsigned int previousProgram = s_OceanVariants.pShader->ShaderProgram;
+	shader_variants_select(&s_OceanVariants, rDefines);
+	shader_variants_select(&s_OceanDepthVariants, rDefines);
+	if (s_OceanVariants.pShader->ShaderProgram != previousProgram)
+	{
+		ocean_write_to_shader(&s_Ocean, s_OceanVariants.pShader);
+		_write_ocean_look(s_OceanVariants.pShader);
+	}
+}
+
 int main()
 {
 	if (create_window(800, 600, "Ocean Waves Simulator") == -1)
@@ -47,6 +151,7 @@ int main()
 	cursor_set_state(CursorLockType::CenterLock, false);
 
 	imgui_init();
+	job_system_init();
 
 	Cubemap skybox;
 	/*
@@ -101,16 +206,22 @@ int main()
 	init_scene(&scene);
 	scene_add_camera(&scene, &camera);
 
+	// Models are loaded from the mesh cache after the first launch, see assets/private/_mesh_cache.h
+	auto assetLoadStart = std::chrono::high_resolution_clock::now();
 	al_load_all_assets();
+	std::cout << "ASSETS::LOAD - " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - assetLoadStart).count()
+		<< " ms" << std::endl;
+	ShaderSetupStats shaderStats = shader_get_setup_stats();
+	std::cout << "SHADER::SETUP - " << shaderStats.ProgramCount << " programs (" << shaderStats.CachedProgramCount << " from the binary cache) in "
+		<< shaderStats.Milliseconds << " ms" << std::endl;
 
 
 #pragma region OCEAN_DEFINITION
 	// vvv ----------------------------
 	// Ocean
 	Model oceanModel;
-	Mesh oceanMesh;
-	create_mesh_grid(&oceanMesh, 1024, 1024);
-	oceanModel.p_Mesh = &oceanMesh;
+	ocean_mesh_init(&s_OceanMesh, OceanMeshType::CDLOD);
+	oceanModel.p_Mesh = &s_OceanMesh.Mesh;
 	Entity sphereEntity;
 	sphereEntity.meshRendererData.ModelHandle = ah_register_model(&oceanModel);
 	sphereEntity.Position = glm::vec3(0);
@@ -131,33 +242,82 @@ int main()
    	oceanModel.p_MaterialHandles[0] = ah_register_material(&sphereMat);
    	oceanModel.MaterialCount = 1;
 
+	OceanWaveParams waveParams{};
+	waveParams.WaveCount = 300;
+	waveParams.Amplitude = 1.0f;
+	waveParams.Frequency = 0.125f;
+	waveParams.Speed = 1.0f;
+	waveParams.Steepness = 0.9f;
+	waveParams.Persistance = 0.83f;
+	waveParams.Lacunarity = 1.17f;
+	waveParams.InitialSeed = 2.0f;
+	waveParams.SeedIter = 4.1f;
+	waveParams.SpeedRamp = 1.07f;
+
+	FftOceanParams fftParams{};
+	fftParams.Spectrum = OceanSpectrumType::JONSWAP;
+	fftParams.Resolution = 256;
+	fftParams.TileSize = 256.0f;
+	fftParams.WindSpeed = 15.0f;
+	fftParams.WindDirection = glm::vec2(1.0f, 0.4f);
+	fftParams.Amplitude = 1.0f;
+	fftParams.Fetch = 100000.0f;
+	fftParams.PeakEnhancement = 3.3f;
+	fftParams.Choppiness = 1.0f;
+	fftParams.SmallWaveCutoff = 0.1f;
+	fftParams.Seed = 1337;
+	ocean_init(&s_Ocean, waveParams, fftParams, OCEAN_MAX_CASCADES);
+
 	Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-	set_uniform_float(pShader, "uSpeed", 1.0f);
-	set_uniform_float(pShader, "uSteepness", 0.9);
-	set_uniform_int(pShader, "uWaveCount", 300);
-	set_uniform_float(pShader, "uTime", glfwGetTime());	
-	set_uniform_float(pShader, "uFrequency", 0.125f);	
-	set_uniform_float(pShader, "uAmplitude", 1.0f);	
-	set_uniform_float(pShader, "uPersistance", 0.83f);	
-	set_uniform_float(pShader, "uLacunarity", 1.17f);
+	ocean_write_to_shader(&s_Ocean, pShader);
+	// The per-octave wave constants live in the wave table buffer, rebuilt by ocean_set_wave_params
+	set_uniform_float(pShader, "uAmplitude", waveParams.Amplitude);	
+
+	_write_ocean_look(pShader);
 
-	set_uniform_float(pShader, "uInitialSeed", 2);	
-	set_uniform_float(pShader, "uSeedIter", 4.1f);	
+	shader_variants_init(&s_OceanVariants, pShader, "res/shaders/basic_shader.vert", "res/shaders/basic_shader.frag");
 
-	set_uniform_float(pShader, "uSpeedRamp", 1.07f);	
+	const std::vector<ShaderDefine> depthOnlyDefines = { { "OCEAN_DEPTH_ONLY", 1 } };
+	create_shader(&s_OceanDepthShader, "res/shaders/basic_shader.vert", "res/shaders/depth_only.frag", depthOnlyDefines);
+	shader_variants_init(&s_OceanDepthVariants, &s_OceanDepthShader, "res/shaders/basic_shader.vert", "res/shaders/depth_only.frag", depthOnlyDefines);
+	scene_renderer_set_material_depth_shader(oceanModel.p_MaterialHandles[0], &s_OceanDepthShader);
+
+	instantiate_entity(&scene, sphereEntity);
+	// ^^^ ----------------------------
+#pragma endregion
+
+#pragma region BUOYS_DEFINITION
+	// vvv ----------------------------
+	Model* pBuoyModel = al_get_model_ptr(ModelName::wooden_sphere);
 
-	set_uniform_vec3(pShader, "uFoamColor", glm::vec3(1.0f));
-	set_uniform_float(pShader, "uFoamThreshold", 0.9f);
-	set_uniform_float(pShader, "uFoamHardness", 0.5f);
-	set_uniform_float(pShader, "uFoamIntensity", 2.0f);
-	set_uniform_float(pShader, "uFoamDistanceFade", 1000.0f);
+	Material buoyMat;
+	buoyMat.Ambient = glm::vec3(1.0f, 0.45f, 0.1f);
+	buoyMat.Specular = glm::vec3(0.5f);
+	buoyMat.Diffuse = glm::vec3(1.0f, 0.45f, 0.1f);
+	buoyMat.Shininess = 32.0f;
+	buoyMat.Shader = al_get_shader_handle(ShaderName::prop_shader);
+	buoyMat.AlbedoMap = al_get_texture_handle(TextureName::point_light);
 
-	set_uniform_vec3(pShader, "uSeaColor", glm::vec3(0.01f, 0.05f, 0.05f));
-	set_uniform_vec3(pShader, "uSeaColorSurface", glm::vec3(0.01f, 0.05f, 0.05f));
+	pBuoyModel->p_MaterialHandles = (MaterialHandle*)CE_MALLOC(sizeof(MaterialHandle));
+	pBuoyModel->p_MaterialHandles[0] = ah_register_material(&buoyMat);
+	pBuoyModel->MaterialCount = 1;
 
-	set_uniform_float(pShader, "uFogDistance", 500.0f);
+	glm::vec3 buoyExtent = pBuoyModel->BoundsMax - pBuoyModel->BoundsMin;
+	float buoyScale = BUOY_SIZE / glm::max(glm::max(buoyExtent.x, buoyExtent.y), glm::max(buoyExtent.z, 1e-4f));
 
-	instantiate_entity(&scene, &sphereEntity);
+	buoyancy_init(&s_Buoyancy, &s_Ocean);
+
+	for (int i = 0; i < BUOY_COUNT; i++)
+	{
+		Entity buoy;
+		buoy.meshRendererData.ModelHandle = al_get_model_handle(ModelName::wooden_sphere);
+		buoy.Position = glm::vec3(300.0f + (i % BUOYS_PER_ROW) * BUOY_SPACING, 2.0f, 340.0f + (i / BUOYS_PER_ROW) * BUOY_SPACING);
+		buoy.Rotation = glm::vec3(0.0f);
+		buoy.Scale = glm::vec3(buoyScale);
+
+		EntityHandle buoyHandle = instantiate_entity(&scene, buoy);
+		buoyancy_add_body(&s_Buoyancy, &scene.Entities, buoyHandle, pBuoyModel, BUOY_DENSITY);
+	}
 	// ^^^ ----------------------------
 #pragma endregion
 
@@ -193,6 +353,10 @@ int main()
 			{
 				Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
 				set_uniform_float(pShader, "uAmplitude", val);
+
+				OceanWaveParams params = s_Ocean.Evaluator.Params;
+				params.Amplitude = val;
+				ocean_set_wave_params(&s_Ocean, params);
 			}
 	};
 
@@ -208,8 +372,9 @@ int main()
 		1.0f,
 		[](float val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-			set_uniform_float(pShader, "uSpeed", val);
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			params.Speed = val;
+			ocean_set_wave_params(&s_Ocean, params);
 		}
 	};
 
@@ -224,8 +389,9 @@ int main()
 		0.9f,
 		[](float val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-			set_uniform_float(pShader, "uSteepness", val);
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			params.Steepness = val;
+			ocean_set_wave_params(&s_Ocean, params);
 		}
 	};
 	imgui_add_component(&steepnessComp);
@@ -239,8 +405,9 @@ int main()
 		300,
 		[](int val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-			set_uniform_int(pShader, "uWaveCount", val);
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			params.WaveCount = val;
+			ocean_set_wave_params(&s_Ocean, params);
 		}
 	};
 	imgui_add_component(&waveCountComp);
@@ -254,8 +421,9 @@ int main()
 		0.125f,
 		[](float val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-			set_uniform_float(pShader, "uFrequency", val);
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			params.Frequency = val;
+			ocean_set_wave_params(&s_Ocean, params);
 		}
 	};
 	imgui_add_component(&frequencyComp);
@@ -269,8 +437,9 @@ int main()
 		0.83f,
 		[](float val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-			set_uniform_float(pShader, "uPersistance", val);
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			params.Persistance = val;
+			ocean_set_wave_params(&s_Ocean, params);
 		}
 	};
 	imgui_add_component(&persistanceComp);
@@ -284,8 +453,9 @@ int main()
 		1.17f,
 		[](float val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-			set_uniform_float(pShader, "uLacunarity", val);
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			params.Lacunarity = val;
+			ocean_set_wave_params(&s_Ocean, params);
 		}
 	};
 	imgui_add_component(&lacunarityComp);
@@ -299,8 +469,9 @@ int main()
 		2.0f,
 		[](float val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-			set_uniform_float(pShader, "uInitialSeed", val);
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			params.InitialSeed = val;
+			ocean_set_wave_params(&s_Ocean, params);
 		}
 	};
 	imgui_add_component(&initialSeedComp);
@@ -314,8 +485,9 @@ int main()
 		4.1f,
 		[](float val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-			set_uniform_float(pShader, "uSeedIter", val);
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			params.SeedIter = val;
+			ocean_set_wave_params(&s_Ocean, params);
 		}
 	};
 	imgui_add_component(&seedIterComp);
@@ -329,11 +501,246 @@ int main()
 		1.07f,
 		[](float val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
-			set_uniform_float(pShader, "uSpeedRamp", val);
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			params.SpeedRamp = val;
+			ocean_set_wave_params(&s_Ocean, params);
 		}
 	};
 	imgui_add_component(&speedRampComp);
+	ImGuiComponent simulationTypeComp{};
+	simulationTypeComp.Name = "Simulation";
+	simulationTypeComp.Type = ImGuiComponentType::Combo;
+	simulationTypeComp.Data = ComboComponent{
+		{ "Gerstner", "FFT" },
+		(int)OceanSimulationType::Gerstner,
+		[](int val)
+		{
+			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
+			ocean_set_simulation_type(&s_Ocean, (OceanSimulationType)val);
+			ocean_write_to_shader(&s_Ocean, pShader);
+		}
+	};
+	imgui_add_component(&simulationTypeComp);
+
+	ImGuiComponent oceanMeshTypeComp{};
+	oceanMeshTypeComp.Name = "Ocean mesh";
+	oceanMeshTypeComp.Type = ImGuiComponentType::Combo;
+	oceanMeshTypeComp.Data = ComboComponent{
+		{ "Grid", "CDLOD", "Clipmap", "Projected grid" },
+		(int)OceanMeshType::CDLOD,
+		[](int val)
+		{
+			ocean_mesh_set_type(&s_OceanMesh, (OceanMeshType)val);
+		}
+	};
+	imgui_add_component(&oceanMeshTypeComp);
+
+	ImGuiComponent oceanMeshStatsComp{};
+	oceanMeshStatsComp.Name = "Ocean vertices / triangles";
+	oceanMeshStatsComp.Type = ImGuiComponentType::Text;
+	oceanMeshStatsComp.Data = TextComponent{
+		[]()
+		{
+			return std::to_string(s_OceanMesh.VertexCount) + " / " + std::to_string(s_OceanMesh.TriangleCount);
+		}
+	};
+	imgui_add_component(&oceanMeshStatsComp);
+
+	ImGuiComponent compactVerticesComp{};
+	compactVerticesComp.Name = "Compact ocean vertices";
+	compactVerticesComp.Type = ImGuiComponentType::Bool;
+	compactVerticesComp.Data = BoolComponent{
+		true,
+		[](bool val)
+		{
+			ocean_mesh_set_compact_vertices(&s_OceanMesh, val);
+		}
+	};
+	imgui_add_component(&compactVerticesComp);
+
+	ImGuiComponent oceanMeshMemoryComp{};
+	oceanMeshMemoryComp.Name = "Ocean mesh memory";
+	oceanMeshMemoryComp.Type = ImGuiComponentType::Text;
+	oceanMeshMemoryComp.Data = TextComponent{
+		[]()
+		{
+			return std::to_string(s_OceanMesh.VertexBytes / 1024) + " KB vertices / " + std::to_string(s_OceanMesh.IndexBytes / 1024) + " KB indices";
+		}
+	};
+	imgui_add_component(&oceanMeshMemoryComp);
+
+	ImGuiComponent meshBenchmarkComp{};
+	meshBenchmarkComp.Name = "Benchmark ocean mesh";
+	meshBenchmarkComp.Type = ImGuiComponentType::Button;
+	meshBenchmarkComp.Data = ButtonComponent{
+		[]()
+		{
+			s_MeshBenchmarkRequested = true;
+		}
+	};
+	imgui_add_component(&meshBenchmarkComp);
+
+	ImGuiComponent fftSpectrumComp{};
+	fftSpectrumComp.Name = "FFT Spectrum";
+	fftSpectrumComp.Type = ImGuiComponentType::Combo;
+	fftSpectrumComp.Data = ComboComponent{
+		{ "Phillips", "JONSWAP" },
+		(int)fftParams.Spectrum,
+		[](int val)
+		{
+			FftOceanParams params = s_Ocean.FftParams;
+			params.Spectrum = (OceanSpectrumType)val;
+			ocean_set_fft_params(&s_Ocean, params);
+		}
+	};
+	imgui_add_component(&fftSpectrumComp);
+
+	ImGuiComponent fftResolutionComp{};
+	fftResolutionComp.Name = "FFT Resolution";
+	fftResolutionComp.Type = ImGuiComponentType::Combo;
+	fftResolutionComp.Data = ComboComponent{
+		{ "256", "512", "1024" },
+		0,
+		[](int val)
+		{
+			FftOceanParams params = s_Ocean.FftParams;
+			params.Resolution = 256u << val;
+			ocean_set_fft_params(&s_Ocean, params);
+		}
+	};
+	imgui_add_component(&fftResolutionComp);
+
+	ImGuiComponent fftCascadeCountComp{};
+	fftCascadeCountComp.Name = "FFT Cascades";
+	fftCascadeCountComp.Type = ImGuiComponentType::Int;
+	fftCascadeCountComp.Data = IntComponent{
+		1,
+		OCEAN_MAX_CASCADES,
+		OCEAN_MAX_CASCADES,
+		[](int val)
+		{
+			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
+			ocean_set_cascade_count(&s_Ocean, val);
+			ocean_write_to_shader(&s_Ocean, pShader);
+		}
+	};
+	imgui_add_component(&fftCascadeCountComp);
+
+	ImGuiComponent fftTileSizeComp{};
+	fftTileSizeComp.Name = "FFT TileSize";
+	fftTileSizeComp.Type = ImGuiComponentType::Float;
+	fftTileSizeComp.Data = FloatComponent{
+		16.0f,
+		1024.0f,
+		fftParams.TileSize,
+		[](float val)
+		{
+			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
+			FftOceanParams params = s_Ocean.FftParams;
+			params.TileSize = val;
+			ocean_set_fft_params(&s_Ocean, params);
+			ocean_write_to_shader(&s_Ocean, pShader);
+		}
+	};
+	imgui_add_component(&fftTileSizeComp);
+
+	ImGuiComponent fftWindSpeedComp{};
+	fftWindSpeedComp.Name = "FFT WindSpeed";
+	fftWindSpeedComp.Type = ImGuiComponentType::Float;
+	fftWindSpeedComp.Data = FloatComponent{
+		0.5f,
+		40.0f,
+		fftParams.WindSpeed,
+		[](float val)
+		{
+			FftOceanParams params = s_Ocean.FftParams;
+			params.WindSpeed = val;
+			ocean_set_fft_params(&s_Ocean, params);
+		}
+	};
+	imgui_add_component(&fftWindSpeedComp);
+
+	ImGuiComponent fftWindDirectionComp{};
+	fftWindDirectionComp.Name = "FFT WindDirection";
+	fftWindDirectionComp.Type = ImGuiComponentType::Vec2;
+	fftWindDirectionComp.Data = Vec2Component{
+		glm::vec2(-1.0f),
+		glm::vec2(1.0f),
+		fftParams.WindDirection,
+		[](glm::vec2 val)
+		{
+			if (glm::length(val) < 1e-4f) return;
+			FftOceanParams params = s_Ocean.FftParams;
+			params.WindDirection = val;
+			ocean_set_fft_params(&s_Ocean, params);
+		}
+	};
+	imgui_add_component(&fftWindDirectionComp);
+
+	ImGuiComponent fftAmplitudeComp{};
+	fftAmplitudeComp.Name = "FFT Amplitude";
+	fftAmplitudeComp.Type = ImGuiComponentType::Float;
+	fftAmplitudeComp.Data = FloatComponent{
+		0.0f,
+		10.0f,
+		fftParams.Amplitude,
+		[](float val)
+		{
+			FftOceanParams params = s_Ocean.FftParams;
+			params.Amplitude = val;
+			ocean_set_fft_params(&s_Ocean, params);
+		}
+	};
+	imgui_add_component(&fftAmplitudeComp);
+
+	ImGuiComponent fftChoppinessComp{};
+	fftChoppinessComp.Name = "FFT Choppiness";
+	fftChoppinessComp.Type = ImGuiComponentType::Float;
+	fftChoppinessComp.Data = FloatComponent{
+		0.0f,
+		3.0f,
+		fftParams.Choppiness,
+		[](float val)
+		{
+			FftOceanParams params = s_Ocean.FftParams;
+			params.Choppiness = val;
+			ocean_set_fft_params(&s_Ocean, params);
+		}
+	};
+	imgui_add_component(&fftChoppinessComp);
+
+	ImGuiComponent fftFetchComp{};
+	fftFetchComp.Name = "FFT Fetch (km)";
+	fftFetchComp.Type = ImGuiComponentType::Float;
+	fftFetchComp.Data = FloatComponent{
+		1.0f,
+		1000.0f,
+		fftParams.Fetch / 1000.0f,
+		[](float val)
+		{
+			FftOceanParams params = s_Ocean.FftParams;
+			params.Fetch = val * 1000.0f;
+			ocean_set_fft_params(&s_Ocean, params);
+		}
+	};
+	imgui_add_component(&fftFetchComp);
+
+	ImGuiComponent fftPeakEnhancementComp{};
+	fftPeakEnhancementComp.Name = "FFT PeakEnhancement";
+	fftPeakEnhancementComp.Type = ImGuiComponentType::Float;
+	fftPeakEnhancementComp.Data = FloatComponent{
+		1.0f,
+		7.0f,
+		fftParams.PeakEnhancement,
+		[](float val)
+		{
+			FftOceanParams params = s_Ocean.FftParams;
+			params.PeakEnhancement = val;
+			ocean_set_fft_params(&s_Ocean, params);
+		}
+	};
+	imgui_add_component(&fftPeakEnhancementComp);
+
 #pragma region ADD_VEC2_VEC3_COLOR
 
 	ImGuiComponent dirLightDirComp{};
@@ -345,9 +752,8 @@ int main()
 		directionalLight.Direction,
 		[&directionalLight](glm::vec3 val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
+			// Reaches the LightData block with the frame data
 			directionalLight.Direction = val;
-			set_uniform_vec3(pShader, "uDirectionalLight.Direction", val);
 		}
 	};
 	imgui_add_component(&dirLightDirComp);
@@ -359,9 +765,8 @@ int main()
 		directionalLight.DiffuseColor,
 		[&directionalLight](glm::vec3 val)
 		{
-			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
+			// Reaches the LightData block with the frame data
 			directionalLight.DiffuseColor = val;
-			set_uniform_vec3(pShader, "uDirectionalLight.DiffuseColor", val);
 		}
 	};
 	imgui_add_component(&dirLightColorComp);
@@ -374,9 +779,10 @@ int main()
 	foamThresholdComp.Data = FloatComponent{
 		0.0f,
 		1.0f,
-		0.9f,
+		s_OceanLook.FoamThreshold,
 		[](float val)
 		{
+			s_OceanLook.FoamThreshold = val;
 			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
 			set_uniform_float(pShader, "uFoamThreshold", val);
 		}
@@ -389,9 +795,10 @@ int main()
 	foamHardnessComp.Data = FloatComponent{
 		0.0f,
 		1.0f,
-		0.5f,
+		s_OceanLook.FoamHardness,
 		[](float val)
 		{
+			s_OceanLook.FoamHardness = val;
 			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
 			set_uniform_float(pShader, "uFoamHardness", val);
 		}
@@ -404,9 +811,10 @@ int main()
 	foamIntensityComp.Data = FloatComponent{
 		0.0f,
 		10.0f,
-		2.0f,
+		s_OceanLook.FoamIntensity,
 		[](float val)
 		{
+			s_OceanLook.FoamIntensity = val;
 			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
 			set_uniform_float(pShader, "uFoamIntensity", val);
 		}
@@ -419,9 +827,10 @@ int main()
 	foamDistanceFadeComp.Data = FloatComponent{
 		0.0f,
 		1000.0f,
-		1000.0f,
+		s_OceanLook.FoamDistanceFade,
 		[](float val)
 		{
+			s_OceanLook.FoamDistanceFade = val;
 			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
 			set_uniform_float(pShader, "uFoamDistanceFade", val);
 		}
@@ -432,9 +841,10 @@ int main()
 	foamColorComp.Name = "FoamColor";
 	foamColorComp.Type = ImGuiComponentType::Color;
 	foamColorComp.Data = ColorComponent{
-		glm::vec3(1.0f, 1.0f, 1.0f),
-		[&directionalLight](glm::vec3 val)
+		s_OceanLook.FoamColor,
+		[](glm::vec3 val)
 		{
+			s_OceanLook.FoamColor = val;
 			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
 			set_uniform_vec3(pShader, "uFoamColor", val);
 		}
@@ -445,9 +855,10 @@ int main()
 	seaColorComp.Name = "OceanColor";
 	seaColorComp.Type = ImGuiComponentType::Color;
 	seaColorComp.Data = ColorComponent{
-		glm::vec3(0.01f, 0.05f, 0.05f),
-		[&directionalLight](glm::vec3 val)
+		s_OceanLook.SeaColor,
+		[](glm::vec3 val)
 		{
+			s_OceanLook.SeaColor = val;
 			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
 			set_uniform_vec3(pShader, "uSeaColor", val);
 		}
@@ -458,9 +869,10 @@ int main()
 	seaColorSurfaceComp.Name = "OceanColorSurface";
 	seaColorSurfaceComp.Type = ImGuiComponentType::Color;
 	seaColorSurfaceComp.Data = ColorComponent{
-		glm::vec3(0.01f, 0.05f, 0.05f),
-		[&directionalLight](glm::vec3 val)
+		s_OceanLook.SeaColorSurface,
+		[](glm::vec3 val)
 		{
+			s_OceanLook.SeaColorSurface = val;
 			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
 			set_uniform_vec3(pShader, "uSeaColorSurface", val);
 		}
@@ -473,14 +885,223 @@ int main()
 	fogDistanceFadeComp.Data = FloatComponent{
 		0.0f,
 		1000.0f,
-		500.0f,
+		s_OceanLook.FogDistance,
 		[](float val)
 		{
+			s_OceanLook.FogDistance = val;
 			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
 			set_uniform_float(pShader, "uFogDistance", val);
 		}
 	};
 	imgui_add_component(&fogDistanceFadeComp);
+
+	ImGuiComponent evaluatorBenchmarkComp{};
+	evaluatorBenchmarkComp.Name = "Benchmark CPU evaluator";
+	evaluatorBenchmarkComp.Type = ImGuiComponentType::Button;
+	evaluatorBenchmarkComp.Data = ButtonComponent{
+		[]()
+		{
+			ocean_evaluator_benchmark(&s_Ocean.Evaluator, 1 << 20);
+		}
+	};
+	imgui_add_component(&evaluatorBenchmarkComp);
+
+	ImGuiComponent queryBenchmarkComp{};
+	queryBenchmarkComp.Name = "Benchmark height queries";
+	queryBenchmarkComp.Type = ImGuiComponentType::Button;
+	queryBenchmarkComp.Data = ButtonComponent{
+		[]()
+		{
+			ocean_query_benchmark(&s_Ocean, 1 << 16);
+		}
+	};
+	imgui_add_component(&queryBenchmarkComp);
+
+	ImGuiComponent octaveLodComp{};
+	octaveLodComp.Name = "Octave LOD";
+	octaveLodComp.Type = ImGuiComponentType::Bool;
+	octaveLodComp.Data = BoolComponent{
+		true,
+		[](bool val)
+		{
+			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
+			ocean_set_octave_lod(&s_Ocean, val);
+			ocean_write_to_shader(&s_Ocean, pShader);
+		}
+	};
+	imgui_add_component(&octaveLodComp);
+
+	ImGuiComponent lodBenchmarkComp{};
+	lodBenchmarkComp.Name = "Benchmark octave LOD";
+	lodBenchmarkComp.Type = ImGuiComponentType::Button;
+	lodBenchmarkComp.Data = ButtonComponent{
+		[]()
+		{
+			s_LodBenchmarkRequested = true;
+		}
+	};
+	imgui_add_component(&lodBenchmarkComp);
+
+	ImGuiComponent octaveSplitComp{};
+	octaveSplitComp.Name = "Octave split";
+	octaveSplitComp.Type = ImGuiComponentType::Bool;
+	octaveSplitComp.Data = BoolComponent{
+		true,
+		[](bool val)
+		{
+			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
+			ocean_set_octave_split(&s_Ocean, val, s_Ocean.GeometricOctaves);
+			ocean_write_to_shader(&s_Ocean, pShader);
+		}
+	};
+	imgui_add_component(&octaveSplitComp);
+
+	ImGuiComponent geometricOctavesComp{};
+	geometricOctavesComp.Name = "Geometric octaves";
+	geometricOctavesComp.Type = ImGuiComponentType::Int;
+	geometricOctavesComp.Data = IntComponent{
+		0,
+		128,
+		OCEAN_DEFAULT_GEOMETRIC_OCTAVES,
+		[](int val)
+		{
+			Shader* pShader = al_get_shader_ptr(ShaderName::basic_shader);
+			ocean_set_octave_split(&s_Ocean, s_Ocean.OctaveSplit, (unsigned int)val);
+			ocean_write_to_shader(&s_Ocean, pShader);
+		}
+	};
+	imgui_add_component(&geometricOctavesComp);
+
+	ImGuiComponent splitBenchmarkComp{};
+	splitBenchmarkComp.Name = "Benchmark octave split";
+	splitBenchmarkComp.Type = ImGuiComponentType::Button;
+	splitBenchmarkComp.Data = ButtonComponent{
+		[]()
+		{
+			s_SplitBenchmarkRequested = true;
+		}
+	};
+	imgui_add_component(&splitBenchmarkComp);
+
+	ImGuiComponent foamComp{};
+	foamComp.Name = "Foam";
+	foamComp.Type = ImGuiComponentType::Bool;
+	foamComp.Data = BoolComponent{
+		true,
+		[](bool val)
+		{
+			s_Foam = val;
+			set_uniform_int(al_get_shader_ptr(ShaderName::basic_shader), "uFoam", val ? 1 : 0);
+		}
+	};
+	imgui_add_component(&foamComp);
+
+	ImGuiComponent fogComp{};
+	fogComp.Name = "Fog";
+	fogComp.Type = ImGuiComponentType::Bool;
+	fogComp.Data = BoolComponent{
+		true,
+		[](bool val)
+		{
+			s_Fog = val;
+			set_uniform_int(al_get_shader_ptr(ShaderName::basic_shader), "uFog", val ? 1 : 0);
+		}
+	};
+	imgui_add_component(&fogComp);
+
+	ImGuiComponent specializedShaderComp{};
+	specializedShaderComp.Name = "Specialized ocean shader";
+	specializedShaderComp.Type = ImGuiComponentType::Bool;
+	specializedShaderComp.Data = BoolComponent{
+		true,
+		[](bool val)
+		{
+			s_SpecializedOceanShader = val;
+		}
+	};
+	imgui_add_component(&specializedShaderComp);
+
+	ImGuiComponent variantBenchmarkComp{};
+	variantBenchmarkComp.Name = "Benchmark shader variants";
+	variantBenchmarkComp.Type = ImGuiComponentType::Button;
+	variantBenchmarkComp.Data = ButtonComponent{
+		[]()
+		{
+			s_VariantBenchmarkRequested = true;
+		}
+	};
+	imgui_add_component(&variantBenchmarkComp);
+
+	ImGuiComponent depthPrepassComp{};
+	depthPrepassComp.Name = "Ocean depth pre-pass";
+	depthPrepassComp.Type = ImGuiComponentType::Bool;
+	depthPrepassComp.Data = BoolComponent{
+		false,
+		[](bool val)
+		{
+			scene_renderer_set_depth_prepass(val);
+		}
+	};
+	imgui_add_component(&depthPrepassComp);
+
+	ImGuiComponent depthPrepassBenchmarkComp{};
+	depthPrepassBenchmarkComp.Name = "Benchmark depth pre-pass (steep sea)";
+	depthPrepassBenchmarkComp.Type = ImGuiComponentType::Button;
+	depthPrepassBenchmarkComp.Data = ButtonComponent{
+		[]()
+		{
+			s_DepthPrepassBenchmarkRequested = true;
+		}
+	};
+	imgui_add_component(&depthPrepassBenchmarkComp);
+
+	ImGuiComponent uniformStatsComp{};
+	uniformStatsComp.Name = "Uniform location queries saved / frame";
+	uniformStatsComp.Type = ImGuiComponentType::Text;
+	uniformStatsComp.Data = TextComponent{
+		[]()
+		{
+			return std::to_string(s_FrameUniformStats.TableLookups + s_FrameUniformStats.HandleWrites) + " ("
+				+ std::to_string(s_FrameUniformStats.TableLookups) + " by name, " + std::to_string(s_FrameUniformStats.HandleWrites) + " by handle), "
+				+ std::to_string(s_FrameUniformStats.DriverLookups) + " left";
+		}
+	};
+	imgui_add_component(&uniformStatsComp);
+
+	ImGuiComponent stateStatsComp{};
+	stateStatsComp.Name = "GL state calls / frame";
+	stateStatsComp.Type = ImGuiComponentType::Text;
+	stateStatsComp.Data = TextComponent{
+		[]()
+		{
+			return std::to_string(s_FrameStateStats.Issued) + " issued, " + std::to_string(s_FrameStateStats.Skipped) + " skipped";
+		}
+	};
+	imgui_add_component(&stateStatsComp);
+
+	ImGuiComponent drawStatsComp{};
+	drawStatsComp.Name = "Scene draw calls / frame";
+	drawStatsComp.Type = ImGuiComponentType::Text;
+	drawStatsComp.Data = TextComponent{
+		[]()
+		{
+			return std::to_string(s_FrameDrawStats.DrawCalls) + " (" + std::to_string(s_FrameDrawStats.IndirectCommands) + " indirect commands)";
+		}
+	};
+	imgui_add_component(&drawStatsComp);
+
+	ImGuiComponent geometryHeapComp{};
+	geometryHeapComp.Name = "Geometry heap";
+	geometryHeapComp.Type = ImGuiComponentType::Text;
+	geometryHeapComp.Data = TextComponent{
+		[]()
+		{
+			GeometryHeapStats stats = geometry_heap_get_stats();
+			return std::to_string(stats.UsedBytes / 1024) + " / " + std::to_string(stats.CapacityBytes / 1024) + " KB in "
+				+ std::to_string(stats.PageCount) + " pages";
+		}
+	};
+	imgui_add_component(&geometryHeapComp);
 	
 #pragma endregion
 	// ^^^ ----------------------------
@@ -526,7 +1147,60 @@ int main()
 
 #pragma endregion
 
-		set_uniform_float(pShader, "uTime", glfwGetTime());		
+		// Settings changed through ImGui reach the specialized variant once the widget is released
+		bool specialized = s_SpecializedOceanShader && !imgui_is_editing();
+		_select_ocean_shader_variant(specialized ? _get_ocean_shader_defines() : std::vector<ShaderDefine>());
+
+		set_uniform_float(pShader, "uPixelAngle", 2.0f * tanf(glm::radians(camera.Fov) * 0.5f) / glm::max(get_renderer_data().ViewportSizePx.y, 1.0f));
+		ocean_update(&s_Ocean, glfwGetTime());
+		ocean_mesh_update(&s_OceanMesh, &s_Ocean, &camera, pShader);
+		buoyancy_update(&s_Buoyancy, (float)get_delta_time());
+
+		auto renderBenchmarkFrame = [&scene]()
+		{
+			renderer_prepare_frame();
+			scene_render(&scene);
+		};
+		// The octave LOD and split benchmarks toggle uniforms, compiled out of the specialized variant
+		if (s_LodBenchmarkRequested || s_SplitBenchmarkRequested)
+		{
+			_select_ocean_shader_variant({});
+		}
+		if (s_LodBenchmarkRequested)
+		{
+			s_LodBenchmarkRequested = false;
+			ocean_lod_benchmark(&s_Ocean, pShader, RENDER_BENCHMARK_FRAMES, renderBenchmarkFrame);
+		}
+		if (s_SplitBenchmarkRequested)
+		{
+			s_SplitBenchmarkRequested = false;
+			ocean_octave_split_benchmark(&s_Ocean, pShader, RENDER_BENCHMARK_FRAMES, renderBenchmarkFrame);
+		}
+		if (s_MeshBenchmarkRequested)
+		{
+			s_MeshBenchmarkRequested = false;
+			ocean_mesh_benchmark(&s_OceanMesh, &s_Ocean, &camera, pShader, RENDER_BENCHMARK_FRAMES, renderBenchmarkFrame);
+		}
+		if (s_VariantBenchmarkRequested)
+		{
+			s_VariantBenchmarkRequested = false;
+			_select_ocean_shader_variant({});
+			// Only basic_shader switches variant, the depth pass would no longer match it
+			bool depthPrepass = scene_renderer_is_depth_prepass_enabled();
+			scene_renderer_set_depth_prepass(false);
+			shader_variants_benchmark(&s_OceanVariants, _get_ocean_shader_defines(), RENDER_BENCHMARK_FRAMES, renderBenchmarkFrame);
+			scene_renderer_set_depth_prepass(depthPrepass);
+		}
+		if (s_DepthPrepassBenchmarkRequested)
+		{
+			s_DepthPrepassBenchmarkRequested = false;
+			OceanWaveParams params = s_Ocean.Evaluator.Params;
+			OceanWaveParams steepParams = params;
+			steepParams.Steepness = DEPTH_PREPASS_BENCHMARK_STEEPNESS;
+			ocean_set_wave_params(&s_Ocean, steepParams);
+			scene_renderer_depth_prepass_benchmark(RENDER_BENCHMARK_FRAMES, renderBenchmarkFrame);
+			ocean_set_wave_params(&s_Ocean, params);
+		}
 
 		renderer_prepare_frame();
 
@@ -534,9 +1208,22 @@ int main()
 
 		imgui_finish_render();
 		renderer_finish_render();
+
+		s_FrameUniformStats = shader_get_uniform_stats();
+		shader_reset_uniform_stats();
+		s_FrameStateStats = gl_state_get_stats();
+		gl_state_reset_stats();
+		s_FrameDrawStats = scene_renderer_get_draw_stats();
+		scene_renderer_reset_draw_stats();
 	}
 
-	
+	shader_variants_release(&s_OceanVariants);
+	scene_renderer_set_material_depth_shader(oceanModel.p_MaterialHandles[0], nullptr);
+	shader_variants_release(&s_OceanDepthVariants);
+	shader_delete_program(s_OceanDepthShader.ShaderProgram);
+	ocean_mesh_release(&s_OceanMesh);
+	ocean_release(&s_Ocean);
+	job_system_terminate();
 	window_terminate();
 	return 0;
 }
@@ -84,7 +84,8 @@ unsigned int INDICES_PLANE[] = {
 void create_mesh_grid(Mesh *pMesh, int nx, int nz)
 {
 	std::vector<Vertex> vertices(nx*nz);
-	std::vector<unsigned int> indices(vertices.size()+2);
+	std::vector<unsigned int> indices;
+	indices.reserve((nx - 1) * (nz - 1) * 6);
 
 	for(int x = 0; x < nx; ++x)
 	{
@@ -121,9 +122,7 @@ void create_mesh_grid(Mesh *pMesh, int nx, int nz)
         VertexAttribute{VertexAttributeType::FLOAT, 2}		// UV
     };
 
-	create_mesh(pMesh, vertexAttributes, 3, nullptr, vertices.size(), indices.data(), indices.size(), 1, GL_STATIC_DRAW);
-
-    vbo_set_data(pMesh->Vbo, vertices.data(), sizeof(Vertex) * vertices.size(), 0);
+	create_mesh(pMesh, vertexAttributes, 3, (float*)vertices.data(), vertices.size(), indices.data(), indices.size(), 1, GL_STATIC_DRAW);
 
     pMesh->Submeshes[0] = Submesh{ 0, (unsigned int)indices.size() };
 }
@@ -0,0 +1,477 @@
+#include "fft_ocean.h"
+
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <glm/geometric.hpp>
+#include "../core/job_system.h"
+
+#define GRAVITY 9.81f
+#define PI_F 3.14159265358979f
+#define PHILLIPS_ALPHA 0.0081f
+
+// Columns gathered together in the column pass of the 2D FFT (one cache line of complex floats)
+#define FFT_COLUMN_BLOCK 8
+
+// std::complex multiplication handles inf/nan cases through a library call, this one does not
+static inline FftComplex _cmul(const FftComplex& a, const FftComplex& b)
+{
+	return FftComplex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+static inline FftComplex _mul_i(const FftComplex& a)
+{
+	return FftComplex(-a.imag(), a.real());
+}
+
+static inline int _signed_index(unsigned int rIndex, unsigned int rN)
+{
+	return rIndex < rN / 2 ? (int)rIndex : (int)rIndex - (int)rN;
+}
+
+// ------------------------------------
+// FFT
+// ------------------------------------
+
+void fft_plan_create(FftPlan* rpPlan, unsigned int rN)
+{
+	rpPlan->N = rN;
+	rpPlan->Log2N = 0;
+	while ((1u << rpPlan->Log2N) < rN)
+	{
+		rpPlan->Log2N++;
+	}
+
+	rpPlan->Twiddles.resize(rN);
+	for (unsigned int j = 0; j < rN; j++)
+	{
+		double angle = 2.0 * 3.14159265358979323846 * (double)j / (double)rN;
+		rpPlan->Twiddles[j] = FftComplex((float)cos(angle), (float)sin(angle));
+	}
+
+	rpPlan->BitReverse.resize(rN);
+	for (unsigned int i = 0; i < rN; i++)
+	{
+		unsigned int reversed = 0;
+		for (unsigned int b = 0; b < rpPlan->Log2N; b++)
+		{
+			reversed |= ((i >> b) & 1u) << (rpPlan->Log2N - 1 - b);
+		}
+		rpPlan->BitReverse[i] = reversed;
+	}
+}
+
+void fft_inverse_1d(const FftPlan& rPlan, FftComplex* rpData)
+{
+	const unsigned int n = rPlan.N;
+
+	for (unsigned int i = 0; i < n; i++)
+	{
+		unsigned int j = rPlan.BitReverse[i];
+		if (i < j)
+		{
+			std::swap(rpData[i], rpData[j]);
+		}
+	}
+
+	unsigned int m = 1;
+
+	// Odd power of two: one radix-2 stage first, the rest are radix-4
+	if (rPlan.Log2N & 1u)
+	{
+		for (unsigned int i = 0; i < n; i += 2)
+		{
+			FftComplex a = rpData[i];
+			FftComplex b = rpData[i + 1];
+			rpData[i] = a + b;
+			rpData[i + 1] = a - b;
+		}
+		m = 2;
+	}
+
+	// After the base-2 bit reversal, a block of 4m holds the sub-transforms of
+	// residues 0, 2, 1, 3 (mod 4) in that order
+	while (m < n)
+	{
+		const unsigned int twiddleStride = n / (4 * m);
+		for (unsigned int base = 0; base < n; base += 4 * m)
+		{
+			FftComplex* p0 = rpData + base;
+			FftComplex* p1 = p0 + m;
+			FftComplex* p2 = p1 + m;
+			FftComplex* p3 = p2 + m;
+			for (unsigned int k = 0; k < m; k++)
+			{
+				FftComplex x0 = p0[k];
+				FftComplex t2 = _cmul(rPlan.Twiddles[2 * k * twiddleStride], p1[k]);
+				FftComplex t1 = _cmul(rPlan.Twiddles[k * twiddleStride], p2[k]);
+				FftComplex t3 = _cmul(rPlan.Twiddles[3 * k * twiddleStride], p3[k]);
+
+				FftComplex a0 = x0 + t2;
+				FftComplex a1 = x0 - t2;
+				FftComplex b0 = t1 + t3;
+				FftComplex b1 = _mul_i(t1 - t3);
+
+				p0[k] = a0 + b0;
+				p1[k] = a1 + b1;
+				p2[k] = a0 - b0;
+				p3[k] = a1 - b1;
+			}
+		}
+		m *= 4;
+	}
+}
+
+void fft_inverse_2d(const FftPlan& rPlan, FftComplex** rpBuffers, unsigned int rBufferCount)
+{
+	const unsigned int n = rPlan.N;
+
+	// Rows: contiguous
+	job_parallel_for(n * rBufferCount, 16, [&](unsigned int rBegin, unsigned int rEnd)
+	{
+		for (unsigned int row = rBegin; row < rEnd; row++)
+		{
+			FftComplex* buffer = rpBuffers[row / n];
+			fft_inverse_1d(rPlan, buffer + (size_t)(row % n) * n);
+		}
+	});
+
+	// Columns: gather a block of adjacent columns so every row read touches a full cache line
+	const unsigned int blockCount = std::max(1u, n / FFT_COLUMN_BLOCK);
+	const unsigned int blockWidth = std::min(n, (unsigned int)FFT_COLUMN_BLOCK);
+	job_parallel_for(blockCount * rBufferCount, 1, [&](unsigned int rBegin, unsigned int rEnd)
+	{
+		thread_local std::vector<FftComplex> s_Scratch;
+		s_Scratch.resize((size_t)n * FFT_COLUMN_BLOCK);
+
+		for (unsigned int block = rBegin; block < rEnd; block++)
+		{
+			FftComplex* buffer = rpBuffers[block / blockCount];
+			unsigned int firstColumn = (block % blockCount) * blockWidth;
+
+			for (unsigned int row = 0; row < n; row++)
+			{
+				const FftComplex* src = buffer + (size_t)row * n + firstColumn;
+				for (unsigned int c = 0; c < blockWidth; c++)
+				{
+					s_Scratch[(size_t)c * n + row] = src[c];
+				}
+			}
+
+			for (unsigned int c = 0; c < blockWidth; c++)
+			{
+				fft_inverse_1d(rPlan, s_Scratch.data() + (size_t)c * n);
+			}
+
+			for (unsigned int row = 0; row < n; row++)
+			{
+				FftComplex* dst = buffer + (size_t)row * n + firstColumn;
+				for (unsigned int c = 0; c < blockWidth; c++)
+				{
+					dst[c] = s_Scratch[(size_t)c * n + row];
+				}
+			}
+		}
+	});
+}
+
+// ------------------------------------
+// Spectrum
+// ------------------------------------
+
+static float _directional_spread(const FftOceanParams& rParams, glm::vec2 rKDir)
+{
+	glm::vec2 wind = glm::normalize(rParams.WindDirection);
+	float cosTheta = glm::dot(rKDir, wind);
+	float spread = cosTheta * cosTheta;
+	// Waves travelling against the wind are mostly suppressed
+	if (cosTheta < 0.0f)
+	{
+		spread *= 0.07f;
+	}
+	return spread;
+}
+
+static float _phillips(const FftOceanParams& rParams, glm::vec2 rK, float rKLength)
+{
+	float largestWave = rParams.WindSpeed * rParams.WindSpeed / GRAVITY;
+	float kl = rKLength * largestWave;
+	float k2 = rKLength * rKLength;
+
+	return PHILLIPS_ALPHA * expf(-1.0f / (kl * kl)) / (k2 * k2) * _directional_spread(rParams, rK / rKLength);
+}
+
+static float _jonswap(const FftOceanParams& rParams, glm::vec2 rK, float rKLength)
+{
+	float omega = sqrtf(GRAVITY * rKLength);
+	float dOmegaDk = GRAVITY / (2.0f * omega);
+
+	float windSpeed = std::max(rParams.WindSpeed, 0.01f);
+	float fetch = std::max(rParams.Fetch, 1.0f);
+	float alpha = 0.076f * powf(windSpeed * windSpeed / (fetch * GRAVITY), 0.22f);
+	float peakOmega = 22.0f * powf(GRAVITY * GRAVITY / (windSpeed * fetch), 1.0f / 3.0f);
+
+	float sigma = omega <= peakOmega ? 0.07f : 0.09f;
+	float delta = omega - peakOmega;
+	float r = expf(-(delta * delta) / (2.0f * sigma * sigma * peakOmega * peakOmega));
+	float peakRatio = peakOmega / omega;
+
+	float spectrum = alpha * GRAVITY * GRAVITY / powf(omega, 5.0f) * expf(-1.25f * peakRatio * peakRatio * peakRatio * peakRatio)
+		* powf(rParams.PeakEnhancement, r);
+
+	// S(w) -> S(kx, kz). Normalized cos^2 spreading
+	return spectrum * dOmegaDk / rKLength * (2.0f / PI_F) * _directional_spread(rParams, rK / rKLength);
+}
+
+static void _build_initial_spectrum(FftOcean* rpOcean)
+{
+	const FftOceanParams& params = rpOcean->Params;
+	const unsigned int n = params.Resolution;
+	const float deltaK = 2.0f * PI_F / params.TileSize;
+
+	rpOcean->H0.assign((size_t)n * n, FftComplex(0.0f));
+	rpOcean->H0MinusConj.assign((size_t)n * n, FftComplex(0.0f));
+	rpOcean->Omega.assign((size_t)n * n, 0.0f);
+
+	std::mt19937 generator(params.Seed);
+	auto gaussian = [&generator]()
+	{
+		// Box-Muller, written out so the result is the same on every standard library
+		float u1 = ((float)generator() + 1.0f) / 4294967296.0f;
+		float u2 = (float)generator() / 4294967296.0f;
+		return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * PI_F * u2);
+	};
+
+	for (unsigned int z = 0; z < n; z++)
+	{
+		for (unsigned int x = 0; x < n; x++)
+		{
+			size_t index = (size_t)z * n + x;
+			float xi = gaussian();
+			float eta = gaussian();
+
+			// Nyquist row/column have no symmetric counterpart, keep them empty so the packed fields stay real
+			if (x == n / 2 || z == n / 2)
+			{
+				continue;
+			}
+
+			glm::vec2 k = glm::vec2(_signed_index(x, n), _signed_index(z, n)) * deltaK;
+			float kLength = glm::length(k);
+			if (kLength < 1e-6f || kLength < params.MinWaveNumber || (params.MaxWaveNumber > 0.0f && kLength >= params.MaxWaveNumber))
+			{
+				continue;
+			}
+
+			float spectrum = params.Spectrum == OceanSpectrumType::JONSWAP ? _jonswap(params, k, kLength) : _phillips(params, k, kLength);
+			spectrum *= params.Amplitude * expf(-kLength * kLength * params.SmallWaveCutoff * params.SmallWaveCutoff);
+
+			float amplitude = 0.5f * sqrtf(std::max(spectrum, 0.0f)) * deltaK;
+			rpOcean->H0[index] = FftComplex(xi, eta) * amplitude;
+			rpOcean->Omega[index] = sqrtf(GRAVITY * kLength);
+		}
+	}
+
+	for (unsigned int z = 0; z < n; z++)
+	{
+		for (unsigned int x = 0; x < n; x++)
+		{
+			size_t minusIndex = (size_t)((n - z) % n) * n + ((n - x) % n);
+			rpOcean->H0MinusConj[(size_t)z * n + x] = std::conj(rpOcean->H0[minusIndex]);
+		}
+	}
+
+	rpOcean->SpectrumDirty = false;
+}
+
+// ------------------------------------
+// Ocean
+// ------------------------------------
+
+static void _allocate(FftOcean* rpOcean)
+{
+	unsigned int n = rpOcean->Params.Resolution;
+	size_t size = (size_t)n * n;
+
+	fft_plan_create(&rpOcean->Plan, n);
+	for (int i = 0; i < 3; i++)
+	{
+		rpOcean->Work[i].assign(size, FftComplex(0.0f));
+	}
+	rpOcean->Height.assign(size, 0.0f);
+	rpOcean->DisplacementX.assign(size, 0.0f);
+	rpOcean->DisplacementZ.assign(size, 0.0f);
+	rpOcean->SlopeX.assign(size, 0.0f);
+	rpOcean->SlopeZ.assign(size, 0.0f);
+}
+
+static unsigned int _valid_resolution(unsigned int rResolution)
+{
+	unsigned int n = FFT_OCEAN_MIN_RESOLUTION;
+	while (n < rResolution && n < FFT_OCEAN_MAX_RESOLUTION)
+	{
+		n <<= 1;
+	}
+	return n;
+}
+
+void fft_ocean_init(FftOcean* rpOcean, const FftOceanParams& rParams)
+{
+	rpOcean->Params = rParams;
+	rpOcean->Params.Resolution = _valid_resolution(rParams.Resolution);
+	rpOcean->Time = 0.0f;
+	_allocate(rpOcean);
+	_build_initial_spectrum(rpOcean);
+}
+
+void fft_ocean_set_params(FftOcean* rpOcean, const FftOceanParams& rParams)
+{
+	unsigned int previousResolution = rpOcean->Params.Resolution;
+	rpOcean->Params = rParams;
+	rpOcean->Params.Resolution = _valid_resolution(rParams.Resolution);
+	if (rpOcean->Params.Resolution != previousResolution)
+	{
+		_allocate(rpOcean);
+	}
+	rpOcean->SpectrumDirty = true;
+}
+
+void fft_ocean_update(FftOcean* rpOcean, float rTime)
+{
+	if (rpOcean->SpectrumDirty)
+	{
+		_build_initial_spectrum(rpOcean);
+	}
+	rpOcean->Time = rTime;
+
+	const unsigned int n = rpOcean->Params.Resolution;
+	const float deltaK = 2.0f * PI_F / rpOcean->Params.TileSize;
+
+	// h(k, t) and its derived spectra
+	job_parallel_for(n, 8, [&](unsigned int rBegin, unsigned int rEnd)
+	{
+		for (unsigned int z = rBegin; z < rEnd; z++)
+		{
+			float kz = _signed_index(z, n) * deltaK;
+			for (unsigned int x = 0; x < n; x++)
+			{
+				size_t index = (size_t)z * n + x;
+				float kx = _signed_index(x, n) * deltaK;
+				float kLength = sqrtf(kx * kx + kz * kz);
+
+				float phase = rpOcean->Omega[index] * rTime;
+				FftComplex rotation(cosf(phase), sinf(phase));
+				FftComplex h = _cmul(rpOcean->H0[index], rotation) + _cmul(rpOcean->H0MinusConj[index], std::conj(rotation));
+
+				FftComplex dx(0.0f), dz(0.0f);
+				if (kLength > 1e-6f)
+				{
+					// D = -i * k/|k| * h
+					FftComplex minusIH(h.imag(), -h.real());
+					dx = minusIH * (kx / kLength);
+					dz = minusIH * (kz / kLength);
+				}
+				FftComplex ih = _mul_i(h);
+				FftComplex sx = ih * kx;
+				FftComplex sz = ih * kz;
+
+				rpOcean->Work[0][index] = h + _mul_i(dx);
+				rpOcean->Work[1][index] = dz + _mul_i(sx);
+				rpOcean->Work[2][index] = sz;
+			}
+		}
+	});
+
+	FftComplex* buffers[3] = { rpOcean->Work[0].data(), rpOcean->Work[1].data(), rpOcean->Work[2].data() };
+	fft_inverse_2d(rpOcean->Plan, buffers, 3);
+
+	const float choppiness = rpOcean->Params.Choppiness;
+	job_parallel_for(n, 16, [&](unsigned int rBegin, unsigned int rEnd)
+	{
+		for (size_t index = (size_t)rBegin * n; index < (size_t)rEnd * n; index++)
+		{
+			rpOcean->Height[index] = rpOcean->Work[0][index].real();
+			rpOcean->DisplacementX[index] = choppiness * rpOcean->Work[0][index].imag();
+			rpOcean->DisplacementZ[index] = choppiness * rpOcean->Work[1][index].real();
+			rpOcean->SlopeX[index] = rpOcean->Work[1][index].imag();
+			rpOcean->SlopeZ[index] = rpOcean->Work[2][index].real();
+		}
+	});
+}
+
+// Four texels around a world position and their bilinear weights (periodic tile)
+typedef struct
+{
+	size_t Index[4];
+	float Weight[4];
+} _BilinearTaps;
+
+static _BilinearTaps _bilinear_taps(const FftOcean* rpOcean, float rX, float rZ)
+{
+	const unsigned int n = rpOcean->Params.Resolution;
+	const float texelsPerMeter = (float)n / rpOcean->Params.TileSize;
+
+	float u = rX * texelsPerMeter;
+	float v = rZ * texelsPerMeter;
+	float u0 = floorf(u);
+	float v0 = floorf(v);
+	float fu = u - u0;
+	float fv = v - v0;
+
+	unsigned int x0 = (unsigned int)(((long long)u0 % n + n) % n);
+	unsigned int z0 = (unsigned int)(((long long)v0 % n + n) % n);
+	unsigned int x1 = (x0 + 1) % n;
+	unsigned int z1 = (z0 + 1) % n;
+
+	_BilinearTaps taps;
+	taps.Index[0] = (size_t)z0 * n + x0;
+	taps.Index[1] = (size_t)z0 * n + x1;
+	taps.Index[2] = (size_t)z1 * n + x0;
+	taps.Index[3] = (size_t)z1 * n + x1;
+	taps.Weight[0] = (1.0f - fu) * (1.0f - fv);
+	taps.Weight[1] = fu * (1.0f - fv);
+	taps.Weight[2] = (1.0f - fu) * fv;
+	taps.Weight[3] = fu * fv;
+	return taps;
+}
+
+static inline float _bilinear(const _BilinearTaps& rTaps, const std::vector<float>& rMap)
+{
+	return rMap[rTaps.Index[0]] * rTaps.Weight[0] + rMap[rTaps.Index[1]] * rTaps.Weight[1]
+		+ rMap[rTaps.Index[2]] * rTaps.Weight[2] + rMap[rTaps.Index[3]] * rTaps.Weight[3];
+}
+
+void fft_ocean_add_displacement(const FftOcean* rpOcean, const float* rpX, const float* rpZ,
+	float* rpOutX, float* rpOutY, float* rpOutZ, size_t rCount)
+{
+	for (size_t i = 0; i < rCount; i++)
+	{
+		_BilinearTaps taps = _bilinear_taps(rpOcean, rpX[i], rpZ[i]);
+		rpOutX[i] += _bilinear(taps, rpOcean->DisplacementX);
+		rpOutY[i] += _bilinear(taps, rpOcean->Height);
+		rpOutZ[i] += _bilinear(taps, rpOcean->DisplacementZ);
+	}
+}
+
+void fft_ocean_add_slopes(const FftOcean* rpOcean, const float* rpX, const float* rpZ,
+	float* rpOutSlopeX, float* rpOutSlopeZ, size_t rCount)
+{
+	for (size_t i = 0; i < rCount; i++)
+	{
+		_BilinearTaps taps = _bilinear_taps(rpOcean, rpX[i], rpZ[i]);
+		rpOutSlopeX[i] += _bilinear(taps, rpOcean->SlopeX);
+		rpOutSlopeZ[i] += _bilinear(taps, rpOcean->SlopeZ);
+	}
+}
+
+void fft_ocean_sample_positions(const FftOcean* rpOcean, const float* rpX, const float* rpZ,
+	float* rpOutX, float* rpOutY, float* rpOutZ, size_t rCount)
+{
+	for (size_t i = 0; i < rCount; i++)
+	{
+		rpOutX[i] = rpX[i];
+		rpOutY[i] = 0.0f;
+		rpOutZ[i] = rpZ[i];
+	}
+	fft_ocean_add_displacement(rpOcean, rpX, rpZ, rpOutX, rpOutY, rpOutZ, rCount);
+}
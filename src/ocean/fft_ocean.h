@@ -0,0 +1,121 @@
+#ifndef FFT_OCEAN_H
+#define FFT_OCEAN_H
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+#include <glm/vec2.hpp>
+
+// Tessendorf spectral ocean. A periodic tile of TileSize meters is synthesized each frame on a
+// Resolution x Resolution grid with inverse 2D FFTs split across the job system.
+
+#define FFT_OCEAN_MIN_RESOLUTION 16
+#define FFT_OCEAN_MAX_RESOLUTION 1024
+
+enum class OceanSpectrumType
+{
+	Phillips = 0,
+	JONSWAP
+};
+
+typedef struct
+{
+	OceanSpectrumType Spectrum;
+	unsigned int Resolution;		// N, power of two
+	float TileSize;					// L, meters
+	float WindSpeed;				// m/s at 10 m
+	glm::vec2 WindDirection;
+	float Amplitude;				// Overall scale of the spectrum
+	float Fetch;					// JONSWAP: distance the wind has blown over water, meters
+	float PeakEnhancement;			// JONSWAP: gamma
+	float Choppiness;				// Horizontal displacement scale (lambda)
+	float SmallWaveCutoff;			// Waves shorter than this (meters) are damped
+	float MinWaveNumber;			// Band kept by this tile, rad/m. Lets several tiles (cascades)
+	float MaxWaveNumber;			// share one spectrum without counting a wave twice. 0 = no upper limit
+	unsigned int Seed;
+} FftOceanParams;
+
+typedef std::complex<float> FftComplex;
+
+typedef struct
+{
+	unsigned int N;
+	unsigned int Log2N;
+	std::vector<FftComplex> Twiddles;		// exp(+2*pi*i*j/N)
+	std::vector<unsigned int> BitReverse;
+} FftPlan;
+
+typedef struct
+{
+	FftOceanParams Params;
+	FftPlan Plan;
+
+	// Cached initial spectrum, only rebuilt when a parameter changes
+	bool SpectrumDirty;
+	std::vector<FftComplex> H0;				// h0(k)
+	std::vector<FftComplex> H0MinusConj;	// conj(h0(-k))
+	std::vector<float> Omega;				// Dispersion relation w(k)
+
+	// Packed spectra: two real fields per complex transform
+	// 0: height + i * displacement x, 1: displacement z + i * slope x, 2: slope z
+	std::vector<FftComplex> Work[3];
+
+	// Outputs for the current time, row major [z * N + x]
+	std::vector<float> Height;
+	std::vector<float> DisplacementX;
+	std::vector<float> DisplacementZ;
+	std::vector<float> SlopeX;
+	std::vector<float> SlopeZ;
+
+	float Time;
+} FftOcean;
+
+/// <summary>
+/// Allocates the buffers and builds the initial spectrum
+/// </summary>
+void fft_ocean_init(FftOcean* rpOcean, const FftOceanParams& rParams);
+
+/// <summary>
+/// Changes parameters. The h0 table (and the FFT plan if resolution changed) is rebuilt on the next update
+/// </summary>
+void fft_ocean_set_params(FftOcean* rpOcean, const FftOceanParams& rParams);
+
+/// <summary>
+/// Evolves the spectrum to rTime and writes height, choppy displacement and slope maps
+/// </summary>
+void fft_ocean_update(FftOcean* rpOcean, float rTime);
+
+/// <summary>
+/// Bilinearly samples the displaced surface for a batch of rest positions (periodic tile). Same output
+/// convention as ocean_evaluate_positions
+/// </summary>
+void fft_ocean_sample_positions(const FftOcean* rpOcean, const float* rpX, const float* rpZ,
+	float* rpOutX, float* rpOutY, float* rpOutZ, size_t rCount);
+
+/// <summary>
+/// Same as fft_ocean_sample_positions but adds the displacement (x, height, z) to the outputs,
+/// so several tiles can be accumulated
+/// </summary>
+void fft_ocean_add_displacement(const FftOcean* rpOcean, const float* rpX, const float* rpZ,
+	float* rpOutX, float* rpOutY, float* rpOutZ, size_t rCount);
+
+/// <summary>
+/// Adds the height slopes (dh/dx, dh/dz) at a batch of rest positions to the outputs
+/// </summary>
+void fft_ocean_add_slopes(const FftOcean* rpOcean, const float* rpX, const float* rpZ,
+	float* rpOutSlopeX, float* rpOutSlopeZ, size_t rCount);
+
+// FFT helpers
+void fft_plan_create(FftPlan* rpPlan, unsigned int rN);
+
+/// <summary>
+/// In-place inverse FFT (no 1/N scaling) of rN contiguous values. Radix-4 stages plus one radix-2 stage when log2(N) is odd
+/// </summary>
+void fft_inverse_1d(const FftPlan& rPlan, FftComplex* rpData);
+
+/// <summary>
+/// In-place inverse 2D FFT of rBufferCount N x N buffers, rows and columns split across the job system
+/// </summary>
+void fft_inverse_2d(const FftPlan& rPlan, FftComplex** rpBuffers, unsigned int rBufferCount);
+
+#endif // !FFT_OCEAN_H
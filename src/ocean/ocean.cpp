@@ -0,0 +1,658 @@
+#include "ocean.h"
+
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <glm/geometric.hpp>
+#include <glad/glad.h>
+#include "../renderer/gl_state_cache.h"
+#include <glm/gtc/packing.hpp>
+#include "../core/job_system.h"
+#include "../renderer/gpu_timer.h"
+
+// Tile size of each cascade relative to the first one. Not integer ratios, so the tiles
+// do not repeat in sync
+static const float s_CascadeScale[OCEAN_MAX_CASCADES] = { 1.0f, 0.2317f, 0.0531f };
+
+// A cascade starts at this multiple of its own fundamental wave number. The lowest
+// frequencies of a tile are too coarsely sampled, the previous cascade handles them
+#define OCEAN_CASCADE_BAND_FACTOR 6.0f
+
+#define OCEAN_DISPLACEMENT_TEXEL_SIZE 8
+#define OCEAN_SLOPE_TEXEL_SIZE 4
+
+static float _cascade_band_start(const Ocean* rpOcean, unsigned int rCascade)
+{
+	const float twoPi = 6.28318530718f;
+	float previousTile = ocean_get_cascade_tile_size(rpOcean, rCascade - 1);
+	float previousNyquist = 3.14159265359f * rpOcean->FftParams.Resolution / previousTile;
+	float start = OCEAN_CASCADE_BAND_FACTOR * twoPi / ocean_get_cascade_tile_size(rpOcean, rCascade);
+	return std::min(start, previousNyquist);
+}
+
+static FftOceanParams _cascade_params(const Ocean* rpOcean, unsigned int rCascade)
+{
+	FftOceanParams params = rpOcean->FftParams;
+	params.TileSize = ocean_get_cascade_tile_size(rpOcean, rCascade);
+	params.Seed = rpOcean->FftParams.Seed + rCascade * 7919u;
+	params.MinWaveNumber = rCascade == 0 ? 0.0f : _cascade_band_start(rpOcean, rCascade);
+	// Cascades past CascadeCount are initialized too, so they can be enabled later. They and the
+	// last active one keep the whole band
+	params.MaxWaveNumber = rCascade + 1 >= rpOcean->CascadeCount ? 0.0f : _cascade_band_start(rpOcean, rCascade + 1);
+	return params;
+}
+
+static void _create_fft_textures(Ocean* rpOcean)
+{
+	unsigned int n = rpOcean->Cascades[0].Params.Resolution;
+	unsigned int layers = rpOcean->CascadeCount;
+
+	if (rpOcean->DisplacementTexture != 0)
+	{
+		gl_state_forget_texture(rpOcean->DisplacementTexture);
+		gl_state_forget_texture(rpOcean->SlopeTexture);
+		glDeleteTextures(1, &rpOcean->DisplacementTexture);
+		glDeleteTextures(1, &rpOcean->SlopeTexture);
+		release_stream_buffer(rpOcean->UploadRing);
+	}
+
+	int levels = 1;
+	while ((n >> levels) > 0)
+	{
+		levels++;
+	}
+
+	unsigned int textures[2];
+	glGenTextures(2, textures);
+	rpOcean->DisplacementTexture = textures[0];
+	rpOcean->SlopeTexture = textures[1];
+
+	for (int i = 0; i < 2; i++)
+	{
+		gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, textures[i]);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, i == 0 ? GL_RGBA16F : GL_RG16F, n, n, layers);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+	rpOcean->TextureResolution = n;
+	rpOcean->TextureLayers = layers;
+
+	GLsizeiptr segmentSize = (GLsizeiptr)n * n * layers * (OCEAN_DISPLACEMENT_TEXEL_SIZE + OCEAN_SLOPE_TEXEL_SIZE);
+	rpOcean->UploadRing = create_stream_buffer(GL_PIXEL_UNPACK_BUFFER, segmentSize);
+}
+
+static void _upload_fft_maps(Ocean* rpOcean)
+{
+	const unsigned int n = rpOcean->Cascades[0].Params.Resolution;
+	const unsigned int layers = rpOcean->CascadeCount;
+
+	if (rpOcean->TextureResolution != n || rpOcean->TextureLayers != layers)
+	{
+		_create_fft_textures(rpOcean);
+	}
+
+	const size_t texelsPerLayer = (size_t)n * n;
+	const size_t slopeOffset = texelsPerLayer * layers * OCEAN_DISPLACEMENT_TEXEL_SIZE;
+
+	// Convert to half straight into the mapped segment. The maxima are kept per row and reduced after
+	unsigned char* pSegment = (unsigned char*)stream_buffer_begin(&rpOcean->UploadRing);
+	std::vector<glm::vec2> rowMax(n * layers);
+	job_parallel_for(n * layers, 16, [&](unsigned int rBegin, unsigned int rEnd)
+	{
+		for (unsigned int row = rBegin; row < rEnd; row++)
+		{
+			const FftOcean& cascade = rpOcean->Cascades[row / n];
+			size_t first = (size_t)(row % n) * n;
+			size_t layerOffset = (size_t)(row / n) * texelsPerLayer;
+
+			unsigned int* pDisplacement = (unsigned int*)pSegment + (layerOffset + first) * 2;
+			unsigned int* pSlope = (unsigned int*)(pSegment + slopeOffset) + layerOffset + first;
+			glm::vec2 maxima(0.0f);
+			for (size_t x = 0; x < n; x++)
+			{
+				size_t i = first + x;
+				pDisplacement[x * 2 + 0] = glm::packHalf2x16(glm::vec2(cascade.DisplacementX[i], cascade.Height[i]));
+				pDisplacement[x * 2 + 1] = glm::packHalf2x16(glm::vec2(cascade.DisplacementZ[i], 0.0f));
+				pSlope[x] = glm::packHalf2x16(glm::vec2(cascade.SlopeX[i], cascade.SlopeZ[i]));
+
+				maxima.x = std::max(maxima.x, fabsf(cascade.Height[i]));
+				maxima.y = std::max(maxima.y, std::max(fabsf(cascade.DisplacementX[i]), fabsf(cascade.DisplacementZ[i])));
+			}
+			rowMax[row] = maxima;
+		}
+	});
+
+	rpOcean->FftMaxHeight = 0.0f;
+	rpOcean->FftMaxHorizontal = 0.0f;
+	for (unsigned int layer = 0; layer < layers; layer++)
+	{
+		glm::vec2 layerMax(0.0f);
+		for (unsigned int row = 0; row < n; row++)
+		{
+			layerMax = glm::max(layerMax, rowMax[layer * n + row]);
+		}
+		rpOcean->FftMaxHeight += layerMax.x;
+		rpOcean->FftMaxHorizontal += layerMax.y;
+	}
+	GLintptr offset = stream_buffer_end(&rpOcean->UploadRing);
+
+	gl_state_bind_texture(OCEAN_DISPLACEMENT_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, rpOcean->DisplacementTexture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, n, n, layers, GL_RGBA, GL_HALF_FLOAT, (const void*)offset);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+	gl_state_bind_texture(OCEAN_SLOPE_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, rpOcean->SlopeTexture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, n, n, layers, GL_RG, GL_HALF_FLOAT, (const void*)(offset + slopeOffset));
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+	stream_buffer_fence(&rpOcean->UploadRing);
+
+	// Other texture uploads must not read from the ring
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+static void _upload_wave_table(Ocean* rpOcean)
+{
+	const std::vector<WaveTableEntry>& entries = rpOcean->Evaluator.Table.Entries;
+	const GLsizeiptr headerSize = 16;
+	const GLsizeiptr entriesSize = (GLsizeiptr)(entries.size() * sizeof(WaveTableEntry));
+
+	if (rpOcean->WaveTableBuffer == 0)
+	{
+		glGenBuffers(1, &rpOcean->WaveTableBuffer);
+	}
+
+	int header[4] = { (int)entries.size(), 0, 0, 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, rpOcean->WaveTableBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, headerSize + entriesSize, nullptr, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, headerSize, header);
+	if (entriesSize > 0)
+	{
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, headerSize, entriesSize, entries.data());
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCEAN_WAVE_TABLE_BINDING, rpOcean->WaveTableBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+static void _update_cascade_params(Ocean* rpOcean)
+{
+	for (unsigned int i = 0; i < rpOcean->CascadeCount; i++)
+	{
+		fft_ocean_set_params(&rpOcean->Cascades[i], _cascade_params(rpOcean, i));
+	}
+}
+
+void ocean_init(Ocean* rpOcean, const OceanWaveParams& rWaveParams, const FftOceanParams& rFftParams, unsigned int rCascadeCount)
+{
+	rpOcean->SimulationType = OceanSimulationType::Gerstner;
+	rpOcean->Time = 0.0f;
+	rpOcean->DisplacementTexture = 0;
+	rpOcean->SlopeTexture = 0;
+	rpOcean->TextureResolution = 0;
+	rpOcean->TextureLayers = 0;
+	rpOcean->WaveTableBuffer = 0;
+	rpOcean->FftMaxHeight = 0.0f;
+	rpOcean->FftMaxHorizontal = 0.0f;
+	rpOcean->OctaveLod = true;
+	rpOcean->OctaveSplit = true;
+	rpOcean->GeometricOctaves = OCEAN_DEFAULT_GEOMETRIC_OCTAVES;
+	rpOcean->FftParams = rFftParams;
+	rpOcean->CascadeCount = std::clamp(rCascadeCount, 1u, (unsigned int)OCEAN_MAX_CASCADES);
+
+	ocean_evaluator_init(&rpOcean->Evaluator, rWaveParams);
+	_upload_wave_table(rpOcean);
+	for (unsigned int i = 0; i < OCEAN_MAX_CASCADES; i++)
+	{
+		fft_ocean_init(&rpOcean->Cascades[i], _cascade_params(rpOcean, i));
+	}
+	_create_fft_textures(rpOcean);
+}
+
+void ocean_release(Ocean* rpOcean)
+{
+	if (rpOcean->WaveTableBuffer != 0)
+	{
+		glDeleteBuffers(1, &rpOcean->WaveTableBuffer);
+		rpOcean->WaveTableBuffer = 0;
+	}
+	if (rpOcean->DisplacementTexture != 0)
+	{
+		gl_state_forget_texture(rpOcean->DisplacementTexture);
+		gl_state_forget_texture(rpOcean->SlopeTexture);
+		glDeleteTextures(1, &rpOcean->DisplacementTexture);
+		glDeleteTextures(1, &rpOcean->SlopeTexture);
+		release_stream_buffer(rpOcean->UploadRing);
+		rpOcean->DisplacementTexture = 0;
+		rpOcean->SlopeTexture = 0;
+	}
+}
+
+void ocean_set_simulation_type(Ocean* rpOcean, OceanSimulationType rType)
+{
+	rpOcean->SimulationType = rType;
+}
+
+void ocean_set_wave_params(Ocean* rpOcean, const OceanWaveParams& rParams)
+{
+	ocean_evaluator_set_params(&rpOcean->Evaluator, rParams);
+	_upload_wave_table(rpOcean);
+}
+
+void ocean_set_fft_params(Ocean* rpOcean, const FftOceanParams& rParams)
+{
+	rpOcean->FftParams = rParams;
+	_update_cascade_params(rpOcean);
+}
+
+void ocean_set_cascade_count(Ocean* rpOcean, unsigned int rCascadeCount)
+{
+	rpOcean->CascadeCount = std::clamp(rCascadeCount, 1u, (unsigned int)OCEAN_MAX_CASCADES);
+	// The last cascade keeps every wave shorter than its band start
+	_update_cascade_params(rpOcean);
+}
+
+void ocean_set_octave_lod(Ocean* rpOcean, bool rEnabled)
+{
+	rpOcean->OctaveLod = rEnabled;
+}
+
+void ocean_set_octave_split(Ocean* rpOcean, bool rEnabled, unsigned int rGeometricOctaves)
+{
+	rpOcean->OctaveSplit = rEnabled;
+	rpOcean->GeometricOctaves = rGeometricOctaves;
+}
+
+float ocean_get_cascade_tile_size(const Ocean* rpOcean, unsigned int rCascade)
+{
+	return rpOcean->FftParams.TileSize * s_CascadeScale[rCascade];
+}
+
+void ocean_get_displacement_bounds(const Ocean* rpOcean, float* rpOutMaxHeight, float* rpOutMaxHorizontal)
+{
+	if (rpOcean->SimulationType == OceanSimulationType::FFT)
+	{
+		*rpOutMaxHeight = rpOcean->FftMaxHeight * OCEAN_FFT_BOUNDS_MARGIN;
+		*rpOutMaxHorizontal = rpOcean->FftMaxHorizontal * OCEAN_FFT_BOUNDS_MARGIN;
+	}
+	else
+	{
+		*rpOutMaxHeight = rpOcean->Evaluator.Table.MaxHeight;
+		*rpOutMaxHorizontal = rpOcean->Evaluator.Table.MaxHorizontal;
+	}
+}
+
+void ocean_update(Ocean* rpOcean, float rTime)
+{
+	rpOcean->Time = rTime;
+	ocean_evaluator_set_time(&rpOcean->Evaluator, rTime);
+
+	if (rpOcean->SimulationType == OceanSimulationType::FFT)
+	{
+		for (unsigned int i = 0; i < rpOcean->CascadeCount; i++)
+		{
+			fft_ocean_update(&rpOcean->Cascades[i], rTime);
+		}
+		_upload_fft_maps(rpOcean);
+	}
+}
+
+void ocean_write_to_shader(const Ocean* rpOcean, Shader* rpShader)
+{
+	use_shader(rpShader);
+	set_uniform_int(rpShader, "uSimulationType", (int)rpOcean->SimulationType);
+	set_uniform_int(rpShader, "uCascadeCount", (int)rpOcean->CascadeCount);
+	set_uniform_int(rpShader, "uOctaveLod", rpOcean->OctaveLod ? 1 : 0);
+	set_uniform_int(rpShader, "uOctaveSplit", rpOcean->OctaveSplit ? 1 : 0);
+	set_uniform_int(rpShader, "uGeometricOctaves", (int)rpOcean->GeometricOctaves);
+	for (unsigned int i = 0; i < OCEAN_MAX_CASCADES; i++)
+	{
+		std::string name = "uCascadeTileSize[" + std::to_string(i) + "]";
+		set_uniform_float(rpShader, name.c_str(), ocean_get_cascade_tile_size(rpOcean, i));
+	}
+	set_uniform_int(rpShader, "uDisplacementMap", OCEAN_DISPLACEMENT_TEXTURE_UNIT);
+	set_uniform_int(rpShader, "uSlopeMap", OCEAN_SLOPE_TEXTURE_UNIT);
+}
+
+typedef struct
+{
+	double FrameMs;
+	double OctavesPerFragment;
+	std::vector<unsigned char> Image;
+} _RenderModeResult;
+
+// Renders with the current shader state: the GPU time of rFrameCount frames and the final image
+static _RenderModeResult _measure_render_mode(unsigned int rFrameCount, const std::function<void()>& rRenderFrame, const GLint* rpViewport)
+{
+	_RenderModeResult result{};
+
+	// Not measured, lets the driver settle after the uniform change
+	rRenderFrame();
+
+	GpuTimer timer = create_gpu_timer();
+	double total = 0.0;
+	for (unsigned int i = 0; i < rFrameCount; i++)
+	{
+		gpu_timer_begin(&timer);
+		rRenderFrame();
+		gpu_timer_end(&timer);
+		total += gpu_timer_get_ms(&timer);
+	}
+	result.FrameMs = total / std::max(rFrameCount, 1u);
+	release_gpu_timer(timer);
+
+	result.Image.resize((size_t)rpViewport[2] * rpViewport[3] * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(rpViewport[0], rpViewport[1], rpViewport[2], rpViewport[3], GL_RGBA, GL_UNSIGNED_BYTE, result.Image.data());
+	return result;
+}
+
+// Average Gerstner normal loop iterations per ocean fragment on one frame
+static double _measure_octaves_per_fragment(Shader* rpShader, const std::function<void()>& rRenderFrame)
+{
+	unsigned int stats[2] = { 0, 0 };
+	unsigned int buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(stats), stats, GL_DYNAMIC_READ);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCEAN_OCTAVE_STATS_BINDING, buffer);
+
+	set_uniform_int(rpShader, "uCollectOctaveStats", 1);
+	rRenderFrame();
+	set_uniform_int(rpShader, "uCollectOctaveStats", 0);
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(stats), stats);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+
+	return stats[0] > 0 ? (double)stats[1] / stats[0] : 0.0;
+}
+
+static void _print_image_difference(const std::vector<unsigned char>& rA, const std::vector<unsigned char>& rB)
+{
+	// Differences per channel, in 8 bit steps
+	const size_t pixelCount = rA.size() / 4;
+	double sumDifference = 0.0;
+	int maxDifference = 0;
+	size_t changedPixels = 0;
+	for (size_t p = 0; p < pixelCount; p++)
+	{
+		int pixelDifference = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			int difference = std::abs((int)rA[p * 4 + c] - (int)rB[p * 4 + c]);
+			sumDifference += difference;
+			pixelDifference = std::max(pixelDifference, difference);
+		}
+		maxDifference = std::max(maxDifference, pixelDifference);
+		changedPixels += pixelDifference > 8 ? 1 : 0;
+	}
+
+	std::cout << "  image difference: mean " << sumDifference / std::max(pixelCount * 3, (size_t)1) << "/255, max " << maxDifference
+		<< "/255, " << 100.0 * changedPixels / std::max(pixelCount, (size_t)1) << "% of pixels above 8/255" << std::endl;
+}
+
+static void _print_render_mode(const char* rName, const _RenderModeResult& rResult, const _RenderModeResult& rBaseline)
+{
+	std::cout << "  " << rName << ": " << rResult.FrameMs << " ms/frame (GPU), " << rBaseline.FrameMs / std::max(rResult.FrameMs, 1e-6)
+		<< "x, " << rResult.OctavesPerFragment << " octave iterations per ocean fragment" << std::endl;
+}
+
+void ocean_get_shader_defines(const Ocean* rpOcean, std::vector<ShaderDefine>* rpOutDefines)
+{
+	rpOutDefines->push_back({ "OCEAN_SIMULATION_TYPE", (int)rpOcean->SimulationType });
+	rpOutDefines->push_back({ "OCEAN_WAVE_COUNT", (int)rpOcean->Evaluator.Table.Entries.size() });
+	rpOutDefines->push_back({ "OCEAN_OCTAVE_LOD", rpOcean->OctaveLod ? 1 : 0 });
+	rpOutDefines->push_back({ "OCEAN_OCTAVE_SPLIT", rpOcean->OctaveSplit ? 1 : 0 });
+	rpOutDefines->push_back({ "OCEAN_GEOMETRIC_OCTAVES", (int)rpOcean->GeometricOctaves });
+}
+
+void ocean_lod_benchmark(Ocean* rpOcean, Shader* rpShader, unsigned int rFrameCount, const std::function<void()>& rRenderFrame)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	const bool previousLod = rpOcean->OctaveLod;
+	_RenderModeResult results[2];
+
+	// 0: full sum, 1: octave LOD
+	for (int mode = 0; mode < 2; mode++)
+	{
+		ocean_set_octave_lod(rpOcean, mode == 1);
+		ocean_write_to_shader(rpOcean, rpShader);
+		results[mode] = _measure_render_mode(rFrameCount, rRenderFrame, viewport);
+		results[mode].OctavesPerFragment = _measure_octaves_per_fragment(rpShader, rRenderFrame);
+	}
+
+	ocean_set_octave_lod(rpOcean, previousLod);
+	ocean_write_to_shader(rpOcean, rpShader);
+
+	std::cout << "OCEAN::LOD::BENCHMARK - " << viewport[2] << "x" << viewport[3] << ", " << rFrameCount << " frames per mode, "
+		<< rpOcean->Evaluator.Table.Entries.size() << " octaves in the table" << std::endl;
+	_print_render_mode("full sum", results[0], results[0]);
+	_print_render_mode("octave LOD", results[1], results[0]);
+	_print_image_difference(results[0].Image, results[1].Image);
+}
+
+void ocean_octave_split_benchmark(Ocean* rpOcean, Shader* rpShader, unsigned int rFrameCount, const std::function<void()>& rRenderFrame)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	const bool previousSplit = rpOcean->OctaveSplit;
+	_RenderModeResult results[2];
+
+	// 0: every octave in both stages, 1: geometric octaves per vertex, detail octaves per pixel
+	for (int mode = 0; mode < 2; mode++)
+	{
+		ocean_set_octave_split(rpOcean, mode == 1, rpOcean->GeometricOctaves);
+		ocean_write_to_shader(rpOcean, rpShader);
+		results[mode] = _measure_render_mode(rFrameCount, rRenderFrame, viewport);
+		results[mode].OctavesPerFragment = _measure_octaves_per_fragment(rpShader, rRenderFrame);
+	}
+
+	ocean_set_octave_split(rpOcean, previousSplit, rpOcean->GeometricOctaves);
+	ocean_write_to_shader(rpOcean, rpShader);
+
+	std::cout << "OCEAN::SPLIT::BENCHMARK - " << viewport[2] << "x" << viewport[3] << ", " << rFrameCount << " frames per mode, "
+		<< rpOcean->GeometricOctaves << " geometric octaves of " << rpOcean->Evaluator.Table.Entries.size()
+		<< (rpOcean->OctaveLod ? ", octave LOD on" : ", octave LOD off") << std::endl;
+	_print_render_mode("no split", results[0], results[0]);
+	_print_render_mode("split", results[1], results[0]);
+	_print_image_difference(results[0].Image, results[1].Image);
+}
+
+void ocean_sample_positions(const Ocean* rpOcean, const float* rpX, const float* rpZ,
+	float* rpOutX, float* rpOutY, float* rpOutZ, size_t rCount)
+{
+	if (rpOcean->SimulationType == OceanSimulationType::FFT)
+	{
+		for (size_t i = 0; i < rCount; i++)
+		{
+			rpOutX[i] = rpX[i];
+			rpOutY[i] = 0.0f;
+			rpOutZ[i] = rpZ[i];
+		}
+		for (unsigned int c = 0; c < rpOcean->CascadeCount; c++)
+		{
+			fft_ocean_add_displacement(&rpOcean->Cascades[c], rpX, rpZ, rpOutX, rpOutY, rpOutZ, rCount);
+		}
+	}
+	else
+	{
+		ocean_evaluate_positions(&rpOcean->Evaluator, rpX, rpZ, rpOutX, rpOutY, rpOutZ, rCount);
+	}
+}
+
+void ocean_sample_normals(const Ocean* rpOcean, const float* rpX, const float* rpZ, glm::vec3* rpOutNormal, size_t rCount)
+{
+	if (rpOcean->SimulationType == OceanSimulationType::FFT)
+	{
+		float slopeX[OCEAN_QUERY_BATCH], slopeZ[OCEAN_QUERY_BATCH];
+		for (size_t first = 0; first < rCount; first += OCEAN_QUERY_BATCH)
+		{
+			size_t count = std::min((size_t)OCEAN_QUERY_BATCH, rCount - first);
+			std::fill(slopeX, slopeX + count, 0.0f);
+			std::fill(slopeZ, slopeZ + count, 0.0f);
+			for (unsigned int c = 0; c < rpOcean->CascadeCount; c++)
+			{
+				fft_ocean_add_slopes(&rpOcean->Cascades[c], rpX + first, rpZ + first, slopeX, slopeZ, count);
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				rpOutNormal[first + i] = glm::normalize(glm::vec3(-slopeX[i], 1.0f, -slopeZ[i]));
+			}
+		}
+	}
+	else
+	{
+		ocean_evaluate_normals(&rpOcean->Evaluator, rpX, rpZ, rpOutNormal, rCount);
+	}
+}
+
+void ocean_query_heights(const Ocean* rpOcean, const float* rpX, const float* rpZ, float* rpOutY, glm::vec3* rpOutNormal,
+	size_t rCount, glm::vec2* rpSources)
+{
+	float sourceX[OCEAN_QUERY_BATCH], sourceZ[OCEAN_QUERY_BATCH];
+	float surfaceX[OCEAN_QUERY_BATCH], surfaceY[OCEAN_QUERY_BATCH], surfaceZ[OCEAN_QUERY_BATCH];
+
+	for (size_t first = 0; first < rCount; first += OCEAN_QUERY_BATCH)
+	{
+		const size_t count = std::min((size_t)OCEAN_QUERY_BATCH, rCount - first);
+		const float* targetX = rpX + first;
+		const float* targetZ = rpZ + first;
+
+		bool seeded = true;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (rpSources != nullptr && std::isfinite(rpSources[first + i].x) && std::isfinite(rpSources[first + i].y))
+			{
+				sourceX[i] = rpSources[first + i].x;
+				sourceZ[i] = rpSources[first + i].y;
+			}
+			else
+			{
+				sourceX[i] = targetX[i];
+				sourceZ[i] = targetZ[i];
+				seeded = false;
+			}
+		}
+
+		int iterations = seeded ? OCEAN_QUERY_ITERATIONS : OCEAN_QUERY_ITERATIONS * 2;
+		for (int it = 0; it < iterations; it++)
+		{
+			ocean_sample_positions(rpOcean, sourceX, sourceZ, surfaceX, surfaceY, surfaceZ, count);
+			for (size_t i = 0; i < count; i++)
+			{
+				sourceX[i] += targetX[i] - surfaceX[i];
+				sourceZ[i] += targetZ[i] - surfaceZ[i];
+			}
+		}
+
+		ocean_sample_positions(rpOcean, sourceX, sourceZ, surfaceX, surfaceY, surfaceZ, count);
+		std::copy(surfaceY, surfaceY + count, rpOutY + first);
+
+		if (rpOutNormal != nullptr)
+		{
+			ocean_sample_normals(rpOcean, sourceX, sourceZ, rpOutNormal + first, count);
+		}
+
+		if (rpSources != nullptr)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				rpSources[first + i] = glm::vec2(sourceX[i], sourceZ[i]);
+			}
+		}
+	}
+}
+
+// Distance between the queried XZ and where the found rest position actually ends up
+static float _query_residual(const Ocean* rpOcean, float rX, float rZ, glm::vec2 rSource)
+{
+	float surfaceX, surfaceY, surfaceZ;
+	ocean_sample_positions(rpOcean, &rSource.x, &rSource.y, &surfaceX, &surfaceY, &surfaceZ, 1);
+	return glm::length(glm::vec2(surfaceX - rX, surfaceZ - rZ));
+}
+
+void ocean_query_benchmark(const Ocean* rpOcean, size_t rCount)
+{
+	std::vector<float> x(rCount), z(rCount), y(rCount), referenceY(rCount);
+	std::vector<glm::vec3> normals(rCount);
+	std::vector<glm::vec2> sources(rCount, glm::vec2(NAN)), referenceSources;
+
+	unsigned int seed = 12345u;
+	for (size_t i = 0; i < rCount; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		x[i] = (seed >> 8) * (1024.0f / 16777216.0f);
+		seed = seed * 1664525u + 1013904223u;
+		z[i] = (seed >> 8) * (1024.0f / 16777216.0f);
+	}
+
+	// Converged answer: many warm started rounds
+	referenceSources = sources;
+	for (int i = 0; i < 8; i++)
+	{
+		ocean_query_heights(rpOcean, x.data(), z.data(), referenceY.data(), nullptr, rCount, referenceSources.data());
+	}
+
+	auto run = [&](const char* rName, glm::vec2* rpSources)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		ocean_query_heights(rpOcean, x.data(), z.data(), y.data(), normals.data(), rCount, rpSources);
+		auto end = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration<double>(end - start).count();
+
+		float maxHeightError = 0.0f;
+		float maxResidual = 0.0f;
+		for (size_t i = 0; i < rCount; i++)
+		{
+			maxHeightError = std::max(maxHeightError, fabsf(y[i] - referenceY[i]));
+		}
+		if (rpSources != nullptr)
+		{
+			for (size_t i = 0; i < rCount; i++)
+			{
+				maxResidual = std::max(maxResidual, _query_residual(rpOcean, x[i], z[i], rpSources[i]));
+			}
+		}
+
+		std::cout << "  " << rName << ": " << (rCount / seconds) / 1e6 << " Mqueries/s (height + normal), max height error "
+			<< maxHeightError << " m";
+		if (rpSources != nullptr)
+		{
+			std::cout << ", max XZ residual " << maxResidual << " m";
+		}
+		std::cout << std::endl;
+	};
+
+	std::cout << "OCEAN::QUERY::BENCHMARK - " << rCount << " queries, "
+		<< (rpOcean->SimulationType == OceanSimulationType::FFT ? "FFT" : "Gerstner") << ", single thread" << std::endl;
+	run("cold", sources.data());
+	run("warm", sources.data());
+
+	// Warm start from the previous frame, like a query id would get
+	if (rpOcean->SimulationType == OceanSimulationType::Gerstner)
+	{
+		Ocean nextFrame{};
+		nextFrame.SimulationType = OceanSimulationType::Gerstner;
+		nextFrame.Evaluator = rpOcean->Evaluator;
+		ocean_evaluator_set_time(&nextFrame.Evaluator, rpOcean->Evaluator.Time + 1.0f / 60.0f);
+
+		std::vector<glm::vec2> nextSources = referenceSources;
+		for (int i = 0; i < 8; i++)
+		{
+			ocean_query_heights(&nextFrame, x.data(), z.data(), referenceY.data(), nullptr, rCount, nextSources.data());
+		}
+		rpOcean = &nextFrame;
+		run("next frame", sources.data());
+	}
+}
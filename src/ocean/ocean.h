@@ -0,0 +1,166 @@
+#ifndef OCEAN_H
+#define OCEAN_H
+
+#include <cstddef>
+#include <functional>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include "ocean_wave_evaluator.h"
+#include "fft_ocean.h"
+#include "../renderer/data/shader.h"
+#include "../renderer/data/buffers/stream_buffer.h"
+
+// Owns every ocean backend and forwards to the selected one, so the renderer, the UI and
+// the CPU queries do not need to know which simulation is running.
+
+// Texture units used by the FFT maps. Unit 0 is used by the material albedo and the skybox
+#define OCEAN_DISPLACEMENT_TEXTURE_UNIT 1
+#define OCEAN_SLOPE_TEXTURE_UNIT 2
+
+// Shader storage binding of the Gerstner wave table. Must match res/shaders/ocean_waves.glsl
+#define OCEAN_WAVE_TABLE_BINDING 0
+
+// The FFT maxima only hold for the last frame, the next ones may go a bit further
+#define OCEAN_FFT_BOUNDS_MARGIN 1.25f
+
+// Shader storage binding of the octave loop counters of basic_shader.frag, used by the benchmarks
+#define OCEAN_OCTAVE_STATS_BINDING 1
+
+// Gerstner octaves that displace the geometry when the octave split is on. The grid vertices are 1m apart,
+// so the octaves after the 20th are shorter than its Nyquist limit with the default parameters
+#define OCEAN_DEFAULT_GEOMETRIC_OCTAVES 20
+
+// FFT cascades: tiles of decreasing size that split the spectrum in bands. Must match basic_shader
+#define OCEAN_MAX_CASCADES 3
+
+// Height queries: fixed-point iterations to find the rest position that ends up at the queried XZ.
+// Twice as many are used when a batch has points without a previous answer
+#define OCEAN_QUERY_ITERATIONS 3
+#define OCEAN_QUERY_BATCH 256
+
+enum class OceanSimulationType
+{
+	Gerstner = 0,
+	FFT
+};
+
+typedef struct
+{
+	OceanSimulationType SimulationType;
+
+	OceanWaveEvaluator Evaluator;
+
+	// GL_SHADER_STORAGE_BUFFER with the evaluator wave table: a 16 byte header (octave count) and the entries
+	unsigned int WaveTableBuffer;
+
+	// Fades out the octaves below the vertex/pixel footprint in basic_shader (uOctaveLod)
+	bool OctaveLod;
+
+	// Only the first GeometricOctaves octaves of the table displace the vertices and give the interpolated
+	// normal, the rest are evaluated per pixel as detail normal up to uFoamDistanceFade (uOctaveSplit)
+	bool OctaveSplit;
+	unsigned int GeometricOctaves;
+
+	// FftParams.TileSize is the size of the first (largest) cascade. The rest are derived from it
+	FftOceanParams FftParams;
+	unsigned int CascadeCount;
+	FftOcean Cascades[OCEAN_MAX_CASCADES];
+
+	// Texture arrays with one layer per cascade, mipmapped.
+	// Displacement is RGBA16F (x, height, z, -), slope is RG16F (dh/dx, dh/dz)
+	unsigned int DisplacementTexture;
+	unsigned int SlopeTexture;
+	unsigned int TextureResolution;
+	unsigned int TextureLayers;
+
+	// Upload ring (GL_PIXEL_UNPACK_BUFFER). One segment holds every layer of both maps
+	StreamBuffer UploadRing;
+
+	// Largest height and horizontal displacement found in the FFT maps on the last upload, summed over cascades
+	float FftMaxHeight;
+	float FftMaxHorizontal;
+
+	float Time;
+} Ocean;
+
+/// <summary>
+/// Initializes both backends, the wave table buffer and the FFT textures. Needs a current OpenGL context
+/// </summary>
+void ocean_init(Ocean* rpOcean, const OceanWaveParams& rWaveParams, const FftOceanParams& rFftParams, unsigned int rCascadeCount);
+
+void ocean_release(Ocean* rpOcean);
+
+void ocean_set_simulation_type(Ocean* rpOcean, OceanSimulationType rType);
+
+/// <summary>
+/// Rebuilds the wave table and uploads it for basic_shader
+/// </summary>
+void ocean_set_wave_params(Ocean* rpOcean, const OceanWaveParams& rParams);
+void ocean_set_fft_params(Ocean* rpOcean, const FftOceanParams& rParams);
+void ocean_set_cascade_count(Ocean* rpOcean, unsigned int rCascadeCount);
+void ocean_set_octave_lod(Ocean* rpOcean, bool rEnabled);
+void ocean_set_octave_split(Ocean* rpOcean, bool rEnabled, unsigned int rGeometricOctaves);
+
+float ocean_get_cascade_tile_size(const Ocean* rpOcean, unsigned int rCascade);
+
+/// <summary>
+/// Bounds of the displacement of the active simulation, used to inflate the culling bounds of the surface.
+/// Exact for Gerstner, for FFT the maxima of the last frame with a safety margin
+/// </summary>
+void ocean_get_displacement_bounds(const Ocean* rpOcean, float* rpOutMaxHeight, float* rpOutMaxHorizontal);
+
+/// <summary>
+/// Advances the active simulation to rTime. For FFT the new maps are streamed to the GPU
+/// </summary>
+void ocean_update(Ocean* rpOcean, float rTime);
+
+/// <summary>
+/// Writes the uniforms that select the simulation path in basic_shader
+/// </summary>
+void ocean_write_to_shader(const Ocean* rpOcean, Shader* rpShader);
+
+/// <summary>
+/// Appends the current settings as basic_shader defines, for a variant where they are constants instead of uniforms.
+/// The variant has to be selected again whenever they change
+/// </summary>
+void ocean_get_shader_defines(const Ocean* rpOcean, std::vector<ShaderDefine>* rpOutDefines);
+
+/// <summary>
+/// Renders rFrameCount frames with the octave LOD on and off, printing the GPU time and the octave loop count
+/// per ocean fragment of each mode, and the difference between the last image of both.
+/// rRenderFrame must draw a full frame without swapping buffers
+/// </summary>
+void ocean_lod_benchmark(Ocean* rpOcean, Shader* rpShader, unsigned int rFrameCount, const std::function<void()>& rRenderFrame);
+
+/// <summary>
+/// Same as ocean_lod_benchmark, comparing the octave split against evaluating every octave in both stages
+/// </summary>
+void ocean_octave_split_benchmark(Ocean* rpOcean, Shader* rpShader, unsigned int rFrameCount, const std::function<void()>& rRenderFrame);
+
+/// <summary>
+/// Displaced surface position for a batch of rest positions, using the active simulation
+/// </summary>
+void ocean_sample_positions(const Ocean* rpOcean, const float* rpX, const float* rpZ,
+	float* rpOutX, float* rpOutY, float* rpOutZ, size_t rCount);
+
+/// <summary>
+/// Surface normal at the displaced position of each rest position, using the active simulation
+/// </summary>
+void ocean_sample_normals(const Ocean* rpOcean, const float* rpX, const float* rpZ, glm::vec3* rpOutNormal, size_t rCount);
+
+/// <summary>
+/// Surface height (and optionally normal) at world XZ positions. Waves move the surface sideways, so the
+/// rest position s with s + D(s) = (x, z) is solved first with fixed-point iterations s' = (x, z) - D(s)
+/// </summary>
+/// <param name="rpOutNormal">Optional</param>
+/// <param name="rpSources">Optional. One entry per query, indexed by the caller's query id. Holds the rest position
+/// found on the previous call, used as first guess and overwritten with the new answer. Non-finite entries are ignored</param>
+void ocean_query_heights(const Ocean* rpOcean, const float* rpX, const float* rpZ, float* rpOutY, glm::vec3* rpOutNormal,
+	size_t rCount, glm::vec2* rpSources = nullptr);
+
+/// <summary>
+/// Measures the throughput and the error of ocean_query_heights against a converged solution, printing the results
+/// </summary>
+void ocean_query_benchmark(const Ocean* rpOcean, size_t rCount);
+
+#endif // !OCEAN_H
@@ -0,0 +1,629 @@
+#include "ocean_mesh.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <glad/glad.h>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
+#include "../core/memory_utils.h"
+#include "../renderer/renderer.h"
+#include "../renderer/gpu_timer.h"
+
+typedef struct
+{
+	glm::vec4 FrustumPlanes[6];
+	glm::vec3 CameraPosition;
+	float MaxHeight;
+	float MaxHorizontal;
+	float Ranges[OCEAN_CDLOD_LEVELS];
+} _CdlodSelection;
+
+static_assert(sizeof(OceanVertex) == 4, "OceanVertex must stay 4 bytes");
+static_assert((OCEAN_TILE_RESOLUTION + 1) * (OCEAN_TILE_RESOLUTION + 1) < 0xFFFF, "Tile vertices must fit 16 bit indices below the restart index");
+static_assert((OCEAN_CDLOD_PATCH_RESOLUTION + 1) * (OCEAN_CDLOD_PATCH_RESOLUTION + 1) < 0xFFFF, "Patch vertices must fit 16 bit indices below the restart index");
+static_assert(OCEAN_GRID_SIZE % OCEAN_TILE_RESOLUTION == 0 && OCEAN_PROJECTED_GRID_RESOLUTION % OCEAN_TILE_RESOLUTION == 0, "Grids must be made of whole tiles");
+
+static void _set_single_submesh(Mesh* rpMesh, unsigned int rIndexCount)
+{
+	rpMesh->IndexCount = (int)rIndexCount;
+	rpMesh->HeapAllocation = {};
+	rpMesh->SubmeshCount = 1;
+	rpMesh->Submeshes = (Submesh*)CE_MALLOC(sizeof(Submesh));
+	rpMesh->Submeshes[0] = Submesh{ 0, rIndexCount };
+}
+
+// Tile of rResolution^2 quads on integer XZ coordinates, basic_shader places it. One triangle strip per column
+// of quads, split by the restart index. Same triangles and winding as _create_legacy_grid_mesh
+static void _create_tile_mesh(OceanMesh* rpOceanMesh, unsigned int rResolution)
+{
+	unsigned int n = rResolution + 1;
+	std::vector<OceanVertex> vertices(n * n);
+	for (unsigned int x = 0; x < n; ++x)
+	{
+		for (unsigned int z = 0; z < n; ++z)
+		{
+			vertices[x * n + z] = OceanVertex{ (unsigned short)x, (unsigned short)z };
+		}
+	}
+
+	std::vector<unsigned short> indices;
+	indices.reserve((size_t)rResolution * (2 * n + 1));
+	for (unsigned int x = 0; x < rResolution; ++x)
+	{
+		if (x > 0)
+		{
+			indices.push_back(0xFFFF);
+		}
+		for (unsigned int z = 0; z < n; ++z)
+		{
+			indices.push_back((unsigned short)((x + 1) * n + z));
+			indices.push_back((unsigned short)(x * n + z));
+		}
+	}
+
+	VertexAttribute vertexAttributes[] =
+	{
+		VertexAttribute{VertexAttributeType::USHORT, 2}	// Grid coordinates
+	};
+	VertexBufferLayout layout = create_vertex_buffer_layout(vertexAttributes, 1);
+
+	Mesh* pMesh = &rpOceanMesh->Mesh;
+	pMesh->Vao = create_vao();
+	pMesh->Vbo = create_vbo(vertices.size() * sizeof(OceanVertex), vertices.data(), GL_STATIC_DRAW);
+	pMesh->Ibo = create_ibo(indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+	vao_add_vbo(pMesh->Vao, pMesh->Vbo, layout);
+	vao_add_ibo(pMesh->Vao, pMesh->Ibo);
+	pMesh->IndexType = GL_UNSIGNED_SHORT;
+	pMesh->PrimitiveType = GL_TRIANGLE_STRIP;
+	_set_single_submesh(pMesh, (unsigned int)indices.size());
+
+	rpOceanMesh->TileResolution = rResolution;
+	rpOceanMesh->TileIndexCount = (unsigned int)indices.size();
+	rpOceanMesh->VertexBytes = vertices.size() * sizeof(OceanVertex);
+	rpOceanMesh->IndexBytes = indices.size() * sizeof(unsigned short);
+}
+
+// Old layout: full Vertex per grid point and one 32 bit triangle list. The grid coordinates are in Position.xy
+static void _create_legacy_grid_mesh(OceanMesh* rpOceanMesh, unsigned int rResolution)
+{
+	unsigned int n = rResolution + 1;
+	std::vector<Vertex> vertices(n * n);
+	std::vector<unsigned int> indices;
+	indices.reserve((size_t)rResolution * rResolution * 6);
+
+	for (unsigned int x = 0; x < n; ++x)
+	{
+		for (unsigned int z = 0; z < n; ++z)
+		{
+			vertices[x * n + z] = Vertex{ glm::vec3((float)x, (float)z, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f) };
+		}
+	}
+
+	for (unsigned int x = 0; x < n - 1; ++x)
+	{
+		for (unsigned int z = 0; z < n - 1; ++z)
+		{
+			unsigned int a = x * n + z;
+			unsigned int b = a + 1;
+			unsigned int c = a + n;
+			unsigned int d = c + 1;
+			indices.push_back(a);
+			indices.push_back(b);
+			indices.push_back(d);
+
+			indices.push_back(a);
+			indices.push_back(d);
+			indices.push_back(c);
+		}
+	}
+
+	VertexAttribute vertexAttributes[] =
+	{
+		VertexAttribute{VertexAttributeType::FLOAT, 3},	// Position
+		VertexAttribute{VertexAttributeType::FLOAT, 3},	// Normal
+		VertexAttribute{VertexAttributeType::FLOAT, 2}	// UV
+	};
+
+	create_mesh(&rpOceanMesh->Mesh, vertexAttributes, 3, (float*)vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size(), 1, GL_STATIC_DRAW);
+	rpOceanMesh->Mesh.Submeshes[0] = Submesh{ 0, (unsigned int)indices.size() };
+
+	rpOceanMesh->TileResolution = rResolution;
+	rpOceanMesh->TileIndexCount = (unsigned int)indices.size();
+	rpOceanMesh->VertexBytes = vertices.size() * sizeof(Vertex);
+	rpOceanMesh->IndexBytes = indices.size() * sizeof(unsigned int);
+}
+
+// Mesh without vertex nor index buffer, drawn with glDrawArrays. The vertex shader only reads gl_VertexID
+static void _create_vertexless_mesh(OceanMesh* rpOceanMesh, unsigned int rVertexCount)
+{
+	Mesh* pMesh = &rpOceanMesh->Mesh;
+	pMesh->Vao = create_vao();
+	pMesh->Vbo = VertexBuffer{ 0 };
+	pMesh->Ibo = IndexBuffer{ 0 };
+	pMesh->IndexType = GL_UNSIGNED_INT;
+	pMesh->PrimitiveType = GL_TRIANGLES;
+	_set_single_submesh(pMesh, rVertexCount);
+
+	rpOceanMesh->TileResolution = 0;
+	rpOceanMesh->TileIndexCount = rVertexCount;
+	rpOceanMesh->VertexBytes = 0;
+	rpOceanMesh->IndexBytes = 0;
+}
+
+// The finest ring is drawn whole: its hole first, then every ring. 6 vertices per quad
+static unsigned int _get_clipmap_vertex_count()
+{
+	unsigned int holeQuads = (OCEAN_CLIPMAP_RESOLUTION / 2) * (OCEAN_CLIPMAP_RESOLUTION / 2);
+	unsigned int ringQuads = OCEAN_CLIPMAP_RESOLUTION * OCEAN_CLIPMAP_RESOLUTION - holeQuads;
+	return (holeQuads + ringQuads * OCEAN_CLIPMAP_LEVELS) * 6;
+}
+
+// Builds the mesh for the type and layout of rpOceanMesh
+static void _create_ocean_mesh(OceanMesh* rpOceanMesh)
+{
+	unsigned int resolution = 0;
+	switch (rpOceanMesh->Type)
+	{
+		case OceanMeshType::CDLOD:
+		{
+			resolution = OCEAN_CDLOD_PATCH_RESOLUTION;
+		} break;
+
+		case OceanMeshType::Clipmap:
+		{
+			_create_vertexless_mesh(rpOceanMesh, _get_clipmap_vertex_count());
+			rpOceanMesh->TilesPerSide = 1;
+		} return;
+
+		case OceanMeshType::ProjectedGrid:
+		{
+			resolution = OCEAN_PROJECTED_GRID_RESOLUTION;
+		} break;
+
+		default:
+		{
+			resolution = OCEAN_GRID_SIZE;
+		} break;
+	}
+
+	// CDLOD patches are already small, they are a single tile
+	bool tiled = rpOceanMesh->CompactVertices && rpOceanMesh->Type != OceanMeshType::CDLOD;
+	unsigned int tileResolution = tiled ? OCEAN_TILE_RESOLUTION : resolution;
+	rpOceanMesh->TilesPerSide = resolution / tileResolution;
+	if (rpOceanMesh->CompactVertices)
+	{
+		_create_tile_mesh(rpOceanMesh, tileResolution);
+	}
+	else
+	{
+		_create_legacy_grid_mesh(rpOceanMesh, tileResolution);
+	}
+}
+
+static void _release_ocean_mesh(Mesh* rpMesh)
+{
+	release_mesh(rpMesh);
+	CE_DEALLOC(rpMesh->Submeshes);
+	rpMesh->Submeshes = nullptr;
+	rpMesh->SubmeshCount = 0;
+}
+
+static float _get_cdlod_node_size(unsigned int rLevel)
+{
+	return OCEAN_CDLOD_LEAF_SIZE * (float)(1u << rLevel);
+}
+
+static float _get_cdlod_range(unsigned int rLevel)
+{
+	return OCEAN_CDLOD_RANGE_FACTOR * _get_cdlod_node_size(rLevel);
+}
+
+static glm::mat4x4 _get_view_projection(const CameraInfo* rpCamera)
+{
+	const RenderData& renderData = get_renderer_data();
+	float aspect = renderData.ViewportSizePx.y > 0.0f ? renderData.ViewportSizePx.x / renderData.ViewportSizePx.y : 1.0f;
+	return camera_get_projection_matrix(rpCamera, aspect) * camera_get_view_matrix(rpCamera);
+}
+
+// Planes of the view frustum (Gribb-Hartmann), pointing inside. glm matrices are column major
+static void _extract_frustum_planes(const glm::mat4x4& rViewProjection, glm::vec4* rpOutPlanes)
+{
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++)
+	{
+		row[i] = glm::vec4(rViewProjection[0][i], rViewProjection[1][i], rViewProjection[2][i], rViewProjection[3][i]);
+	}
+
+	rpOutPlanes[0] = row[3] + row[0];
+	rpOutPlanes[1] = row[3] - row[0];
+	rpOutPlanes[2] = row[3] + row[1];
+	rpOutPlanes[3] = row[3] - row[1];
+	rpOutPlanes[4] = row[3] + row[2];
+	rpOutPlanes[5] = row[3] - row[2];
+}
+
+static bool _is_box_in_frustum(const _CdlodSelection& rSelection, const glm::vec3& rMin, const glm::vec3& rMax)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = rSelection.FrustumPlanes[i];
+
+		// Corner of the box furthest along the plane normal
+		glm::vec3 corner(plane.x >= 0.0f ? rMax.x : rMin.x, plane.y >= 0.0f ? rMax.y : rMin.y, plane.z >= 0.0f ? rMax.z : rMin.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// The LOD distance is measured to the rest surface (y = 0), like the morph in basic_shader
+static bool _is_node_in_range(const _CdlodSelection& rSelection, glm::vec2 rOrigin, float rSize, float rRange)
+{
+	glm::vec2 camera(rSelection.CameraPosition.x, rSelection.CameraPosition.z);
+	glm::vec2 closest = glm::clamp(camera, rOrigin, rOrigin + rSize);
+	glm::vec3 offset(closest.x - camera.x, rSelection.CameraPosition.y, closest.y - camera.y);
+	return glm::dot(offset, offset) <= rRange * rRange;
+}
+
+static void _select_cdlod_node(OceanMesh* rpOceanMesh, const _CdlodSelection& rSelection, glm::vec2 rOrigin, unsigned int rLevel)
+{
+	float size = _get_cdlod_node_size(rLevel);
+
+	// Bounds of everything the waves can do inside the node
+	glm::vec3 boundsMin(rOrigin.x - rSelection.MaxHorizontal, -rSelection.MaxHeight, rOrigin.y - rSelection.MaxHorizontal);
+	glm::vec3 boundsMax(rOrigin.x + size + rSelection.MaxHorizontal, rSelection.MaxHeight, rOrigin.y + size + rSelection.MaxHorizontal);
+	if (!_is_box_in_frustum(rSelection, boundsMin, boundsMax))
+	{
+		return;
+	}
+
+	if (rLevel > 0 && _is_node_in_range(rSelection, rOrigin, size, rSelection.Ranges[rLevel - 1]))
+	{
+		float half = size * 0.5f;
+		_select_cdlod_node(rpOceanMesh, rSelection, rOrigin, rLevel - 1);
+		_select_cdlod_node(rpOceanMesh, rSelection, rOrigin + glm::vec2(half, 0.0f), rLevel - 1);
+		_select_cdlod_node(rpOceanMesh, rSelection, rOrigin + glm::vec2(0.0f, half), rLevel - 1);
+		_select_cdlod_node(rpOceanMesh, rSelection, rOrigin + glm::vec2(half, half), rLevel - 1);
+		return;
+	}
+
+	if (rpOceanMesh->Patches.size() < OCEAN_CDLOD_MAX_PATCHES)
+	{
+		rpOceanMesh->Patches.push_back(OceanMeshPatch{ rOrigin, size, (float)rLevel });
+	}
+}
+
+static void _select_cdlod(OceanMesh* rpOceanMesh, const Ocean* rpOcean, const CameraInfo* rpCamera)
+{
+	_CdlodSelection selection;
+	_extract_frustum_planes(_get_view_projection(rpCamera), selection.FrustumPlanes);
+	selection.CameraPosition = rpCamera->Position;
+	ocean_get_displacement_bounds(rpOcean, &selection.MaxHeight, &selection.MaxHorizontal);
+	for (unsigned int i = 0; i < OCEAN_CDLOD_LEVELS; i++)
+	{
+		selection.Ranges[i] = _get_cdlod_range(i);
+	}
+
+	// 3x3 roots snapped around the camera, so the surface reaches at least one root size in every direction
+	rpOceanMesh->Patches.clear();
+	unsigned int rootLevel = OCEAN_CDLOD_LEVELS - 1;
+	float rootSize = _get_cdlod_node_size(rootLevel);
+	glm::vec2 rootOrigin = glm::floor(glm::vec2(rpCamera->Position.x, rpCamera->Position.z) / rootSize) * rootSize;
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			_select_cdlod_node(rpOceanMesh, selection, rootOrigin + glm::vec2((float)x, (float)z) * rootSize, rootLevel);
+		}
+	}
+}
+
+static void _upload_cdlod_patches(OceanMesh* rpOceanMesh)
+{
+	// The draw that read the previous segment has been issued by now
+	if (rpOceanMesh->PatchRingPending)
+	{
+		stream_buffer_fence(&rpOceanMesh->PatchRing);
+	}
+
+	void* pSegment = stream_buffer_begin(&rpOceanMesh->PatchRing);
+	memcpy(pSegment, rpOceanMesh->Patches.data(), rpOceanMesh->Patches.size() * sizeof(OceanMeshPatch));
+	GLintptr offset = stream_buffer_end(&rpOceanMesh->PatchRing);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, OCEAN_PATCH_BINDING, rpOceanMesh->PatchRing.Id, offset, rpOceanMesh->PatchRing.SegmentSize);
+	rpOceanMesh->PatchRingPending = true;
+}
+
+static void _write_cdlod_morph_to_shader(Shader* rpShader)
+{
+	for (unsigned int i = 0; i < OCEAN_CDLOD_LEVELS; i++)
+	{
+		// morph = 1 - clamp(x - distance * y, 0, 1). The last level has no coarser one to morph into
+		glm::vec2 morph(1.0f, 0.0f);
+		if (i + 1 < OCEAN_CDLOD_LEVELS)
+		{
+			float end = _get_cdlod_range(i);
+			float start = end * OCEAN_CDLOD_MORPH_START;
+			morph = glm::vec2(end / (end - start), 1.0f / (end - start));
+		}
+		std::string name = "uCdlodMorph[" + std::to_string(i) + "]";
+		set_uniform_vec2(rpShader, name.c_str(), morph);
+	}
+}
+
+// Every ring is centered on the camera snapped to twice its spacing, so its origin is on the grid of the next
+// ring and the morph works on even/odd vertex indices. The hole of a ring is where the previous one lies,
+// OCEAN_CLIPMAP_RESOLUTION / 4 quads from its origin plus one on the axes where the snapping differs
+static void _write_clipmap_to_shader(const CameraInfo* rpCamera, Shader* rpShader)
+{
+	glm::vec2 camera(rpCamera->Position.x, rpCamera->Position.z);
+	glm::vec2 previousOrigin(0.0f);
+	for (unsigned int i = 0; i < OCEAN_CLIPMAP_LEVELS; i++)
+	{
+		float spacing = OCEAN_CLIPMAP_SPACING * (float)(1u << i);
+		glm::vec2 center = glm::floor(camera / (2.0f * spacing)) * (2.0f * spacing);
+		glm::vec2 origin = center - glm::vec2(OCEAN_CLIPMAP_RESOLUTION * 0.5f * spacing);
+		glm::vec2 hole = i == 0 ? glm::vec2(OCEAN_CLIPMAP_RESOLUTION / 4) : glm::round((previousOrigin - origin) / spacing);
+
+		std::string name = "uClipmapLevels[" + std::to_string(i) + "]";
+		set_uniform_vec4(rpShader, name.c_str(), glm::vec4(origin, hole));
+		previousOrigin = origin;
+	}
+	set_uniform_float(rpShader, "uClipmapSpacing", OCEAN_CLIPMAP_SPACING);
+}
+
+// Screen range (NDC) of the projected grid: every point of the frustum inside the slab the waves can reach,
+// dropped onto the rest plane and widened by the horizontal displacement. Returns false if the slab is not seen
+static bool _get_projected_grid_range(const glm::mat4x4& rViewProjection, float rMaxHeight, float rMaxHorizontal, glm::vec4* rpOutRange)
+{
+	glm::mat4x4 inverseViewProjection = glm::inverse(rViewProjection);
+	glm::vec3 corners[8];
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 corner = inverseViewProjection * glm::vec4(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+		corners[i] = glm::vec3(corner) / corner.w;
+	}
+
+	std::vector<glm::vec3> points;
+	for (int i = 0; i < 8; i++)
+	{
+		if (fabsf(corners[i].y) <= rMaxHeight)
+		{
+			points.push_back(corners[i]);
+		}
+
+		// Edges of the frustum: corners that differ in one coordinate
+		for (int axis = 1; axis < 8; axis <<= 1)
+		{
+			if ((i & axis) != 0)
+			{
+				continue;
+			}
+
+			const glm::vec3& a = corners[i];
+			const glm::vec3& b = corners[i | axis];
+			for (float planeHeight : { -rMaxHeight, rMaxHeight })
+			{
+				if ((a.y - planeHeight) * (b.y - planeHeight) < 0.0f)
+				{
+					points.push_back(a + (b - a) * ((planeHeight - a.y) / (b.y - a.y)));
+				}
+			}
+		}
+	}
+
+	if (points.empty())
+	{
+		return false;
+	}
+
+	glm::vec2 rangeMin(OCEAN_PROJECTED_GRID_MAX_RANGE);
+	glm::vec2 rangeMax(-OCEAN_PROJECTED_GRID_MAX_RANGE);
+	const glm::vec2 offsets[5] = { glm::vec2(0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(-1.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, -1.0f) };
+	for (const glm::vec3& point : points)
+	{
+		for (const glm::vec2& offset : offsets)
+		{
+			glm::vec4 clip = rViewProjection * glm::vec4(point.x + offset.x * rMaxHorizontal, 0.0f, point.z + offset.y * rMaxHorizontal, 1.0f);
+			if (clip.w <= 1e-4f)
+			{
+				// Behind the camera, below it when it is inside the slab. It can show at the bottom and both sides
+				rangeMin = glm::vec2(-OCEAN_PROJECTED_GRID_MAX_RANGE);
+				rangeMax.x = OCEAN_PROJECTED_GRID_MAX_RANGE;
+				continue;
+			}
+			glm::vec2 ndc = glm::vec2(clip) / clip.w;
+			rangeMin = glm::min(rangeMin, ndc);
+			rangeMax = glm::max(rangeMax, ndc);
+		}
+	}
+
+	rangeMin = glm::max(rangeMin, glm::vec2(-OCEAN_PROJECTED_GRID_MAX_RANGE));
+	rangeMax = glm::min(rangeMax, glm::vec2(OCEAN_PROJECTED_GRID_MAX_RANGE));
+	*rpOutRange = glm::vec4(rangeMin, rangeMax);
+	return rangeMin.x < rangeMax.x && rangeMin.y < rangeMax.y;
+}
+
+static bool _write_projected_grid_to_shader(const Ocean* rpOcean, const CameraInfo* rpCamera, Shader* rpShader)
+{
+	float maxHeight, maxHorizontal;
+	ocean_get_displacement_bounds(rpOcean, &maxHeight, &maxHorizontal);
+
+	glm::mat4x4 viewProjection = _get_view_projection(rpCamera);
+	glm::vec4 range;
+	if (!_get_projected_grid_range(viewProjection, maxHeight, maxHorizontal, &range))
+	{
+		return false;
+	}
+
+	set_uniform_mat4(rpShader, "uProjectedGridInverseViewProjection", glm::inverse(viewProjection));
+	set_uniform_vec4(rpShader, "uProjectedGridRange", range);
+	set_uniform_float(rpShader, "uProjectedGridResolution", (float)OCEAN_PROJECTED_GRID_RESOLUTION);
+	return true;
+}
+
+void ocean_mesh_init(OceanMesh* rpOceanMesh, OceanMeshType rType)
+{
+	rpOceanMesh->PatchRing = create_stream_buffer(GL_SHADER_STORAGE_BUFFER, OCEAN_CDLOD_MAX_PATCHES * sizeof(OceanMeshPatch));
+	rpOceanMesh->PatchRingPending = false;
+	rpOceanMesh->Patches.reserve(OCEAN_CDLOD_MAX_PATCHES);
+	rpOceanMesh->VertexCount = 0;
+	rpOceanMesh->TriangleCount = 0;
+	rpOceanMesh->Mesh.Submeshes = nullptr;
+
+	rpOceanMesh->Type = rType;
+	rpOceanMesh->CompactVertices = true;
+	_create_ocean_mesh(rpOceanMesh);
+}
+
+void ocean_mesh_release(OceanMesh* rpOceanMesh)
+{
+	_release_ocean_mesh(&rpOceanMesh->Mesh);
+	release_stream_buffer(rpOceanMesh->PatchRing);
+	rpOceanMesh->PatchRingPending = false;
+}
+
+void ocean_mesh_set_type(OceanMesh* rpOceanMesh, OceanMeshType rType)
+{
+	if (rpOceanMesh->Type == rType)
+	{
+		return;
+	}
+
+	_release_ocean_mesh(&rpOceanMesh->Mesh);
+	rpOceanMesh->Type = rType;
+	_create_ocean_mesh(rpOceanMesh);
+}
+
+void ocean_mesh_set_compact_vertices(OceanMesh* rpOceanMesh, bool rCompact)
+{
+	if (rpOceanMesh->CompactVertices == rCompact)
+	{
+		return;
+	}
+
+	_release_ocean_mesh(&rpOceanMesh->Mesh);
+	rpOceanMesh->CompactVertices = rCompact;
+	_create_ocean_mesh(rpOceanMesh);
+}
+
+void ocean_mesh_update(OceanMesh* rpOceanMesh, const Ocean* rpOcean, const CameraInfo* rpCamera, Shader* rpShader)
+{
+	set_uniform_int(rpShader, "uOceanMeshType", (int)rpOceanMesh->Type);
+	set_uniform_float(rpShader, "uGridTileResolution", (float)rpOceanMesh->TileResolution);
+	set_uniform_int(rpShader, "uGridTilesPerSide", (int)rpOceanMesh->TilesPerSide);
+
+	Submesh& submesh = rpOceanMesh->Mesh.Submeshes[0];
+	unsigned int tileCount = rpOceanMesh->TilesPerSide * rpOceanMesh->TilesPerSide;
+	unsigned int tileVertices = (rpOceanMesh->TileResolution + 1) * (rpOceanMesh->TileResolution + 1);
+	unsigned int tileTriangles = rpOceanMesh->TileResolution * rpOceanMesh->TileResolution * 2;
+	if (rpOceanMesh->Type == OceanMeshType::Grid)
+	{
+		set_uniform_float(rpShader, "uVertexSpacing", 1.0f);
+		submesh.InstanceCount = tileCount;
+		rpOceanMesh->VertexCount = tileCount * tileVertices;
+		rpOceanMesh->TriangleCount = tileCount * tileTriangles;
+		return;
+	}
+
+	if (rpOceanMesh->Type == OceanMeshType::Clipmap)
+	{
+		_write_clipmap_to_shader(rpCamera, rpShader);
+		rpOceanMesh->VertexCount = submesh.IndexCount;
+		rpOceanMesh->TriangleCount = submesh.IndexCount / 3;
+		return;
+	}
+
+	// An instance count of 0 would be a plain draw, draw no indices instead
+	if (rpOceanMesh->Type == OceanMeshType::ProjectedGrid)
+	{
+		bool visible = _write_projected_grid_to_shader(rpOcean, rpCamera, rpShader);
+		submesh.IndexCount = visible ? rpOceanMesh->TileIndexCount : 0;
+		submesh.InstanceCount = tileCount;
+		rpOceanMesh->VertexCount = visible ? tileCount * tileVertices : 0;
+		rpOceanMesh->TriangleCount = visible ? tileCount * tileTriangles : 0;
+		return;
+	}
+
+	_select_cdlod(rpOceanMesh, rpOcean, rpCamera);
+	_upload_cdlod_patches(rpOceanMesh);
+
+	set_uniform_float(rpShader, "uCdlodPatchResolution", (float)OCEAN_CDLOD_PATCH_RESOLUTION);
+	_write_cdlod_morph_to_shader(rpShader);
+
+	unsigned int patchCount = (unsigned int)rpOceanMesh->Patches.size();
+	submesh.IndexCount = patchCount > 0 ? rpOceanMesh->TileIndexCount : 0;
+	submesh.InstanceCount = patchCount;
+	rpOceanMesh->VertexCount = patchCount * tileVertices;
+	rpOceanMesh->TriangleCount = patchCount * tileTriangles;
+}
+
+void ocean_mesh_benchmark(OceanMesh* rpOceanMesh, const Ocean* rpOcean, CameraInfo* rpCamera, Shader* rpShader,
+	unsigned int rFrameCount, const std::function<void()>& rRenderFrame)
+{
+	const OceanMeshType previousType = rpOceanMesh->Type;
+	const bool previousCompact = rpOceanMesh->CompactVertices;
+	const glm::vec3 previousPosition = rpCamera->Position;
+	const float heights[] = OCEAN_MESH_BENCHMARK_HEIGHTS;
+	const char* typeNames[] = { "grid", "CDLOD", "clipmap", "projected grid" };
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	std::cout << "OCEAN::MESH::BENCHMARK - " << viewport[2] << "x" << viewport[3] << ", " << rFrameCount << " frames per mode" << std::endl;
+
+	GpuTimer timer = create_gpu_timer();
+	for (float height : heights)
+	{
+		rpCamera->Position.y = height;
+		std::cout << "  camera at " << height << "m" << std::endl;
+
+		for (int type = 0; type < 4; type++)
+		{
+			// 0: compact tiles, 1: old layout. The clipmap has no vertices
+			int layoutCount = (OceanMeshType)type == OceanMeshType::Clipmap ? 1 : 2;
+			for (int layout = 0; layout < layoutCount; layout++)
+			{
+				ocean_mesh_set_type(rpOceanMesh, (OceanMeshType)type);
+				ocean_mesh_set_compact_vertices(rpOceanMesh, layout == 0);
+
+				// Not measured, lets the driver settle after the mesh change
+				ocean_mesh_update(rpOceanMesh, rpOcean, rpCamera, rpShader);
+				rRenderFrame();
+
+				double gpuMs = 0.0;
+				double cpuMs = 0.0;
+				for (unsigned int i = 0; i < rFrameCount; i++)
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+					ocean_mesh_update(rpOceanMesh, rpOcean, rpCamera, rpShader);
+					cpuMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+					gpu_timer_begin(&timer);
+					rRenderFrame();
+					gpu_timer_end(&timer);
+					gpuMs += gpu_timer_get_ms(&timer);
+				}
+
+				unsigned int frames = std::max(rFrameCount, 1u);
+				std::cout << "    " << typeNames[type] << (layoutCount == 1 ? "" : layout == 0 ? " (compact)" : " (32 byte vertices)") << ": "
+					<< gpuMs / frames << " ms GPU, " << cpuMs / frames << " ms CPU update, "
+					<< rpOceanMesh->VertexCount << " vertices, " << rpOceanMesh->TriangleCount << " triangles, "
+					<< rpOceanMesh->VertexBytes / 1024 << " KB vertices, " << rpOceanMesh->IndexBytes / 1024 << " KB indices" << std::endl;
+			}
+		}
+	}
+	release_gpu_timer(timer);
+
+	rpCamera->Position = previousPosition;
+	ocean_mesh_set_type(rpOceanMesh, previousType);
+	ocean_mesh_set_compact_vertices(rpOceanMesh, previousCompact);
+	ocean_mesh_update(rpOceanMesh, rpOcean, rpCamera, rpShader);
+}
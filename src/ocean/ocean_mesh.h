@@ -0,0 +1,148 @@
+#ifndef OCEAN_MESH_H
+#define OCEAN_MESH_H
+
+#include <vector>
+#include <functional>
+#include <glm/vec2.hpp>
+#include "ocean.h"
+#include "../renderer/camera.h"
+#include "../renderer/data/mesh.h"
+#include "../renderer/data/shader.h"
+#include "../renderer/data/buffers/stream_buffer.h"
+
+// Geometry the ocean surface is drawn with. Every type keeps the same Mesh alive, so the ocean model can
+// point to OceanMesh::Mesh once. basic_shader builds the rest position of each vertex from uOceanMeshType.
+//
+// CDLOD: a quadtree over the camera surroundings is selected on the CPU every frame. Every selected node is
+// drawn as an instance of one small patch mesh, the node origin and size are read by gl_InstanceID from a
+// shader storage buffer. Each level is used up to a distance twice the one of the previous level, and the
+// vertices morph into the grid of the next level on the last part of their range, so levels meet without cracks.
+//
+// Clipmap: nested square rings around the camera, each one with twice the spacing of the previous one and
+// snapped to its own grid, so the ocean has no edge. There is no vertex data: the vertex shader decodes the
+// ring and the quad from gl_VertexID and places it with the per-ring uniforms. The vertices next to the outer
+// border of a ring morph into the grid of the next ring.
+//
+// Projected grid: a grid in screen space, cast every frame onto the rest plane (y = 0) from the camera, so the
+// vertex density follows the pixels. The grid covers the screen area where the rest plane can show once the
+// waves displace it, found from the frustum and the displacement bounds. Rays that miss the plane or go past
+// the far plane are clamped to the far distance, below the horizon.
+//
+// The grids are built from tiles of OceanVertex, 4 bytes with the integer grid coordinates, indexed with 16 bit
+// triangle strips split by primitive restart. The fixed grid and the projected grid draw one tile per instance.
+// The old layout (32 byte Vertex, one 32 bit triangle list for the whole grid) is kept for the benchmark.
+
+// Shader storage binding of the selected patches. Must match basic_shader.vert
+#define OCEAN_PATCH_BINDING 2
+
+// Quads along each side of the fixed grid, 1m apart
+#define OCEAN_GRID_SIZE 1024
+
+// Quads along each side of a tile of the fixed and projected grids. Its vertices must fit 16 bit indices
+#define OCEAN_TILE_RESOLUTION 128
+
+// Levels of the quadtree, level 0 is the finest. Must match basic_shader.vert
+#define OCEAN_CDLOD_LEVELS 9
+// Side in meters of the level 0 nodes and quads along each side of the patch mesh
+#define OCEAN_CDLOD_LEAF_SIZE 32.0f
+#define OCEAN_CDLOD_PATCH_RESOLUTION 32
+// Range of level 0 in leaf sizes. Must keep the nodes next to a coarser one inside its morph area
+#define OCEAN_CDLOD_RANGE_FACTOR 6.0f
+// Fraction of the range of a level where its vertices start to morph into the next one
+#define OCEAN_CDLOD_MORPH_START 0.85f
+#define OCEAN_CDLOD_MAX_PATCHES 4096
+
+// Rings and quads along each side of a ring (multiple of 4, the hole is half of it). Must match basic_shader.vert
+#define OCEAN_CLIPMAP_LEVELS 8
+#define OCEAN_CLIPMAP_RESOLUTION 128
+// Spacing of the finest ring in meters
+#define OCEAN_CLIPMAP_SPACING 1.0f
+
+// Quads along each side of the projected grid, a multiple of OCEAN_TILE_RESOLUTION
+#define OCEAN_PROJECTED_GRID_RESOLUTION 256
+// Largest screen range (NDC) the projected grid may cover, the waves near the border can bring in rest positions
+// from outside of the screen
+#define OCEAN_PROJECTED_GRID_MAX_RANGE 2.0f
+
+// Camera heights of ocean_mesh_benchmark
+#define OCEAN_MESH_BENCHMARK_HEIGHTS { 2.0f, 10.0f, 50.0f, 250.0f }
+
+enum class OceanMeshType
+{
+	Grid = 0,
+	CDLOD,
+	Clipmap,
+	ProjectedGrid
+};
+
+// Vertex of the compact grids
+typedef struct
+{
+	unsigned short X;
+	unsigned short Z;
+} OceanVertex;
+
+// One selected node. Same layout as the std430 Patch struct in basic_shader.vert
+typedef struct
+{
+	glm::vec2 Origin;
+	float Size;
+	float Level;
+} OceanMeshPatch;
+
+typedef struct
+{
+	OceanMeshType Type;
+	Mesh Mesh;
+
+	// Compact tiles or the old layout
+	bool CompactVertices;
+
+	// Quads along each side of the mesh, tiles along each side of the fixed and projected grids,
+	// indices of one tile and GPU memory of the buffers
+	unsigned int TileResolution;
+	unsigned int TilesPerSide;
+	unsigned int TileIndexCount;
+	size_t VertexBytes;
+	size_t IndexBytes;
+
+	// CDLOD selection of the last update, streamed to OCEAN_PATCH_BINDING
+	std::vector<OceanMeshPatch> Patches;
+	StreamBuffer PatchRing;
+	bool PatchRingPending;
+
+	// Vertices processed and triangles drawn by the last update, for the UI
+	unsigned int VertexCount;
+	unsigned int TriangleCount;
+} OceanMesh;
+
+void ocean_mesh_init(OceanMesh* rpOceanMesh, OceanMeshType rType);
+
+void ocean_mesh_release(OceanMesh* rpOceanMesh);
+
+/// <summary>
+/// Rebuilds the mesh for rType. OceanMesh::Mesh keeps its address
+/// </summary>
+void ocean_mesh_set_type(OceanMesh* rpOceanMesh, OceanMeshType rType);
+
+/// <summary>
+/// Rebuilds the mesh with compact tiles or with the old vertex layout. The clipmap has no vertices either way
+/// </summary>
+void ocean_mesh_set_compact_vertices(OceanMesh* rpOceanMesh, bool rCompact);
+
+/// <summary>
+/// Selects the geometry seen by rpCamera, uploads it and writes the uniforms of basic_shader. Must be called
+/// every frame before the ocean is drawn
+/// </summary>
+void ocean_mesh_update(OceanMesh* rpOceanMesh, const Ocean* rpOcean, const CameraInfo* rpCamera, Shader* rpShader);
+
+/// <summary>
+/// Renders rFrameCount frames with every mesh type and vertex layout at each of OCEAN_MESH_BENCHMARK_HEIGHTS, printing
+/// the GPU time, the CPU time of ocean_mesh_update, the vertex and triangle counts and the buffer sizes.
+/// The camera, the type and the layout are restored after.
+/// rRenderFrame must draw a full frame with rpCamera without swapping buffers
+/// </summary>
+void ocean_mesh_benchmark(OceanMesh* rpOceanMesh, const Ocean* rpOcean, CameraInfo* rpCamera, Shader* rpShader,
+	unsigned int rFrameCount, const std::function<void()>& rRenderFrame);
+
+#endif // !OCEAN_MESH_H
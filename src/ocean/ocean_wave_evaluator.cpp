@@ -0,0 +1,346 @@
+#include "ocean_wave_evaluator.h"
+#include "private/_wave_kernels.h"
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <glm/geometric.hpp>
+
+#ifdef OCEAN_SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// ------------------------------------
+// Kernels
+// ------------------------------------
+
+void _ocean_evaluate8_scalar(const _OceanOctaveView& rOctaves, const float* rpX, const float* rpZ, float* rpOutX, float* rpOutY, float* rpOutZ)
+{
+	for (int p = 0; p < OCEAN_EVALUATOR_BATCH; p++)
+	{
+		float x = rpX[p];
+		float z = rpZ[p];
+		float outX = x, outY = 0.0f, outZ = z;
+		for (unsigned int i = 0; i < rOctaves.Count; ++i)
+		{
+			float phase = rOctaves.Kx[i] * x + rOctaves.Kz[i] * z + rOctaves.Phase[i];
+			float s, c;
+			_fast_sincos(phase, &s, &c);
+			outX += rOctaves.QAx[i] * c;
+			outZ += rOctaves.QAz[i] * c;
+			outY += rOctaves.A[i] * s;
+		}
+		rpOutX[p] = outX;
+		rpOutY[p] = outY;
+		rpOutZ[p] = outZ;
+	}
+}
+
+typedef void (*_OceanKernelFunc)(const _OceanOctaveView&, const float*, const float*, float*, float*, float*);
+
+static _OceanKernelFunc _get_kernel(OceanSimdLevel rLevel)
+{
+	switch (rLevel)
+	{
+#ifdef OCEAN_SIMD_X86
+		case OceanSimdLevel::AVX2: return _ocean_evaluate8_avx2;
+		case OceanSimdLevel::SSE4: return _ocean_evaluate8_sse4;
+#endif
+		case OceanSimdLevel::Scalar:
+		default:
+			return _ocean_evaluate8_scalar;
+	}
+}
+
+static _OceanOctaveView _get_octave_view(const OceanWaveEvaluator* rpEvaluator)
+{
+	return _OceanOctaveView{
+		rpEvaluator->Kx.data(),
+		rpEvaluator->Kz.data(),
+		rpEvaluator->Phase.data(),
+		rpEvaluator->A.data(),
+		rpEvaluator->QAx.data(),
+		rpEvaluator->QAz.data(),
+		rpEvaluator->OctaveCount
+	};
+}
+
+// ------------------------------------
+// CPU features
+// ------------------------------------
+
+OceanSimdLevel ocean_get_supported_simd_level()
+{
+	static int s_Detected = -1;
+	if (s_Detected >= 0)
+	{
+		return (OceanSimdLevel)s_Detected;
+	}
+
+	OceanSimdLevel level = OceanSimdLevel::Scalar;
+#ifdef OCEAN_SIMD_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	bool osAvx = osxsave && ((_xgetbv(0) & 6) == 6);
+
+	if (sse41) level = OceanSimdLevel::SSE4;
+	if (avx && osAvx && avx2 && fma) level = OceanSimdLevel::AVX2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.1")) level = OceanSimdLevel::SSE4;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) level = OceanSimdLevel::AVX2;
+#endif
+#endif
+
+	s_Detected = (int)level;
+	return level;
+}
+
+const char* ocean_simd_level_name(OceanSimdLevel rLevel)
+{
+	switch (rLevel)
+	{
+		case OceanSimdLevel::AVX2: return "AVX2";
+		case OceanSimdLevel::SSE4: return "SSE4";
+		case OceanSimdLevel::Scalar:
+		default:
+			return "Scalar";
+	}
+}
+
+// ------------------------------------
+// Evaluator
+// ------------------------------------
+
+void ocean_evaluator_init(OceanWaveEvaluator* rpEvaluator, const OceanWaveParams& rParams)
+{
+	rpEvaluator->Time = 0.0f;
+	rpEvaluator->SimdLevel = ocean_get_supported_simd_level();
+	ocean_evaluator_set_params(rpEvaluator, rParams);
+}
+
+void ocean_evaluator_set_params(OceanWaveEvaluator* rpEvaluator, const OceanWaveParams& rParams)
+{
+	rpEvaluator->Params = rParams;
+
+	wave_table_build(&rpEvaluator->Table, rParams);
+
+	unsigned int count = (unsigned int)rpEvaluator->Table.Entries.size();
+	rpEvaluator->Kx.resize(count);
+	rpEvaluator->Kz.resize(count);
+	rpEvaluator->Speed.resize(count);
+	rpEvaluator->Phase.resize(count);
+	rpEvaluator->A.resize(count);
+	rpEvaluator->QAx.resize(count);
+	rpEvaluator->QAz.resize(count);
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const WaveTableEntry& wave = rpEvaluator->Table.Entries[i];
+		rpEvaluator->Kx[i] = wave.K * wave.Direction.x;
+		rpEvaluator->Kz[i] = wave.K * wave.Direction.y;
+		rpEvaluator->Speed[i] = wave.Speed;
+		rpEvaluator->A[i] = wave.A;
+		rpEvaluator->QAx[i] = wave.QA * wave.Direction.x;
+		rpEvaluator->QAz[i] = wave.QA * wave.Direction.y;
+	}
+
+	rpEvaluator->OctaveCount = count;
+	ocean_evaluator_set_time(rpEvaluator, rpEvaluator->Time);
+}
+
+void ocean_evaluator_set_time(OceanWaveEvaluator* rpEvaluator, float rTime)
+{
+	rpEvaluator->Time = rTime;
+	for (unsigned int i = 0; i < rpEvaluator->OctaveCount; ++i)
+	{
+		rpEvaluator->Phase[i] = rTime * rpEvaluator->Speed[i];
+	}
+}
+
+void ocean_evaluator_set_simd_level(OceanWaveEvaluator* rpEvaluator, OceanSimdLevel rLevel)
+{
+	OceanSimdLevel supported = ocean_get_supported_simd_level();
+	rpEvaluator->SimdLevel = (int)rLevel <= (int)supported ? rLevel : supported;
+}
+
+void ocean_evaluate_positions(const OceanWaveEvaluator* rpEvaluator, const float* rpX, const float* rpZ,
+	float* rpOutX, float* rpOutY, float* rpOutZ, size_t rCount)
+{
+	_OceanKernelFunc kernel = _get_kernel(rpEvaluator->SimdLevel);
+	_OceanOctaveView octaves = _get_octave_view(rpEvaluator);
+
+	size_t i = 0;
+	for (; i + OCEAN_EVALUATOR_BATCH <= rCount; i += OCEAN_EVALUATOR_BATCH)
+	{
+		kernel(octaves, rpX + i, rpZ + i, rpOutX + i, rpOutY + i, rpOutZ + i);
+	}
+
+	// Tail: pad to a full batch so every point goes through the same kernel
+	if (i < rCount)
+	{
+		size_t remaining = rCount - i;
+		float x[OCEAN_EVALUATOR_BATCH] = { 0 }, z[OCEAN_EVALUATOR_BATCH] = { 0 };
+		float outX[OCEAN_EVALUATOR_BATCH], outY[OCEAN_EVALUATOR_BATCH], outZ[OCEAN_EVALUATOR_BATCH];
+		std::copy(rpX + i, rpX + rCount, x);
+		std::copy(rpZ + i, rpZ + rCount, z);
+		kernel(octaves, x, z, outX, outY, outZ);
+		std::copy(outX, outX + remaining, rpOutX + i);
+		std::copy(outY, outY + remaining, rpOutY + i);
+		std::copy(outZ, outZ + remaining, rpOutZ + i);
+	}
+}
+
+void ocean_evaluate_normals(const OceanWaveEvaluator* rpEvaluator, const float* rpX, const float* rpZ,
+	glm::vec3* rpOutNormal, size_t rCount)
+{
+	_OceanOctaveView octaves = _get_octave_view(rpEvaluator);
+
+	for (size_t p = 0; p < rCount; p++)
+	{
+		float x = rpX[p];
+		float z = rpZ[p];
+
+		// Partial derivatives of the displaced position (x + Dx, h, z + Dz) with respect to x and z
+		float dDxdx = 0.0f, dDxdz = 0.0f, dDzdx = 0.0f, dDzdz = 0.0f;
+		float dHdx = 0.0f, dHdz = 0.0f;
+		for (unsigned int i = 0; i < octaves.Count; ++i)
+		{
+			float phase = octaves.Kx[i] * x + octaves.Kz[i] * z + octaves.Phase[i];
+			float s, c;
+			_fast_sincos(phase, &s, &c);
+
+			float ac = octaves.A[i] * c;
+			dHdx += ac * octaves.Kx[i];
+			dHdz += ac * octaves.Kz[i];
+
+			float qxs = octaves.QAx[i] * s;
+			float qzs = octaves.QAz[i] * s;
+			dDxdx -= qxs * octaves.Kx[i];
+			dDxdz -= qxs * octaves.Kz[i];
+			dDzdx -= qzs * octaves.Kx[i];
+			dDzdz -= qzs * octaves.Kz[i];
+		}
+
+		glm::vec3 tangentX(1.0f + dDxdx, dHdx, dDzdx);
+		glm::vec3 tangentZ(dDxdz, dHdz, 1.0f + dDzdz);
+		rpOutNormal[p] = glm::normalize(glm::cross(tangentZ, tangentX));
+	}
+}
+
+// ------------------------------------
+// Validation & benchmark
+// ------------------------------------
+
+// Double precision transcription of the fractal recurrence and get_grestner_wave_pos, using every octave
+static void _reference_position(const OceanWaveParams& rParams, float rTime, double rX, double rZ, double* rpOut)
+{
+	double outX = rX, outY = 0.0, outZ = rZ;
+	float a = rParams.Amplitude;
+	float w = rParams.Frequency;
+	float s = rParams.Speed;
+	float seed = rParams.InitialSeed;
+	for (int i = 0; i < rParams.WaveCount; ++i)
+	{
+		float angle = ((float)i + 1.0f) * 1.6180339887f * seed;
+		double dx = cos((double)angle);
+		double dz = sin((double)angle);
+		double qa = (double)rParams.Steepness / ((double)w * (double)rParams.WaveCount);
+		if (!std::isfinite(w) || !std::isfinite(a) || !std::isfinite(qa) || !std::isfinite(s))
+		{
+			break;
+		}
+
+		double x = (double)w * (dx * rX + dz * rZ) + (double)rTime * (double)s;
+		outX += qa * dx * cos(x);
+		outZ += qa * dz * cos(x);
+		outY += (double)a * sin(x);
+
+		w *= rParams.Lacunarity;
+		a *= rParams.Persistance;
+		s *= rParams.SpeedRamp;
+		seed += rParams.SeedIter;
+	}
+	rpOut[0] = outX;
+	rpOut[1] = outY;
+	rpOut[2] = outZ;
+}
+
+static void _generate_sample_points(std::vector<float>& rX, std::vector<float>& rZ, size_t rCount)
+{
+	rX.resize(rCount);
+	rZ.resize(rCount);
+	unsigned int state = 12345u;
+	for (size_t i = 0; i < rCount; i++)
+	{
+		state = state * 1664525u + 1013904223u;
+		rX[i] = (float)(state >> 8) / (float)(1 << 24) * 1024.0f;
+		state = state * 1664525u + 1013904223u;
+		rZ[i] = (float)(state >> 8) / (float)(1 << 24) * 1024.0f;
+	}
+}
+
+bool ocean_evaluator_validate(const OceanWaveEvaluator* rpEvaluator, float rTolerance, float* rpOutMaxError)
+{
+	const size_t sampleCount = 4096;
+	std::vector<float> x, z;
+	_generate_sample_points(x, z, sampleCount);
+
+	std::vector<float> outX(sampleCount), outY(sampleCount), outZ(sampleCount);
+	ocean_evaluate_positions(rpEvaluator, x.data(), z.data(), outX.data(), outY.data(), outZ.data(), sampleCount);
+
+	double maxError = 0.0;
+	for (size_t i = 0; i < sampleCount; i++)
+	{
+		double ref[3];
+		_reference_position(rpEvaluator->Params, rpEvaluator->Time, x[i], z[i], ref);
+		maxError = std::max(maxError, fabs(ref[0] - outX[i]));
+		maxError = std::max(maxError, fabs(ref[1] - outY[i]));
+		maxError = std::max(maxError, fabs(ref[2] - outZ[i]));
+	}
+
+	if (rpOutMaxError != nullptr)
+	{
+		*rpOutMaxError = (float)maxError;
+	}
+	return maxError <= rTolerance;
+}
+
+void ocean_evaluator_benchmark(const OceanWaveEvaluator* rpEvaluator, size_t rPointCount)
+{
+	std::vector<float> x, z;
+	_generate_sample_points(x, z, rPointCount);
+	std::vector<float> outX(rPointCount), outY(rPointCount), outZ(rPointCount);
+
+	std::cout << "OCEAN::EVALUATOR::BENCHMARK - " << rPointCount << " points, "
+		<< rpEvaluator->OctaveCount << "/" << rpEvaluator->Params.WaveCount << " octaves evaluated" << std::endl;
+
+	OceanSimdLevel supported = ocean_get_supported_simd_level();
+	for (int level = 0; level <= (int)supported; level++)
+	{
+		OceanWaveEvaluator evaluator = *rpEvaluator;
+		evaluator.SimdLevel = (OceanSimdLevel)level;
+
+		float maxError;
+		bool valid = ocean_evaluator_validate(&evaluator, 1e-3f, &maxError);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		ocean_evaluate_positions(&evaluator, x.data(), z.data(), outX.data(), outY.data(), outZ.data(), rPointCount);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		double seconds = std::chrono::duration<double>(end - start).count();
+		std::cout << "  " << ocean_simd_level_name(evaluator.SimdLevel) << ": "
+			<< (rPointCount / seconds) / 1e6 << " Mpoints/s, max error " << maxError << " m"
+			<< (valid ? "" : " (OUT OF TOLERANCE)") << std::endl;
+	}
+}
@@ -0,0 +1,102 @@
+#ifndef OCEAN_WAVE_EVALUATOR_H
+#define OCEAN_WAVE_EVALUATOR_H
+
+#include <vector>
+#include <cstddef>
+#include <glm/vec3.hpp>
+#include "wave_table.h"
+
+// CPU version of get_grestner_wave_pos (res/shaders/basic_shader.vert). It reads the same wave table
+// as the shader, so the host side can ask for the displaced surface without reading back GPU data.
+
+// Number of points processed on every kernel call
+#define OCEAN_EVALUATOR_BATCH 8
+
+enum class OceanSimdLevel
+{
+	Scalar = 0,
+	SSE4,
+	AVX2
+};
+
+typedef struct
+{
+	OceanWaveParams Params;
+	float Time;
+
+	OceanSimdLevel SimdLevel;
+
+	// Octave constants shared with the shader
+	WaveTable Table;
+
+	// The table repacked as SoA for the kernels. Kx/Kz are the wave vector (w * d), QAx/QAz the horizontal
+	// Gerstner amplitude (q * a * d) and Phase is uTime * s for the current time
+	unsigned int OctaveCount;
+	std::vector<float> Kx;
+	std::vector<float> Kz;
+	std::vector<float> Speed;
+	std::vector<float> Phase;
+	std::vector<float> A;
+	std::vector<float> QAx;
+	std::vector<float> QAz;
+} OceanWaveEvaluator;
+
+/// <summary>
+/// Initializes the evaluator and picks the best kernel supported by the running CPU
+/// </summary>
+/// <param name="rpEvaluator">Evaluator to initialize</param>
+/// <param name="rParams">Wave parameters, same meaning as the ImGui wave sliders</param>
+void ocean_evaluator_init(OceanWaveEvaluator* rpEvaluator, const OceanWaveParams& rParams);
+
+/// <summary>
+/// Rebuilds the wave table and the per-octave constants. Must be called whenever a wave parameter changes
+/// </summary>
+void ocean_evaluator_set_params(OceanWaveEvaluator* rpEvaluator, const OceanWaveParams& rParams);
+
+/// <summary>
+/// Sets the time used for the wave phase (uTime in the shader)
+/// </summary>
+void ocean_evaluator_set_time(OceanWaveEvaluator* rpEvaluator, float rTime);
+
+/// <summary>
+/// Forces a kernel. If the CPU does not support it, the best supported one is used instead
+/// </summary>
+void ocean_evaluator_set_simd_level(OceanWaveEvaluator* rpEvaluator, OceanSimdLevel rLevel);
+
+OceanSimdLevel ocean_get_supported_simd_level();
+const char* ocean_simd_level_name(OceanSimdLevel rLevel);
+
+/// <summary>
+/// Evaluates the displaced surface position for a batch of rest positions (SoA).
+/// Output is the same value get_grestner_wave_pos returns for (x, 0, z)
+/// </summary>
+/// <param name="rpX">Rest X positions</param>
+/// <param name="rpZ">Rest Z positions</param>
+/// <param name="rpOutX">Displaced X positions</param>
+/// <param name="rpOutY">Surface height</param>
+/// <param name="rpOutZ">Displaced Z positions</param>
+/// <param name="rCount">Number of points</param>
+void ocean_evaluate_positions(const OceanWaveEvaluator* rpEvaluator, const float* rpX, const float* rpZ,
+	float* rpOutX, float* rpOutY, float* rpOutZ, size_t rCount);
+
+/// <summary>
+/// Surface normal at the displaced position of each rest position. Includes the horizontal
+/// displacement terms, so it is exact for the Gerstner surface. Same result as compute_normal_of_wave in basic_shader.frag
+/// </summary>
+void ocean_evaluate_normals(const OceanWaveEvaluator* rpEvaluator, const float* rpX, const float* rpZ,
+	glm::vec3* rpOutNormal, size_t rCount);
+
+/// <summary>
+/// Compares the active kernel against a double precision reference of the shader code
+/// </summary>
+/// <param name="rTolerance">Maximum allowed absolute error, in meters</param>
+/// <param name="rpOutMaxError">Optional. Maximum error found</param>
+/// <returns>True if every sample is within tolerance</returns>
+bool ocean_evaluator_validate(const OceanWaveEvaluator* rpEvaluator, float rTolerance, float* rpOutMaxError = nullptr);
+
+/// <summary>
+/// Validates and measures the throughput of every supported kernel on one core, printing the results
+/// </summary>
+void ocean_evaluator_benchmark(const OceanWaveEvaluator* rpEvaluator, size_t rPointCount);
+
+#endif // !OCEAN_WAVE_EVALUATOR_H
@@ -0,0 +1,57 @@
+#ifndef PRIVATE_WAVE_KERNELS_H
+#define PRIVATE_WAVE_KERNELS_H
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OCEAN_SIMD_X86
+#endif
+
+#define OCEAN_INV_TWO_PI 0.15915494309189535f
+#define OCEAN_TWO_PI 6.283185307179586f
+
+typedef struct
+{
+	const float* Kx;
+	const float* Kz;
+	const float* Phase;
+	const float* A;
+	const float* QAx;
+	const float* QAz;
+	unsigned int Count;
+} _OceanOctaveView;
+
+// Evaluate OCEAN_EVALUATOR_BATCH (8) points
+void _ocean_evaluate8_scalar(const _OceanOctaveView& rOctaves, const float* rpX, const float* rpZ, float* rpOutX, float* rpOutY, float* rpOutZ);
+
+#ifdef OCEAN_SIMD_X86
+void _ocean_evaluate8_sse4(const _OceanOctaveView& rOctaves, const float* rpX, const float* rpZ, float* rpOutX, float* rpOutY, float* rpOutZ);
+void _ocean_evaluate8_avx2(const _OceanOctaveView& rOctaves, const float* rpX, const float* rpZ, float* rpOutX, float* rpOutY, float* rpOutZ);
+#endif
+
+// Polynomial sin/cos shared by every kernel:
+// the angle is reduced to a turn fraction in [-0.5, 0.5], then to an octant in [-pi/4, pi/4].
+// Huge arguments (high octaves) collapse to a bounded value instead of producing garbage.
+inline void _fast_sincos(float rX, float* rpSin, float* rpCos)
+{
+	float t = rX * OCEAN_INV_TWO_PI;
+	t = t - std::nearbyint(t);
+	float q = std::nearbyint(t * 4.0f);
+	float r = (t - q * 0.25f) * OCEAN_TWO_PI;
+	float r2 = r * r;
+
+	float s = r * (1.0f + r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f))));
+	float c = 1.0f + r2 * (-0.5f + r2 * (1.0f / 24.0f + r2 * (-1.0f / 720.0f + r2 * (1.0f / 40320.0f))));
+
+	int quadrant = ((int)q) & 3;
+	if (quadrant & 1)
+	{
+		float tmp = s;
+		s = c;
+		c = tmp;
+	}
+	*rpSin = (quadrant & 2) ? -s : s;
+	*rpCos = ((quadrant + 1) & 2) ? -c : c;
+}
+
+#endif // !PRIVATE_WAVE_KERNELS_H
@@ -0,0 +1,68 @@
+#include "_wave_kernels.h"
+
+// This file is compiled with AVX2 + FMA enabled (see src/CMakeLists.txt). It is only called
+// after checking the CPU supports it.
+#ifdef OCEAN_SIMD_X86
+#include <immintrin.h>
+
+static inline void _fast_sincos_avx2(__m256 x, __m256* pSin, __m256* pCos)
+{
+	const __m256 invTwoPi = _mm256_set1_ps(OCEAN_INV_TWO_PI);
+	const __m256 twoPi = _mm256_set1_ps(OCEAN_TWO_PI);
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+
+	__m256 t = _mm256_mul_ps(x, invTwoPi);
+	t = _mm256_sub_ps(t, _mm256_round_ps(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+	__m256 q = _mm256_round_ps(_mm256_mul_ps(t, _mm256_set1_ps(4.0f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256 r = _mm256_mul_ps(_mm256_fnmadd_ps(q, _mm256_set1_ps(0.25f), t), twoPi);
+	__m256 r2 = _mm256_mul_ps(r, r);
+
+	__m256 s = _mm256_fmadd_ps(r2, _mm256_set1_ps(-1.0f / 5040.0f), _mm256_set1_ps(1.0f / 120.0f));
+	s = _mm256_fmadd_ps(r2, s, _mm256_set1_ps(-1.0f / 6.0f));
+	s = _mm256_fmadd_ps(r2, s, _mm256_set1_ps(1.0f));
+	s = _mm256_mul_ps(r, s);
+
+	__m256 c = _mm256_fmadd_ps(r2, _mm256_set1_ps(1.0f / 40320.0f), _mm256_set1_ps(-1.0f / 720.0f));
+	c = _mm256_fmadd_ps(r2, c, _mm256_set1_ps(1.0f / 24.0f));
+	c = _mm256_fmadd_ps(r2, c, _mm256_set1_ps(-0.5f));
+	c = _mm256_fmadd_ps(r2, c, _mm256_set1_ps(1.0f));
+
+	__m256i quadrant = _mm256_and_si256(_mm256_cvtps_epi32(q), _mm256_set1_epi32(3));
+	__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+	__m256 sinNeg = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+	__m256 cosNeg = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+
+	__m256 outS = _mm256_blendv_ps(s, c, swap);
+	__m256 outC = _mm256_blendv_ps(c, s, swap);
+	*pSin = _mm256_xor_ps(outS, _mm256_and_ps(sinNeg, signBit));
+	*pCos = _mm256_xor_ps(outC, _mm256_and_ps(cosNeg, signBit));
+}
+
+void _ocean_evaluate8_avx2(const _OceanOctaveView& rOctaves, const float* rpX, const float* rpZ, float* rpOutX, float* rpOutY, float* rpOutZ)
+{
+	__m256 x = _mm256_loadu_ps(rpX);
+	__m256 z = _mm256_loadu_ps(rpZ);
+
+	__m256 outX = x;
+	__m256 outY = _mm256_setzero_ps();
+	__m256 outZ = z;
+
+	for (unsigned int i = 0; i < rOctaves.Count; ++i)
+	{
+		__m256 phase = _mm256_fmadd_ps(_mm256_set1_ps(rOctaves.Kx[i]), x,
+			_mm256_fmadd_ps(_mm256_set1_ps(rOctaves.Kz[i]), z, _mm256_set1_ps(rOctaves.Phase[i])));
+
+		__m256 s, c;
+		_fast_sincos_avx2(phase, &s, &c);
+
+		outX = _mm256_fmadd_ps(_mm256_set1_ps(rOctaves.QAx[i]), c, outX);
+		outZ = _mm256_fmadd_ps(_mm256_set1_ps(rOctaves.QAz[i]), c, outZ);
+		outY = _mm256_fmadd_ps(_mm256_set1_ps(rOctaves.A[i]), s, outY);
+	}
+
+	_mm256_storeu_ps(rpOutX, outX);
+	_mm256_storeu_ps(rpOutY, outY);
+	_mm256_storeu_ps(rpOutZ, outZ);
+}
+
+#endif // OCEAN_SIMD_X86
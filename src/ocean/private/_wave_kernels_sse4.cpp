@@ -0,0 +1,85 @@
+#include "_wave_kernels.h"
+
+// This file is compiled with SSE4.1 enabled (see src/CMakeLists.txt). It is only called
+// after checking the CPU supports it.
+#ifdef OCEAN_SIMD_X86
+#include <smmintrin.h>
+
+static inline void _fast_sincos_sse4(__m128 x, __m128* pSin, __m128* pCos)
+{
+	const __m128 invTwoPi = _mm_set1_ps(OCEAN_INV_TWO_PI);
+	const __m128 twoPi = _mm_set1_ps(OCEAN_TWO_PI);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	__m128 t = _mm_mul_ps(x, invTwoPi);
+	t = _mm_sub_ps(t, _mm_round_ps(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+	__m128 q = _mm_round_ps(_mm_mul_ps(t, _mm_set1_ps(4.0f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m128 r = _mm_mul_ps(_mm_sub_ps(t, _mm_mul_ps(q, _mm_set1_ps(0.25f))), twoPi);
+	__m128 r2 = _mm_mul_ps(r, r);
+
+	__m128 s = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(-1.0f / 5040.0f)), _mm_set1_ps(1.0f / 120.0f));
+	s = _mm_add_ps(_mm_mul_ps(r2, s), _mm_set1_ps(-1.0f / 6.0f));
+	s = _mm_add_ps(_mm_mul_ps(r2, s), _mm_set1_ps(1.0f));
+	s = _mm_mul_ps(r, s);
+
+	__m128 c = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(1.0f / 40320.0f)), _mm_set1_ps(-1.0f / 720.0f));
+	c = _mm_add_ps(_mm_mul_ps(r2, c), _mm_set1_ps(1.0f / 24.0f));
+	c = _mm_add_ps(_mm_mul_ps(r2, c), _mm_set1_ps(-0.5f));
+	c = _mm_add_ps(_mm_mul_ps(r2, c), _mm_set1_ps(1.0f));
+
+	__m128i quadrant = _mm_and_si128(_mm_cvtps_epi32(q), _mm_set1_epi32(3));
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m128 sinNeg = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+	__m128 cosNeg = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+	__m128 outS = _mm_blendv_ps(s, c, swap);
+	__m128 outC = _mm_blendv_ps(c, s, swap);
+	*pSin = _mm_xor_ps(outS, _mm_and_ps(sinNeg, signBit));
+	*pCos = _mm_xor_ps(outC, _mm_and_ps(cosNeg, signBit));
+}
+
+void _ocean_evaluate8_sse4(const _OceanOctaveView& rOctaves, const float* rpX, const float* rpZ, float* rpOutX, float* rpOutY, float* rpOutZ)
+{
+	// Two interleaved 4-wide halves so the octave constants are only broadcast once
+	__m128 x0 = _mm_loadu_ps(rpX);
+	__m128 x1 = _mm_loadu_ps(rpX + 4);
+	__m128 z0 = _mm_loadu_ps(rpZ);
+	__m128 z1 = _mm_loadu_ps(rpZ + 4);
+
+	__m128 outX0 = x0, outX1 = x1;
+	__m128 outZ0 = z0, outZ1 = z1;
+	__m128 outY0 = _mm_setzero_ps(), outY1 = _mm_setzero_ps();
+
+	for (unsigned int i = 0; i < rOctaves.Count; ++i)
+	{
+		__m128 kx = _mm_set1_ps(rOctaves.Kx[i]);
+		__m128 kz = _mm_set1_ps(rOctaves.Kz[i]);
+		__m128 ph = _mm_set1_ps(rOctaves.Phase[i]);
+		__m128 a = _mm_set1_ps(rOctaves.A[i]);
+		__m128 qax = _mm_set1_ps(rOctaves.QAx[i]);
+		__m128 qaz = _mm_set1_ps(rOctaves.QAz[i]);
+
+		__m128 phase0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(kx, x0), _mm_mul_ps(kz, z0)), ph);
+		__m128 phase1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(kx, x1), _mm_mul_ps(kz, z1)), ph);
+
+		__m128 s0, c0, s1, c1;
+		_fast_sincos_sse4(phase0, &s0, &c0);
+		_fast_sincos_sse4(phase1, &s1, &c1);
+
+		outX0 = _mm_add_ps(outX0, _mm_mul_ps(qax, c0));
+		outX1 = _mm_add_ps(outX1, _mm_mul_ps(qax, c1));
+		outZ0 = _mm_add_ps(outZ0, _mm_mul_ps(qaz, c0));
+		outZ1 = _mm_add_ps(outZ1, _mm_mul_ps(qaz, c1));
+		outY0 = _mm_add_ps(outY0, _mm_mul_ps(a, s0));
+		outY1 = _mm_add_ps(outY1, _mm_mul_ps(a, s1));
+	}
+
+	_mm_storeu_ps(rpOutX, outX0);
+	_mm_storeu_ps(rpOutX + 4, outX1);
+	_mm_storeu_ps(rpOutY, outY0);
+	_mm_storeu_ps(rpOutY + 4, outY1);
+	_mm_storeu_ps(rpOutZ, outZ0);
+	_mm_storeu_ps(rpOutZ + 4, outZ1);
+}
+
+#endif // OCEAN_SIMD_X86
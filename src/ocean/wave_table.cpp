@@ -0,0 +1,71 @@
+#include "wave_table.h"
+
+#include <cmath>
+#include <algorithm>
+
+void wave_table_build(WaveTable* rpTable, const OceanWaveParams& rParams)
+{
+	unsigned int waveCount = rParams.WaveCount > 0 ? (unsigned int)rParams.WaveCount : 0;
+	rpTable->Entries.clear();
+	rpTable->Entries.reserve(waveCount);
+
+	float a = rParams.Amplitude;
+	float w = rParams.Frequency;
+	float s = rParams.Speed;
+	float seed = rParams.InitialSeed;
+
+	for (unsigned int i = 0; i < waveCount; ++i)
+	{
+		float angle = ((float)i + 1.0f) * 1.6180339887f * seed;
+
+		// q * a = steepness / (w * a * N) * a. Computed without a so it does not become 0/0 when a underflows
+		float qa = rParams.Steepness / (w * (float)waveCount);
+
+		if (!std::isfinite(w) || !std::isfinite(a) || !std::isfinite(qa) || !std::isfinite(s))
+		{
+			// Higher octaves overflowed/underflowed, the old per-pixel recurrence was undefined there anyway
+			break;
+		}
+
+		WaveTableEntry entry{};
+		entry.Direction = glm::vec2(cosf(angle), sinf(angle));
+		entry.K = w;
+		entry.A = a;
+		entry.QA = qa;
+		entry.Speed = s;
+		rpTable->Entries.push_back(entry);
+
+		w *= rParams.Lacunarity;
+		a *= rParams.Persistance;
+		s *= rParams.SpeedRamp;
+		seed += rParams.SeedIter;
+	}
+
+	// Drop the tail of octaves that cannot move the surface more than the epsilon
+	float tail = 0.0f;
+	while (!rpTable->Entries.empty())
+	{
+		const WaveTableEntry& last = rpTable->Entries.back();
+		float contribution = fabsf(last.A) + fabsf(last.QA);
+		if (tail + contribution >= WAVE_TABLE_TAIL_EPSILON)
+		{
+			break;
+		}
+		tail += contribution;
+		rpTable->Entries.pop_back();
+	}
+
+	rpTable->MaxHeight = 0.0f;
+	rpTable->MaxHorizontal = 0.0f;
+	for (const WaveTableEntry& entry : rpTable->Entries)
+	{
+		rpTable->MaxHeight += fabsf(entry.A);
+		rpTable->MaxHorizontal += fabsf(entry.QA);
+	}
+
+	// Shortest waves last, so the shader LOD can stop at the first octave below the sampling footprint
+	std::stable_sort(rpTable->Entries.begin(), rpTable->Entries.end(), [](const WaveTableEntry& rA, const WaveTableEntry& rB)
+	{
+		return rA.K < rB.K;
+	});
+}
@@ -0,0 +1,55 @@
+#ifndef WAVE_TABLE_H
+#define WAVE_TABLE_H
+
+#include <vector>
+#include <glm/vec2.hpp>
+
+// Per-octave constants of the Gerstner fractal, built once on the CPU whenever a wave parameter
+// changes. The CPU evaluator and both stages of basic_shader (res/shaders/ocean_waves.glsl) read
+// the same table, so the amplitude/frequency/speed/seed recurrences are not run per vertex or pixel.
+
+// Trailing octaves whose summed maximum displacement is below this value (in meters) are dropped
+#define WAVE_TABLE_TAIL_EPSILON 1e-5f
+
+typedef struct
+{
+	int WaveCount;
+	float Amplitude;
+	float Frequency;
+	float Speed;
+	float Steepness;
+	float Persistance;
+	float Lacunarity;
+	float InitialSeed;
+	float SeedIter;
+	float SpeedRamp;
+} OceanWaveParams;
+
+// One octave. Same layout as the std430 Wave struct in ocean_waves.glsl, do not reorder
+typedef struct
+{
+	glm::vec2 Direction;
+	float K;			// Angular wavenumber (w)
+	float A;			// Amplitude
+	float QA;			// Horizontal Gerstner amplitude (q * a)
+	float Speed;		// Phase speed, the phase is K * dot(Direction, xz) + Speed * uTime
+	float Padding[2];
+} WaveTableEntry;
+static_assert(sizeof(WaveTableEntry) == 32, "WaveTableEntry does not match the std430 stride of Wave");
+
+typedef struct
+{
+	// Octaves actually used, sorted by increasing K. The tail that cannot move the surface is already dropped
+	std::vector<WaveTableEntry> Entries;
+
+	// Largest possible displacement, every octave at its peak: sum of A and sum of QA
+	float MaxHeight;
+	float MaxHorizontal;
+} WaveTable;
+
+/// <summary>
+/// Runs the fractal recurrence (amplitude, frequency, speed and direction seed) once and stores the constants of every octave
+/// </summary>
+void wave_table_build(WaveTable* rpTable, const OceanWaveParams& rParams);
+
+#endif // !WAVE_TABLE_H
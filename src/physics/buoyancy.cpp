@@ -0,0 +1,332 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#include "buoyancy.h"
+
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtx/euler_angles.hpp>
+#include "../core/job_system.h"
+#include "../core/memory_utils.h"
+
+// Points per batch handed to the ocean query
+#define BUOYANCY_QUERY_GRAIN 1024
+#define BUOYANCY_BODY_GRAIN 8
+
+#define BUOYANCY_DEFAULT_LINEAR_DRAG 1.5f
+#define BUOYANCY_DEFAULT_ANGULAR_DRAG 1.0f
+
+void buoyancy_init(BuoyancyWorld* rpWorld, const Ocean* rpOcean, float rFixedStep)
+{
+	rpWorld->p_Ocean = rpOcean;
+	rpWorld->Bodies.clear();
+	rpWorld->LocalPoints.clear();
+	rpWorld->Gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+	rpWorld->WaterDensity = BUOYANCY_WATER_DENSITY;
+	rpWorld->FixedStep = rFixedStep;
+	rpWorld->Accumulator = 0.0f;
+}
+
+static void _resize_point_arrays(BuoyancyWorld* rpWorld)
+{
+	size_t count = rpWorld->LocalPoints.size();
+	rpWorld->PointX.resize(count);
+	rpWorld->PointY.resize(count);
+	rpWorld->PointZ.resize(count);
+	rpWorld->WaterY.resize(count);
+	rpWorld->WaterSources.resize(count, glm::vec2(NAN));
+}
+
+BuoyantBodyId buoyancy_add_body(BuoyancyWorld* rpWorld, EntityRegistry* rpRegistry, EntityHandle rHandle, const Model* rpModel, float rDensity)
+{
+	if (rpModel->p_BuoyancyPoints == nullptr || rpModel->BuoyancyPointCount == 0 || !entity_registry_is_valid(rpRegistry, rHandle))
+	{
+		return UINT32_MAX;
+	}
+
+	const Entity entity = entity_registry_get(rpRegistry, rHandle);
+	const glm::vec3 scale = entity.Scale;
+	const unsigned int count = rpModel->BuoyancyPointCount;
+
+	BuoyantBody body{};
+	body.p_Registry = rpRegistry;
+	body.Entity = rHandle;
+	body.FirstPoint = (unsigned int)rpWorld->LocalPoints.size();
+	body.PointCount = count;
+	body.PointVolume = rpModel->BuoyancyPointVolume * fabsf(scale.x * scale.y * scale.z);
+	body.PointSize = cbrtf(body.PointVolume);
+	body.Mass = rDensity * body.PointVolume * count;
+	body.LinearDrag = BUOYANCY_DEFAULT_LINEAR_DRAG;
+	body.AngularDrag = BUOYANCY_DEFAULT_ANGULAR_DRAG;
+
+	glm::vec3 center(0.0f);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		center += rpModel->p_BuoyancyPoints[i] * scale;
+	}
+	center /= (float)count;
+	body.LocalCenter = center;
+
+	// Inertia of the points as small cubes
+	const float pointMass = body.Mass / count;
+	const float selfInertia = pointMass * body.PointSize * body.PointSize / 6.0f;
+	glm::vec3 inertia(0.0f);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		glm::vec3 p = rpModel->p_BuoyancyPoints[i] * scale - center;
+		rpWorld->LocalPoints.push_back(p);
+		inertia += pointMass * glm::vec3(p.y * p.y + p.z * p.z, p.x * p.x + p.z * p.z, p.x * p.x + p.y * p.y) + selfInertia;
+	}
+	body.InverseInertia = 1.0f / inertia;
+
+	// Same rotation order used when rendering the entity: X, then Y, then Z
+	glm::vec3 euler = glm::radians(entity.Rotation);
+	body.Orientation = glm::quat_cast(glm::eulerAngleXYZ(euler.x, euler.y, euler.z));
+	body.Position = entity.Position + glm::mat3_cast(body.Orientation) * center;
+	body.LinearVelocity = glm::vec3(0.0f);
+	body.AngularVelocity = glm::vec3(0.0f);
+
+	rpWorld->Bodies.push_back(body);
+	_resize_point_arrays(rpWorld);
+
+	return (BuoyantBodyId)(rpWorld->Bodies.size() - 1);
+}
+
+static void _gather_points(BuoyancyWorld* rpWorld)
+{
+	job_parallel_for((unsigned int)rpWorld->Bodies.size(), BUOYANCY_BODY_GRAIN, [rpWorld](unsigned int rBegin, unsigned int rEnd)
+	{
+		for (unsigned int b = rBegin; b < rEnd; b++)
+		{
+			const BuoyantBody& body = rpWorld->Bodies[b];
+			glm::mat3 rotation = glm::mat3_cast(body.Orientation);
+			for (unsigned int i = body.FirstPoint; i < body.FirstPoint + body.PointCount; i++)
+			{
+				glm::vec3 p = body.Position + rotation * rpWorld->LocalPoints[i];
+				rpWorld->PointX[i] = p.x;
+				rpWorld->PointY[i] = p.y;
+				rpWorld->PointZ[i] = p.z;
+			}
+		}
+	});
+}
+
+static void _query_water(BuoyancyWorld* rpWorld)
+{
+	const unsigned int count = (unsigned int)rpWorld->LocalPoints.size();
+	job_parallel_for(count, BUOYANCY_QUERY_GRAIN, [rpWorld](unsigned int rBegin, unsigned int rEnd)
+	{
+		// The point index is the query id
+		ocean_query_heights(rpWorld->p_Ocean, &rpWorld->PointX[rBegin], &rpWorld->PointZ[rBegin], &rpWorld->WaterY[rBegin],
+			nullptr, rEnd - rBegin, &rpWorld->WaterSources[rBegin]);
+	});
+}
+
+static void _apply_forces_and_integrate(BuoyancyWorld* rpWorld, float rStep)
+{
+	job_parallel_for((unsigned int)rpWorld->Bodies.size(), BUOYANCY_BODY_GRAIN, [rpWorld, rStep](unsigned int rBegin, unsigned int rEnd)
+	{
+		const glm::vec3 gravity = rpWorld->Gravity;
+		const float density = rpWorld->WaterDensity;
+
+		for (unsigned int b = rBegin; b < rEnd; b++)
+		{
+			BuoyantBody& body = rpWorld->Bodies[b];
+
+			glm::vec3 force = body.Mass * gravity;
+			glm::vec3 torque(0.0f);
+			float submerged = 0.0f;
+
+			for (unsigned int i = body.FirstPoint; i < body.FirstPoint + body.PointCount; i++)
+			{
+				float depth = rpWorld->WaterY[i] - rpWorld->PointY[i];
+				float fraction = glm::clamp(depth / body.PointSize + 0.5f, 0.0f, 1.0f);
+				if (fraction <= 0.0f)
+				{
+					continue;
+				}
+
+				glm::vec3 r = glm::vec3(rpWorld->PointX[i], rpWorld->PointY[i], rpWorld->PointZ[i]) - body.Position;
+				glm::vec3 pointVelocity = body.LinearVelocity + glm::cross(body.AngularVelocity, r);
+				float displacedMass = density * body.PointVolume * fraction;
+
+				// Archimedes + linear drag against still water
+				glm::vec3 f = -gravity * displacedMass - body.LinearDrag * displacedMass * pointVelocity;
+
+				force += f;
+				torque += glm::cross(r, f);
+				submerged += fraction;
+			}
+
+			body.Force = force;
+			body.Torque = torque;
+
+			// Semi-implicit Euler
+			body.LinearVelocity += force / body.Mass * rStep;
+			body.Position += body.LinearVelocity * rStep;
+
+			glm::mat3 rotation = glm::mat3_cast(body.Orientation);
+			glm::vec3 localTorque = glm::transpose(rotation) * torque;
+			body.AngularVelocity += rotation * (body.InverseInertia * localTorque) * rStep;
+			body.AngularVelocity /= 1.0f + body.AngularDrag * rStep * (submerged / body.PointCount);
+
+			glm::quat spin(0.0f, body.AngularVelocity.x, body.AngularVelocity.y, body.AngularVelocity.z);
+			body.Orientation = glm::normalize(body.Orientation + (0.5f * rStep) * (spin * body.Orientation));
+		}
+	});
+}
+
+static void _write_entities(BuoyancyWorld* rpWorld)
+{
+	for (BuoyantBody& body : rpWorld->Bodies)
+	{
+		// The entity may have been destroyed while the body still floats
+		if (!entity_registry_is_valid(body.p_Registry, body.Entity))
+		{
+			continue;
+		}
+
+		glm::mat4 rotation = glm::mat4_cast(body.Orientation);
+		float x, y, z;
+		glm::extractEulerAngleXYZ(rotation, x, y, z);
+
+		entity_registry_set_position(body.p_Registry, body.Entity, body.Position - glm::mat3(rotation) * body.LocalCenter);
+		entity_registry_set_rotation(body.p_Registry, body.Entity, glm::degrees(glm::vec3(x, y, z)));
+	}
+}
+
+void buoyancy_step(BuoyancyWorld* rpWorld, float rStep)
+{
+	if (rpWorld->Bodies.empty())
+	{
+		return;
+	}
+
+	_gather_points(rpWorld);
+	_query_water(rpWorld);
+	_apply_forces_and_integrate(rpWorld, rStep);
+}
+
+void buoyancy_update(BuoyancyWorld* rpWorld, float rDeltaTime)
+{
+	rpWorld->Accumulator += rDeltaTime;
+
+	int steps = 0;
+	while (rpWorld->Accumulator >= rpWorld->FixedStep && steps < BUOYANCY_MAX_STEPS_PER_UPDATE)
+	{
+		buoyancy_step(rpWorld, rpWorld->FixedStep);
+		rpWorld->Accumulator -= rpWorld->FixedStep;
+		steps++;
+	}
+
+	// Too far behind, do not try to catch up
+	if (steps == BUOYANCY_MAX_STEPS_PER_UPDATE)
+	{
+		rpWorld->Accumulator = std::min(rpWorld->Accumulator, rpWorld->FixedStep);
+	}
+
+	if (steps > 0)
+	{
+		_write_entities(rpWorld);
+	}
+}
+
+// ------------------------------------
+// Voxelization
+// ------------------------------------
+
+void buoyancy_voxelize_mesh(const glm::vec3* rpPositions, unsigned int rVertexCount, const unsigned int* rpIndices, unsigned int rIndexCount,
+	unsigned int rResolution, glm::vec3** rpOutPoints, unsigned int* rpOutCount, float* rpOutPointVolume)
+{
+	*rpOutPoints = nullptr;
+	*rpOutCount = 0;
+	*rpOutPointVolume = 0.0f;
+	if (rVertexCount == 0 || rResolution == 0)
+	{
+		return;
+	}
+
+	glm::vec3 boundsMin = rpPositions[0];
+	glm::vec3 boundsMax = rpPositions[0];
+	for (unsigned int i = 1; i < rVertexCount; i++)
+	{
+		boundsMin = glm::min(boundsMin, rpPositions[i]);
+		boundsMax = glm::max(boundsMax, rpPositions[i]);
+	}
+
+	glm::vec3 extent = boundsMax - boundsMin;
+	float voxelSize = std::max(extent.x, std::max(extent.y, extent.z)) / rResolution;
+	if (voxelSize <= 0.0f)
+	{
+		return;
+	}
+
+	glm::ivec3 dims = glm::max(glm::ivec3(glm::ceil(extent / voxelSize)), glm::ivec3(1));
+	glm::vec3 gridOrigin = (boundsMin + boundsMax) * 0.5f - glm::vec3(dims) * voxelSize * 0.5f;
+
+	std::vector<glm::vec3> inside;
+	std::vector<float> hits;
+
+	// One ray along +X per (y, z) column. Voxels with an odd number of crossings before their center are inside.
+	// Slightly offset from the voxel center so rays do not go exactly through shared edges
+	const float jitter = voxelSize * 1.37e-3f;
+	for (int iz = 0; iz < dims.z; iz++)
+	{
+		for (int iy = 0; iy < dims.y; iy++)
+		{
+			float py = gridOrigin.y + (iy + 0.5f) * voxelSize + jitter;
+			float pz = gridOrigin.z + (iz + 0.5f) * voxelSize + jitter * 0.71f;
+
+			hits.clear();
+			for (unsigned int t = 0; t + 2 < rIndexCount; t += 3)
+			{
+				const glm::vec3& a = rpPositions[rpIndices[t]];
+				const glm::vec3& b = rpPositions[rpIndices[t + 1]];
+				const glm::vec3& c = rpPositions[rpIndices[t + 2]];
+
+				// Barycentrics of (py, pz) in the YZ projection of the triangle
+				float d = (b.y - a.y) * (c.z - a.z) - (c.y - a.y) * (b.z - a.z);
+				if (fabsf(d) < 1e-12f)
+				{
+					continue;
+				}
+				float u = ((b.y - py) * (c.z - pz) - (c.y - py) * (b.z - pz)) / d;
+				float v = ((c.y - py) * (a.z - pz) - (a.y - py) * (c.z - pz)) / d;
+				float w = 1.0f - u - v;
+				if (u < 0.0f || v < 0.0f || w < 0.0f)
+				{
+					continue;
+				}
+				hits.push_back(u * a.x + v * b.x + w * c.x);
+			}
+			std::sort(hits.begin(), hits.end());
+
+			size_t crossed = 0;
+			for (int ix = 0; ix < dims.x; ix++)
+			{
+				float px = gridOrigin.x + (ix + 0.5f) * voxelSize;
+				while (crossed < hits.size() && hits[crossed] < px)
+				{
+					crossed++;
+				}
+				if (crossed & 1)
+				{
+					inside.push_back(glm::vec3(px, py, pz));
+				}
+			}
+		}
+	}
+
+	// Open mesh: use the whole bounding box
+	if (inside.empty())
+	{
+		for (int iz = 0; iz < dims.z; iz++)
+			for (int iy = 0; iy < dims.y; iy++)
+				for (int ix = 0; ix < dims.x; ix++)
+					inside.push_back(gridOrigin + (glm::vec3(ix, iy, iz) + 0.5f) * voxelSize);
+	}
+
+	*rpOutPoints = (glm::vec3*)CE_MALLOC(sizeof(glm::vec3) * inside.size());
+	std::copy(inside.begin(), inside.end(), *rpOutPoints);
+	*rpOutCount = (unsigned int)inside.size();
+	*rpOutPointVolume = voxelSize * voxelSize * voxelSize;
+}
@@ -0,0 +1,101 @@
+#ifndef BUOYANCY_H
+#define BUOYANCY_H
+
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "../scene/entity_registry.h"
+#include "../renderer/data/model.h"
+#include "../ocean/ocean.h"
+
+// Rigid bodies floating on the ocean. Every body is approximated by the voxel sample points of
+// its model. On each fixed step the points of all bodies are gathered in SoA arrays, the water
+// is queried once for the whole batch and the per-point forces are reduced per body.
+
+// Voxels along the longest axis of a model when it is voxelized at import
+#define BUOYANCY_VOXEL_RESOLUTION 6
+
+#define BUOYANCY_WATER_DENSITY 1025.0f
+#define BUOYANCY_DEFAULT_FIXED_STEP (1.0f / 60.0f)
+
+// Steps run per update at most, the rest of the accumulated time is dropped
+#define BUOYANCY_MAX_STEPS_PER_UPDATE 4
+
+typedef unsigned int BuoyantBodyId;
+
+typedef struct
+{
+	// Driven entity. Position and Rotation (euler degrees) are written after every update
+	EntityRegistry* p_Registry;
+	EntityHandle Entity;
+
+	glm::vec3 Position;			// Center of mass
+	glm::quat Orientation;
+	glm::vec3 LinearVelocity;
+	glm::vec3 AngularVelocity;
+
+	float Mass;
+	glm::vec3 InverseInertia;	// Body space, diagonal
+	glm::vec3 LocalCenter;		// Center of mass in model space (scaled)
+
+	// Sample points in body space relative to the center of mass (scaled)
+	unsigned int FirstPoint;
+	unsigned int PointCount;
+	float PointVolume;
+	float PointSize;			// Voxel edge, used for the partial submersion of a point
+
+	float LinearDrag;
+	float AngularDrag;
+
+	glm::vec3 Force;
+	glm::vec3 Torque;
+} BuoyantBody;
+
+typedef struct
+{
+	const Ocean* p_Ocean;
+
+	std::vector<BuoyantBody> Bodies;
+
+	// Body space points of every body, indexed by BuoyantBody::FirstPoint
+	std::vector<glm::vec3> LocalPoints;
+
+	// Gathered world space points and the water answer for each of them (SoA)
+	std::vector<float> PointX;
+	std::vector<float> PointY;
+	std::vector<float> PointZ;
+	std::vector<float> WaterY;
+
+	// Rest position found for each point on the previous step, warm starts the height query
+	std::vector<glm::vec2> WaterSources;
+
+	glm::vec3 Gravity;
+	float WaterDensity;
+	float FixedStep;
+	float Accumulator;
+} BuoyancyWorld;
+
+void buoyancy_init(BuoyancyWorld* rpWorld, const Ocean* rpOcean, float rFixedStep = BUOYANCY_DEFAULT_FIXED_STEP);
+
+/// <summary>
+/// Adds a body that drives the entity rHandle of rpRegistry. The sample points are taken from the model of the entity
+/// </summary>
+/// <param name="rDensity">Density of the body in kg/m^3. Below BUOYANCY_WATER_DENSITY it floats</param>
+/// <returns>Id of the body, or UINT32_MAX if the model has no sample points</returns>
+BuoyantBodyId buoyancy_add_body(BuoyancyWorld* rpWorld, EntityRegistry* rpRegistry, EntityHandle rHandle, const Model* rpModel, float rDensity);
+
+/// <summary>
+/// Runs as many fixed steps as fit in the accumulated time and updates the entities
+/// </summary>
+void buoyancy_update(BuoyancyWorld* rpWorld, float rDeltaTime);
+
+void buoyancy_step(BuoyancyWorld* rpWorld, float rStep);
+
+/// <summary>
+/// Builds the sample points of a closed triangle mesh: centers of the voxels inside the mesh
+/// on a grid of rResolution voxels along the longest axis. Points are allocated with CE_MALLOC
+/// </summary>
+void buoyancy_voxelize_mesh(const glm::vec3* rpPositions, unsigned int rVertexCount, const unsigned int* rpIndices, unsigned int rIndexCount,
+	unsigned int rResolution, glm::vec3** rpOutPoints, unsigned int* rpOutCount, float* rpOutPointVolume);
+
+#endif // !BUOYANCY_H
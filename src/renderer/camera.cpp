@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <glm/geometric.hpp>
 #include <glm/trigonometric.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
 #include "../core/time_manager.h"
 #include <iostream>
 
@@ -91,3 +93,17 @@ void camera_add_render_target(CameraInfo* rpCamera, FrameBuffer& fb)
 	rpCamera->FrameBuffer = &fb;
 	rpCamera->RenderTarget = RenderTargetType::Texture;
 }
+
+glm::mat4x4 camera_get_view_matrix(const CameraInfo* rpCamera)
+{
+	glm::mat4x4 view = glm::mat4(1.0f);
+	view = glm::rotate(view, glm::radians(rpCamera->Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+	view = glm::rotate(view, glm::radians(rpCamera->Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+	view = glm::rotate(view, glm::radians(rpCamera->Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+	return glm::translate(view, -rpCamera->Position);
+}
+
+glm::mat4x4 camera_get_projection_matrix(const CameraInfo* rpCamera, float rAspect)
+{
+	return glm::perspective(glm::radians(rpCamera->Fov), rAspect, rpCamera->NearPlane, rpCamera->FarPlane);
+}
@@ -61,6 +61,13 @@ void camera_update(CameraInfo* rpCamera);
 
 void camera_add_render_target(CameraInfo* rpCamera, FrameBuffer& fb);
 
+glm::mat4x4 camera_get_view_matrix(const CameraInfo* rpCamera);
+
+/// <summary>
+/// Perspective projection of the camera for a viewport of rAspect (width / height)
+/// </summary>
+glm::mat4x4 camera_get_projection_matrix(const CameraInfo* rpCamera, float rAspect);
+
 #endif // !CAMERA_H
 
 
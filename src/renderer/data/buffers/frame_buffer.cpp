@@ -69,6 +69,7 @@ void _fb_attach_rb(FrameBuffer* fb, RenderBuffer* rb)
 
 void release_fb(FrameBuffer& r_fb)
 {
+	gl_state_forget_framebuffer(r_fb.Id);
 	glDeleteFramebuffers(1, &r_fb.Id);
 
 	// Release attached color buffer 
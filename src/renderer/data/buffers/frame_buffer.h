@@ -3,6 +3,7 @@
 
 
 #include <glad/glad.h>
+#include "../../gl_state_cache.h"
 #include "../texture.h"
 #include "render_buffer.h"
 
@@ -40,12 +41,12 @@ void _fb_attach_rb(FrameBuffer* fb, RenderBuffer* rb);
 
 inline void use_fb(const FrameBuffer& r_fb)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, r_fb.Id);
+    gl_state_bind_framebuffer(r_fb.Id);
 }
 
 inline void fb_unbind()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl_state_bind_framebuffer(0);
 }
 
 /// <summary>
@@ -0,0 +1,219 @@
+#include "geometry_heap.h"
+
+#include <iostream>
+#include <cstdint>
+#include <algorithm>
+
+// Pages are referenced by the allocations, they are never moved nor deleted
+static std::vector<GeometryHeapPage*> s_Pages;
+
+static bool _same_format(const GeometryHeapPage& rPage, const VertexBufferLayout& rLayout)
+{
+    if (rPage.Stride != rLayout.Stride || rPage.Attributes.size() != rLayout.VertexAttributeCount)
+    {
+        return false;
+    }
+    for (unsigned int i = 0; i < rLayout.VertexAttributeCount; i++)
+    {
+        const VertexAttribute& a = rPage.Attributes[i];
+        const VertexAttribute& b = rLayout.VertexAttributes[i];
+        if (a.Type != b.Type || a.Count != b.Count || a.Normalized != b.Normalized)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Offset of the first free range of rSize, UINT32_MAX if none fits
+static unsigned int _find_range(const std::vector<GeometryRange>& rFree, unsigned int rSize)
+{
+    for (const GeometryRange& range : rFree)
+    {
+        if (range.Size >= rSize)
+        {
+            return range.Offset;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static void _take_range(std::vector<GeometryRange>& rFree, unsigned int rOffset, unsigned int rSize)
+{
+    for (size_t i = 0; i < rFree.size(); i++)
+    {
+        if (rFree[i].Offset == rOffset)
+        {
+            rFree[i].Offset += rSize;
+            rFree[i].Size -= rSize;
+            if (rFree[i].Size == 0)
+            {
+                rFree.erase(rFree.begin() + i);
+            }
+            return;
+        }
+    }
+}
+
+static void _return_range(std::vector<GeometryRange>& rFree, unsigned int rOffset, unsigned int rSize)
+{
+    if (rSize == 0)
+    {
+        return;
+    }
+
+    auto next = std::lower_bound(rFree.begin(), rFree.end(), rOffset, [](const GeometryRange& range, unsigned int offset)
+        {
+            return range.Offset < offset;
+        });
+    next = rFree.insert(next, GeometryRange{ rOffset, rSize });
+
+    // Merge with the following range, then with the previous one
+    if (next + 1 != rFree.end() && next->Offset + next->Size == (next + 1)->Offset)
+    {
+        next->Size += (next + 1)->Size;
+        rFree.erase(next + 1);
+    }
+    if (next != rFree.begin() && (next - 1)->Offset + (next - 1)->Size == next->Offset)
+    {
+        (next - 1)->Size += next->Size;
+        rFree.erase(next);
+    }
+}
+
+static unsigned int _create_storage(GLenum rTarget, GLsizeiptr rSize)
+{
+    unsigned int id;
+    glGenBuffers(1, &id);
+    glBindBuffer(rTarget, id);
+    if (GLAD_GL_VERSION_4_4)
+    {
+        glBufferStorage(rTarget, rSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    }
+    else
+    {
+        glBufferData(rTarget, rSize, nullptr, GL_STATIC_DRAW);
+    }
+    return id;
+}
+
+static GeometryHeapPage* _create_page(const VertexBufferLayout& rLayout, unsigned int rVertexCapacity, unsigned int rIndexByteCapacity)
+{
+    GeometryHeapPage* pPage = new GeometryHeapPage();
+    pPage->Attributes.assign(rLayout.VertexAttributes, rLayout.VertexAttributes + rLayout.VertexAttributeCount);
+    pPage->Stride = rLayout.Stride;
+    pPage->VertexCapacity = rVertexCapacity;
+    pPage->IndexByteCapacity = rIndexByteCapacity;
+    pPage->FreeVertices.push_back(GeometryRange{ 0, rVertexCapacity });
+    pPage->FreeIndexBytes.push_back(GeometryRange{ 0, rIndexByteCapacity });
+
+    pPage->Vao = create_vao();
+    pPage->Vbo = VertexBuffer{ _create_storage(GL_ARRAY_BUFFER, (GLsizeiptr)rVertexCapacity * rLayout.Stride) };
+    pPage->Ibo = IndexBuffer{ _create_storage(GL_ELEMENT_ARRAY_BUFFER, rIndexByteCapacity) };
+
+    VertexBufferLayout layout = rLayout;
+    layout.VertexAttributes = pPage->Attributes.data();
+    vao_add_vbo(pPage->Vao, pPage->Vbo, layout);
+    vao_add_ibo(pPage->Vao, pPage->Ibo);
+    vao_add_instance_index(pPage->Vao);
+
+    s_Pages.push_back(pPage);
+    return pPage;
+}
+
+bool geometry_heap_allocate(const VertexBufferLayout& rLayout, unsigned int rVertexCount, unsigned int rIndexBytes, GeometryAllocation* rpAllocation)
+{
+    *rpAllocation = {};
+    unsigned int indexBytes = (rIndexBytes + 3) & ~3u;
+
+    GeometryHeapPage* pPage = nullptr;
+    unsigned int firstVertex = UINT32_MAX;
+    unsigned int indexOffset = UINT32_MAX;
+    for (GeometryHeapPage* pCandidate : s_Pages)
+    {
+        if (!_same_format(*pCandidate, rLayout))
+        {
+            continue;
+        }
+        firstVertex = _find_range(pCandidate->FreeVertices, rVertexCount);
+        indexOffset = _find_range(pCandidate->FreeIndexBytes, indexBytes);
+        if (firstVertex != UINT32_MAX && indexOffset != UINT32_MAX)
+        {
+            pPage = pCandidate;
+            break;
+        }
+    }
+
+    if (pPage == nullptr)
+    {
+        if (rLayout.Stride == 0)
+        {
+            std::cout << "GEOMETRY_HEAP::ALLOCATE - Meshes without vertex attributes can not be placed in the heap" << std::endl;
+            return false;
+        }
+        pPage = _create_page(rLayout, std::max(rVertexCount, (unsigned int)GEOMETRY_HEAP_PAGE_VERTICES),
+            std::max(indexBytes, (unsigned int)GEOMETRY_HEAP_PAGE_INDEX_BYTES));
+        firstVertex = 0;
+        indexOffset = 0;
+    }
+
+    _take_range(pPage->FreeVertices, firstVertex, rVertexCount);
+    _take_range(pPage->FreeIndexBytes, indexOffset, indexBytes);
+
+    rpAllocation->pPage = pPage;
+    rpAllocation->FirstVertex = firstVertex;
+    rpAllocation->VertexCount = rVertexCount;
+    rpAllocation->IndexByteOffset = indexOffset;
+    rpAllocation->IndexBytes = rIndexBytes;
+    return true;
+}
+
+void geometry_heap_upload(const GeometryAllocation& rAllocation, const void* rpVertices, const void* rpIndices)
+{
+    const GeometryHeapPage* pPage = rAllocation.pPage;
+    if (rpVertices != nullptr)
+    {
+        vbo_set_data(pPage->Vbo, rpVertices, (GLsizeiptr)rAllocation.VertexCount * pPage->Stride, (GLintptr)rAllocation.FirstVertex * pPage->Stride);
+    }
+    if (rpIndices != nullptr)
+    {
+        // The element array binding belongs to the bound VAO
+        gl_state_bind_vertex_array(pPage->Vao.Id);
+        ibo_set_data(pPage->Ibo, rpIndices, rAllocation.IndexBytes, rAllocation.IndexByteOffset);
+    }
+}
+
+void geometry_heap_free(GeometryAllocation* rpAllocation)
+{
+    GeometryHeapPage* pPage = rpAllocation->pPage;
+    if (pPage == nullptr)
+    {
+        return;
+    }
+    _return_range(pPage->FreeVertices, rpAllocation->FirstVertex, rpAllocation->VertexCount);
+    _return_range(pPage->FreeIndexBytes, rpAllocation->IndexByteOffset, (rpAllocation->IndexBytes + 3) & ~3u);
+    *rpAllocation = {};
+}
+
+GeometryHeapStats geometry_heap_get_stats()
+{
+    GeometryHeapStats stats = {};
+    for (const GeometryHeapPage* pPage : s_Pages)
+    {
+        size_t freeBytes = 0;
+        for (const GeometryRange& range : pPage->FreeVertices)
+        {
+            freeBytes += (size_t)range.Size * pPage->Stride;
+        }
+        for (const GeometryRange& range : pPage->FreeIndexBytes)
+        {
+            freeBytes += range.Size;
+        }
+
+        size_t capacity = (size_t)pPage->VertexCapacity * pPage->Stride + pPage->IndexByteCapacity;
+        stats.PageCount++;
+        stats.CapacityBytes += capacity;
+        stats.UsedBytes += capacity - freeBytes;
+    }
+    return stats;
+}
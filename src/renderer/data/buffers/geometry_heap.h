@@ -0,0 +1,81 @@
+#ifndef GEOMETRY_HEAP_H
+#define GEOMETRY_HEAP_H
+
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include "vertex_array.h"
+#include "vertex_buffer.h"
+#include "index_buffer.h"
+#include "vertex_buffer_layout.h"
+
+// Large fixed size vertex and index buffers shared by the meshes of one vertex format, so they share a VAO and
+// can be drawn together with glMultiDrawElementsIndirect. A mesh is a range of vertices and a range of index bytes
+// of one page, allocated first fit from the free lists of the page. Freed ranges merge with their free neighbours.
+// Pages use immutable storage (glBufferStorage) when GL 4.4 is available. A new page is added when none has room,
+// meshes larger than a page get a page of their own
+
+#define GEOMETRY_HEAP_PAGE_VERTICES (256 * 1024)
+#define GEOMETRY_HEAP_PAGE_INDEX_BYTES (4 * 1024 * 1024)
+
+typedef struct
+{
+    unsigned int Offset;
+    unsigned int Size;
+} GeometryRange;
+
+typedef struct
+{
+    VertexArray Vao;
+    VertexBuffer Vbo;
+    IndexBuffer Ibo;
+
+    // Format of the page, compared attribute by attribute
+    std::vector<VertexAttribute> Attributes;
+    unsigned int Stride;
+
+    unsigned int VertexCapacity;
+    unsigned int IndexByteCapacity;
+
+    // Sorted by offset
+    std::vector<GeometryRange> FreeVertices;
+    std::vector<GeometryRange> FreeIndexBytes;
+} GeometryHeapPage;
+
+typedef struct
+{
+    // nullptr when not allocated
+    GeometryHeapPage* pPage;
+    unsigned int FirstVertex;
+    unsigned int VertexCount;
+    // Ranges start 4 byte aligned, so 16 and 32 bit indices can share a page
+    unsigned int IndexByteOffset;
+    unsigned int IndexBytes;
+} GeometryAllocation;
+
+typedef struct
+{
+    unsigned int PageCount;
+    size_t CapacityBytes;
+    size_t UsedBytes;
+} GeometryHeapStats;
+
+/// <summary>
+/// Allocates rVertexCount vertices of rLayout and rIndexBytes of indices in the same page
+/// </summary>
+/// <returns>False if the page could not be created</returns>
+bool geometry_heap_allocate(const VertexBufferLayout& rLayout, unsigned int rVertexCount, unsigned int rIndexBytes, GeometryAllocation* rpAllocation);
+
+/// <summary>
+/// Writes the vertices and indices of an allocation, both sized as allocated
+/// </summary>
+void geometry_heap_upload(const GeometryAllocation& rAllocation, const void* rpVertices, const void* rpIndices);
+
+/// <summary>
+/// Returns the ranges to their page. The allocation is cleared
+/// </summary>
+void geometry_heap_free(GeometryAllocation* rpAllocation);
+
+GeometryHeapStats geometry_heap_get_stats();
+
+#endif // !GEOMETRY_HEAP_H
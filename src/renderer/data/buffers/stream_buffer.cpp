@@ -0,0 +1,97 @@
+#include "stream_buffer.h"
+
+StreamBuffer create_stream_buffer(const GLenum r_target, const GLsizeiptr r_segment_size)
+{
+    StreamBuffer sb{};
+    sb.Target = r_target;
+    sb.SegmentSize = r_segment_size;
+    sb.CurrentSegment = 0;
+    sb.StallCount = 0;
+
+    const GLsizeiptr totalSize = r_segment_size * STREAM_BUFFER_SEGMENTS;
+
+    glGenBuffers(1, &sb.Id);
+    glBindBuffer(r_target, sb.Id);
+
+    sb.Persistent = GLAD_GL_VERSION_4_4 != 0;
+    if (sb.Persistent)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(r_target, totalSize, nullptr, flags);
+        sb.p_Mapped = (unsigned char*)glMapBufferRange(r_target, 0, totalSize, flags);
+    }
+    else
+    {
+        glBufferData(r_target, totalSize, nullptr, GL_STREAM_DRAW);
+        sb.p_Mapped = nullptr;
+    }
+
+    glBindBuffer(r_target, 0);
+    return sb;
+}
+
+void* stream_buffer_begin(StreamBuffer* rp_sb)
+{
+    GLsync& fence = rp_sb->Fences[rp_sb->CurrentSegment];
+    if (fence != nullptr)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            rp_sb->StallCount++;
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    const GLintptr offset = rp_sb->SegmentSize * rp_sb->CurrentSegment;
+    if (rp_sb->Persistent)
+    {
+        return rp_sb->p_Mapped + offset;
+    }
+
+    // The fence already guarantees the GPU is done with this range
+    glBindBuffer(rp_sb->Target, rp_sb->Id);
+    return glMapBufferRange(rp_sb->Target, offset, rp_sb->SegmentSize,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+GLintptr stream_buffer_end(StreamBuffer* rp_sb)
+{
+    glBindBuffer(rp_sb->Target, rp_sb->Id);
+    if (!rp_sb->Persistent)
+    {
+        glUnmapBuffer(rp_sb->Target);
+    }
+    return rp_sb->SegmentSize * rp_sb->CurrentSegment;
+}
+
+void stream_buffer_fence(StreamBuffer* rp_sb)
+{
+    rp_sb->Fences[rp_sb->CurrentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    rp_sb->CurrentSegment = (rp_sb->CurrentSegment + 1) % STREAM_BUFFER_SEGMENTS;
+}
+
+void release_stream_buffer(StreamBuffer& r_sb)
+{
+    for (unsigned int i = 0; i < STREAM_BUFFER_SEGMENTS; i++)
+    {
+        if (r_sb.Fences[i] != nullptr)
+        {
+            glDeleteSync(r_sb.Fences[i]);
+            r_sb.Fences[i] = nullptr;
+        }
+    }
+
+    if (r_sb.Persistent && r_sb.p_Mapped != nullptr)
+    {
+        glBindBuffer(r_sb.Target, r_sb.Id);
+        glUnmapBuffer(r_sb.Target);
+        glBindBuffer(r_sb.Target, 0);
+    }
+    r_sb.p_Mapped = nullptr;
+
+    glDeleteBuffers(1, &r_sb.Id);
+    r_sb.Id = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+// Buffer split in STREAM_BUFFER_SEGMENTS segments that are written by the CPU in turns.
+// Each segment is protected by a fence, so the CPU only waits if the GPU is still
+// reading the segment written STREAM_BUFFER_SEGMENTS frames ago.
+// Uses a persistently mapped buffer (GL 4.4) when available, otherwise an
+// unsynchronized map of the segment every frame.
+
+#define STREAM_BUFFER_SEGMENTS 3
+
+typedef struct
+{
+	unsigned int Id;
+	GLenum Target;
+	GLsizeiptr SegmentSize;
+	unsigned int CurrentSegment;
+
+	bool Persistent;
+	unsigned char* p_Mapped;
+	GLsync Fences[STREAM_BUFFER_SEGMENTS];
+
+	// Number of times the CPU had to wait for the GPU
+	unsigned int StallCount;
+} StreamBuffer;
+
+/// <summary>
+/// Create stream buffer
+/// </summary>
+/// <param name="r_target">Target the buffer is bound to when used (GL_PIXEL_UNPACK_BUFFER, GL_UNIFORM_BUFFER...)</param>
+/// <param name="r_segment_size">Size in bytes of each segment</param>
+/// <returns>Stream buffer</returns>
+StreamBuffer create_stream_buffer(const GLenum r_target, const GLsizeiptr r_segment_size);
+
+/// <summary>
+/// Waits until the current segment is free and returns a pointer to write into it
+/// </summary>
+void* stream_buffer_begin(StreamBuffer* rp_sb);
+
+/// <summary>
+/// Finishes writing the current segment and binds the buffer to its target
+/// </summary>
+/// <returns>Offset in bytes of the segment inside the buffer</returns>
+GLintptr stream_buffer_end(StreamBuffer* rp_sb);
+
+/// <summary>
+/// Must be called after the last GL command reading the segment. Places its fence and moves to the next one
+/// </summary>
+void stream_buffer_fence(StreamBuffer* rp_sb);
+
+/// <summary>
+/// Deletes buffer
+/// </summary>
+/// <param name="r_sb">Buffer to delete. Its Id will be set to 0</param>
+void release_stream_buffer(StreamBuffer& r_sb);
+
+#endif // !STREAM_BUFFER_H
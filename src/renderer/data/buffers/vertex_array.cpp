@@ -3,20 +3,21 @@
 #include <glad/glad.h>
 #include "vertex_buffer_layout.h"
 #include <iostream>
+#include <vector>
 
 VertexArray create_vao()
 {
     unsigned int vao;
 
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    gl_state_bind_vertex_array(vao);
 
     return VertexArray{ vao };
 }
 
 void vao_add_vbo(const VertexArray& r_vao, const VertexBuffer& r_vbo, const VertexBufferLayout& r_vertexLayout)
 {
-    glBindVertexArray(r_vao.Id);
+    gl_state_bind_vertex_array(r_vao.Id);
     glBindBuffer(GL_ARRAY_BUFFER, r_vbo.Id);
 
     int offset_bytes = 0;
@@ -26,7 +27,7 @@ void vao_add_vbo(const VertexArray& r_vao, const VertexBuffer& r_vbo, const Vert
         glVertexAttribPointer(i,
             r_vertexLayout.VertexAttributes[i].Count,
             get_gl_type(r_vertexLayout.VertexAttributes[i].Type),
-            GL_FALSE, 
+            r_vertexLayout.VertexAttributes[i].Normalized ? GL_TRUE : GL_FALSE,
             r_vertexLayout.Stride,
             (void*)offset_bytes
         );
@@ -37,12 +38,54 @@ void vao_add_vbo(const VertexArray& r_vao, const VertexBuffer& r_vbo, const Vert
 
 void vao_add_ibo(const VertexArray& r_vao, const IndexBuffer& r_ibo)
 {
-    glBindVertexArray(r_vao.Id);
+    gl_state_bind_vertex_array(r_vao.Id);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r_ibo.Id);
 }
 
+static unsigned int s_InstanceIndexBuffer = 0;
+static unsigned int s_InstanceIndexCount = 0;
+
+void vao_reserve_instance_indices(unsigned int r_count)
+{
+    if (s_InstanceIndexBuffer != 0 && r_count <= s_InstanceIndexCount)
+    {
+        return;
+    }
+
+    unsigned int count = s_InstanceIndexCount == 0 ? VAO_INITIAL_INSTANCE_INDICES : s_InstanceIndexCount;
+    while (count < r_count)
+    {
+        count *= 2;
+    }
+
+    std::vector<unsigned int> indices(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        indices[i] = i;
+    }
+    if (s_InstanceIndexBuffer == 0)
+    {
+        glGenBuffers(1, &s_InstanceIndexBuffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, s_InstanceIndexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    s_InstanceIndexCount = count;
+}
+
+void vao_add_instance_index(const VertexArray& r_vao)
+{
+    vao_reserve_instance_indices(VAO_INITIAL_INSTANCE_INDICES);
+
+    gl_state_bind_vertex_array(r_vao.Id);
+    glBindBuffer(GL_ARRAY_BUFFER, s_InstanceIndexBuffer);
+    glVertexAttribIPointer(VAO_INSTANCE_INDEX_LOCATION, 1, GL_UNSIGNED_INT, 0, nullptr);
+    glVertexAttribDivisor(VAO_INSTANCE_INDEX_LOCATION, 1);
+    glEnableVertexAttribArray(VAO_INSTANCE_INDEX_LOCATION);
+}
+
 void release_vao(VertexArray& r_vao)
 {
-    glDeleteBuffers(1, &r_vao.Id);
+    gl_state_forget_vertex_array(r_vao.Id);
+    glDeleteVertexArrays(1, &r_vao.Id);
     r_vao.Id = 0;
 }
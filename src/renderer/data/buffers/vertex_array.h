@@ -2,10 +2,16 @@
 #define VERTEX_ARRAY_H
 
 #include <glad/glad.h>
+#include "../../gl_state_cache.h"
 #include "vertex_buffer.h"
 #include "index_buffer.h"
 #include "vertex_buffer_layout.h"
 
+// Per instance attribute holding the index of the instance among every instance of the frame: baseInstance + gl_InstanceID.
+// GL 4.3 shaders can not read the base instance of an indirect draw otherwise. Must match transforms.glsl
+#define VAO_INSTANCE_INDEX_LOCATION 7
+#define VAO_INITIAL_INSTANCE_INDICES 65536
+
 typedef struct
 {
 	unsigned int Id;
@@ -23,15 +29,26 @@ VertexArray create_vao();
 void vao_add_vbo(const VertexArray& r_vao, const VertexBuffer& r_vbo, const VertexBufferLayout& r_vertexLayout);
 void vao_add_ibo(const VertexArray& r_vao, const IndexBuffer& r_ibo);
 
+/// <summary>
+/// Feeds VAO_INSTANCE_INDEX_LOCATION from a shared buffer holding 0, 1, 2... one value per instance
+/// </summary>
+void vao_add_instance_index(const VertexArray& r_vao);
+
+/// <summary>
+/// Grows the shared instance index buffer to at least r_count values. The buffer keeps its name,
+/// so the vertex arrays already using it see the new values
+/// </summary>
+void vao_reserve_instance_indices(unsigned int r_count);
+
 
 inline void vao_bind(const VertexArray& r_vao)
 {
-    glBindVertexArray(r_vao.Id);
+    gl_state_bind_vertex_array(r_vao.Id);
 }
 
 inline void vao_unbind(const VertexArray& r_vao)
 {
-    glBindVertexArray(0);
+    gl_state_bind_vertex_array(0);
 }
 
 
@@ -6,6 +6,9 @@ unsigned int get_size_of_type(VertexAttributeType r_type)
 	{
 		case VertexAttributeType::FLOAT: return sizeof(float);
 		case VertexAttributeType::UINT: return sizeof(unsigned int);
+		case VertexAttributeType::USHORT: return sizeof(unsigned short);
+		case VertexAttributeType::SHORT: return sizeof(short);
+		case VertexAttributeType::HALF_FLOAT: return sizeof(unsigned short);
 		case VertexAttributeType::INT: return sizeof(int);
 		case VertexAttributeType::BOOL: return sizeof(bool);
 		case VertexAttributeType::DOUBLE: return sizeof(double);
@@ -18,6 +21,9 @@ GLenum get_gl_type(VertexAttributeType r_type)
 	{
 		case VertexAttributeType::FLOAT: return GL_FLOAT;
 		case VertexAttributeType::UINT: return GL_UNSIGNED_INT;
+		case VertexAttributeType::USHORT: return GL_UNSIGNED_SHORT;
+		case VertexAttributeType::SHORT: return GL_SHORT;
+		case VertexAttributeType::HALF_FLOAT: return GL_HALF_FLOAT;
 		case VertexAttributeType::INT: return GL_INT;
 		case VertexAttributeType::BOOL: return GL_BOOL;
 		case VertexAttributeType::DOUBLE: return GL_DOUBLE;
@@ -7,6 +7,9 @@ enum class VertexAttributeType
 	FLOAT,
 	INT,
 	UINT,
+	USHORT,
+	SHORT,
+	HALF_FLOAT,
 	BOOL,
 	DOUBLE
 };
@@ -16,6 +19,9 @@ typedef struct
 {
 	VertexAttributeType Type;
 	unsigned int Count;
+
+	// Integer types are read as [0, 1] (unsigned) or [-1, 1] (signed) floats instead of their value
+	bool Normalized;
 } VertexAttribute;
 
 typedef struct {
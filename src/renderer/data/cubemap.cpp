@@ -4,7 +4,7 @@ void load_cubemap(Cubemap *cubemap, std::vector<std::string> faces)
 {
     unsigned int textureId;
     glGenTextures(1, &textureId);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureId);
+    gl_state_bind_texture(0, GL_TEXTURE_CUBE_MAP, textureId);
 
     int width, height, nrChannels;
     for (unsigned int i = 0; i < faces.size(); i++)
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <stb_image.h>
 #include <glad/glad.h>
+#include "../gl_state_cache.h"
 
 typedef struct
 {
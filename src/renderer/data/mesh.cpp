@@ -1,20 +1,77 @@
 #include "mesh.h"
 #include <iostream>
+#include "mesh_optimizer.h"
 #include "../../core/memory_utils.h"
 
 void create_mesh(Mesh* rpMesh, VertexAttribute* rVertexAttributes, int rVertexAttrCount, float* rVertices, int rVertexCount, 
 	unsigned int* rIndices, int rIndexCount, int r_subMeshCount, GLenum rUsage)
+{
+	// A single triangle list with its data is reordered here. Submeshes are set up by the caller after, so
+	// meshes with several of them must be optimized per submesh before (see _assimp_mesh_importer.cpp)
+	bool hasPositions = rVertexAttrCount > 0 && rVertexAttributes[0].Type == VertexAttributeType::FLOAT && rVertexAttributes[0].Count >= 3;
+	if (rVertices && rIndices && r_subMeshCount == 1 && hasPositions)
+	{
+		unsigned int stride = create_vertex_buffer_layout(rVertexAttributes, rVertexAttrCount).Stride;
+		const char* pName = rIndexCount / 3 >= MESH_OPTIMIZER_REPORT_TRIANGLES ? "create_mesh" : nullptr;
+		rVertexCount = (int)mesh_optimize(rVertices, rVertexCount, stride, rIndices, rIndexCount, pName);
+	}
+
+	create_mesh_from_data(rpMesh, rVertexAttributes, rVertexAttrCount, rVertices, rVertexCount, rIndices, rIndexCount, GL_UNSIGNED_INT, r_subMeshCount, rUsage);
+}
+
+void create_mesh_from_data(Mesh* rpMesh, VertexAttribute* rVertexAttributes, int rVertexAttrCount, const void* rpVertices, int rVertexCount,
+	const void* rpIndices, int rIndexCount, GLenum rIndexType, int r_subMeshCount, GLenum rUsage)
 {
 	VertexBufferLayout layout = create_vertex_buffer_layout(rVertexAttributes, rVertexAttrCount);
+	unsigned int indexSize = rIndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
 
 	rpMesh->Vao = create_vao();
-	rpMesh->Vbo = create_vbo(layout.Stride * rVertexCount, rVertices, rUsage);
-	rpMesh->Ibo = create_ibo(rIndexCount * sizeof(unsigned int), rIndices, rUsage);
+	rpMesh->Vbo = create_vbo(layout.Stride * rVertexCount, rpVertices, rUsage);
+	rpMesh->Ibo = create_ibo(rIndexCount * indexSize, rpIndices, rUsage);
 
 	vao_add_vbo(rpMesh->Vao, rpMesh->Vbo, layout);
 	vao_add_ibo(rpMesh->Vao, rpMesh->Ibo);
+	vao_add_instance_index(rpMesh->Vao);
+	rpMesh->HeapAllocation = {};
+
+	rpMesh->IndexCount = rIndexCount;
+	rpMesh->IndexType = rIndexType;
+	rpMesh->PrimitiveType = GL_TRIANGLES;
+
+	rpMesh->Quantized = false;
+	rpMesh->PositionOffset = glm::vec3(0.0f);
+	rpMesh->PositionScale = glm::vec3(1.0f);
+
+	rpMesh->SubmeshCount = r_subMeshCount;
+	rpMesh->Submeshes = (Submesh*)CE_MALLOC(sizeof(Submesh) * r_subMeshCount);
+}
+
+void create_mesh_in_heap(Mesh* rpMesh, VertexAttribute* rVertexAttributes, int rVertexAttrCount, const void* rpVertices, int rVertexCount,
+	const void* rpIndices, int rIndexCount, GLenum rIndexType, int r_subMeshCount)
+{
+	VertexBufferLayout layout = create_vertex_buffer_layout(rVertexAttributes, rVertexAttrCount);
+	unsigned int indexSize = rIndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+	GeometryAllocation allocation;
+	if (rpVertices == nullptr || rpIndices == nullptr || !geometry_heap_allocate(layout, rVertexCount, rIndexCount * indexSize, &allocation))
+	{
+		create_mesh_from_data(rpMesh, rVertexAttributes, rVertexAttrCount, rpVertices, rVertexCount, rpIndices, rIndexCount, rIndexType, r_subMeshCount, GL_STATIC_DRAW);
+		return;
+	}
+	geometry_heap_upload(allocation, rpVertices, rpIndices);
+
+	rpMesh->HeapAllocation = allocation;
+	rpMesh->Vao = allocation.pPage->Vao;
+	rpMesh->Vbo = allocation.pPage->Vbo;
+	rpMesh->Ibo = allocation.pPage->Ibo;
 
 	rpMesh->IndexCount = rIndexCount;
+	rpMesh->IndexType = rIndexType;
+	rpMesh->PrimitiveType = GL_TRIANGLES;
+
+	rpMesh->Quantized = false;
+	rpMesh->PositionOffset = glm::vec3(0.0f);
+	rpMesh->PositionScale = glm::vec3(1.0f);
 
 	rpMesh->SubmeshCount = r_subMeshCount;
 	rpMesh->Submeshes = (Submesh*)CE_MALLOC(sizeof(Submesh) * r_subMeshCount);
@@ -22,6 +79,13 @@ void create_mesh(Mesh* rpMesh, VertexAttribute* rVertexAttributes, int rVertexAt
 
 void release_mesh(Mesh* rpMesh)
 {
+	// The page buffers are shared, only the ranges of the mesh are returned
+	if (rpMesh->HeapAllocation.pPage != nullptr)
+	{
+		geometry_heap_free(&rpMesh->HeapAllocation);
+		return;
+	}
+
 	release_vao(rpMesh->Vao);
 	release_vbo(rpMesh->Vbo);
 	release_ibo(rpMesh->Ibo);
@@ -5,6 +5,7 @@
 #include "material.h"
 #include "buffers/vertex_buffer_layout.h"
 #include "buffers/vertex_array.h"
+#include "buffers/geometry_heap.h"
 
 typedef struct
 {
@@ -15,8 +16,12 @@ typedef struct
 
 typedef struct
 {
+	// Vertices instead of indices when the mesh has no index buffer
 	unsigned int StartIndex;
 	unsigned int IndexCount;
+
+	// Instances drawn with gl_InstanceID, 0 for a plain draw
+	unsigned int InstanceCount;
 } Submesh;
 
 typedef struct
@@ -30,6 +35,21 @@ typedef struct
 
 	int IndexCount;
 
+	// Format of the index buffer and primitive of every submesh. create_mesh uses GL_UNSIGNED_INT and GL_TRIANGLES.
+	// Strips can be split with the largest index of the type (GL_PRIMITIVE_RESTART_FIXED_INDEX)
+	GLenum IndexType;
+	GLenum PrimitiveType;
+
+	// Quantized layout (see _assimp_mesh_importer.cpp): positions are snorm16 in the mesh bounds, read as
+	// PositionOffset + aPos * PositionScale, normals are octahedral snorm16 and UVs half floats
+	bool Quantized;
+	glm::vec3 PositionOffset;
+	glm::vec3 PositionScale;
+
+	// Set for meshes created by create_mesh_in_heap: Vao, Vbo and Ibo are those of the heap page, shared with other
+	// meshes, and the submeshes are relative to HeapAllocation.FirstVertex and HeapAllocation.IndexByteOffset
+	GeometryAllocation HeapAllocation;
+
 } Mesh;
 
 // Handle to model. Model is a mesh loaded as an asset
@@ -38,8 +58,39 @@ typedef struct
 	unsigned int Id;
 } MeshHandle;
 
+/// <summary>
+/// Creates the buffers of the mesh. When both arrays are given for a single submesh whose first attribute is the
+/// position (3 floats), they are reordered in place by mesh_optimize first. Unused vertices are not uploaded
+/// </summary>
 void create_mesh(Mesh* rpMesh, VertexAttribute* rVertexAttributes, int rVertexAttrCount, float* rVertices, int rVertexCount, unsigned int* rIndices, int rIndexCount, int r_subMeshCount, GLenum rUsage);
 
+/// <summary>
+/// Creates the buffers from data already in its final layout, without reordering it
+/// </summary>
+/// <param name="rIndexType">GL_UNSIGNED_SHORT or GL_UNSIGNED_INT</param>
+void create_mesh_from_data(Mesh* rpMesh, VertexAttribute* rVertexAttributes, int rVertexAttrCount, const void* rpVertices, int rVertexCount,
+	const void* rpIndices, int rIndexCount, GLenum rIndexType, int r_subMeshCount, GLenum rUsage);
+
+/// <summary>
+/// Same as create_mesh_from_data, with the vertices and indices placed in the geometry heap of their format.
+/// Falls back to buffers of its own if the heap can not hold the mesh
+/// </summary>
+void create_mesh_in_heap(Mesh* rpMesh, VertexAttribute* rVertexAttributes, int rVertexAttrCount, const void* rpVertices, int rVertexCount,
+	const void* rpIndices, int rIndexCount, GLenum rIndexType, int r_subMeshCount);
+
+/// <summary>
+/// Index of the first vertex and byte offset of the first index of the mesh in its buffers
+/// </summary>
+inline int mesh_get_base_vertex(const Mesh& r_mesh)
+{
+	return (int)r_mesh.HeapAllocation.FirstVertex;
+}
+
+inline size_t mesh_get_index_byte_offset(const Mesh& r_mesh)
+{
+	return r_mesh.HeapAllocation.IndexByteOffset;
+}
+
 void release_mesh(Mesh* rpMesh);
 
 #endif // !MESH_H
@@ -0,0 +1,355 @@
+#include "mesh_optimizer.h"
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+// The FIFO cache is emulated with the time each vertex was inserted: a vertex is still cached while fewer
+// than rCacheSize vertices were inserted after it. Time starts past rCacheSize so no vertex is cached at first
+static bool _cache_insert(unsigned int rVertex, std::vector<unsigned int>& rCacheTime, unsigned int& rTime, unsigned int rCacheSize)
+{
+	if (rTime - rCacheTime[rVertex] > rCacheSize)
+	{
+		rCacheTime[rVertex] = rTime++;
+		return true;
+	}
+	return false;
+}
+
+// Flushes the emulated cache
+static void _cache_reset(unsigned int& rTime, unsigned int rCacheSize)
+{
+	rTime += rCacheSize + 1;
+}
+
+MeshCacheStats mesh_analyze_vertex_cache(const unsigned int* rpIndices, size_t rIndexCount, size_t rVertexCount, unsigned int rCacheSize)
+{
+	std::vector<unsigned int> cacheTime(rVertexCount, 0);
+	std::vector<bool> used(rVertexCount, false);
+	unsigned int time = rCacheSize + 1;
+	size_t misses = 0;
+	size_t uniqueCount = 0;
+
+	for (size_t i = 0; i < rIndexCount; i++)
+	{
+		unsigned int vertex = rpIndices[i];
+		if (_cache_insert(vertex, cacheTime, time, rCacheSize))
+		{
+			misses++;
+		}
+		if (!used[vertex])
+		{
+			used[vertex] = true;
+			uniqueCount++;
+		}
+	}
+
+	size_t triangleCount = rIndexCount / 3;
+	MeshCacheStats stats;
+	stats.Acmr = triangleCount > 0 ? (float)misses / (float)triangleCount : 0.0f;
+	stats.Atvr = uniqueCount > 0 ? (float)misses / (float)uniqueCount : 0.0f;
+	return stats;
+}
+
+// Tipsify dead end: the latest emitted vertex that still has triangles, else the next one in index order
+static int _skip_dead_end(const std::vector<unsigned int>& rLive, std::vector<unsigned int>& rDeadEnd, size_t& rCursor)
+{
+	while (!rDeadEnd.empty())
+	{
+		unsigned int vertex = rDeadEnd.back();
+		rDeadEnd.pop_back();
+		if (rLive[vertex] > 0)
+		{
+			return (int)vertex;
+		}
+	}
+
+	for (; rCursor < rLive.size(); rCursor++)
+	{
+		if (rLive[rCursor] > 0)
+		{
+			return (int)rCursor;
+		}
+	}
+	return -1;
+}
+
+void mesh_optimize_vertex_cache(unsigned int* rpOutIndices, const unsigned int* rpIndices, size_t rIndexCount, size_t rVertexCount,
+	unsigned int rCacheSize, std::vector<unsigned int>* rpOutClusters)
+{
+	size_t triangleCount = rIndexCount / 3;
+
+	// Triangles of every vertex, and how many of them are not emitted yet
+	std::vector<unsigned int> live(rVertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		live[rpIndices[i]]++;
+	}
+	std::vector<unsigned int> adjacencyStart(rVertexCount + 1, 0);
+	for (size_t v = 0; v < rVertexCount; v++)
+	{
+		adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+	}
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> adjacencyFill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[adjacencyFill[rpIndices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<unsigned int> cacheTime(rVertexCount, 0);
+	unsigned int time = rCacheSize + 1;
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd;
+	deadEnd.reserve(triangleCount * 3);
+	std::vector<unsigned int> candidates;
+	size_t cursor = 0;
+	size_t outCount = 0;
+
+	if (rpOutClusters)
+	{
+		rpOutClusters->clear();
+		rpOutClusters->push_back(0);
+	}
+
+	int fan = _skip_dead_end(live, deadEnd, cursor);
+	while (fan >= 0)
+	{
+		// Emit every triangle left around the fanning vertex
+		candidates.clear();
+		for (unsigned int a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; a++)
+		{
+			unsigned int triangle = adjacency[a];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (unsigned int j = 0; j < 3; j++)
+			{
+				unsigned int vertex = rpIndices[triangle * 3 + j];
+				rpOutIndices[outCount++] = vertex;
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+				_cache_insert(vertex, cacheTime, time, rCacheSize);
+			}
+			emitted[triangle] = true;
+		}
+
+		// Next fan: the oldest candidate that will still be cached after its own triangles are emitted
+		int next = -1;
+		int bestPriority = -1;
+		for (unsigned int vertex : candidates)
+		{
+			if (live[vertex] == 0)
+			{
+				continue;
+			}
+
+			int priority = 0;
+			if (time - cacheTime[vertex] + 2 * live[vertex] <= rCacheSize)
+			{
+				priority = (int)(time - cacheTime[vertex]);
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = (int)vertex;
+			}
+		}
+
+		// Jumping away leaves the cache cold, a good place to split the clusters
+		if (next < 0)
+		{
+			next = _skip_dead_end(live, deadEnd, cursor);
+			if (next >= 0 && rpOutClusters)
+			{
+				rpOutClusters->push_back((unsigned int)(outCount / 3));
+			}
+		}
+		fan = next;
+	}
+}
+
+// Splits every cluster where its ACMR so far is already within rThreshold of the whole cluster one
+static void _split_clusters(const unsigned int* rpIndices, size_t rTriangleCount, size_t rVertexCount, const std::vector<unsigned int>& rClusters,
+	unsigned int rCacheSize, float rThreshold, std::vector<unsigned int>& rOutClusters)
+{
+	std::vector<unsigned int> cacheTime(rVertexCount, 0);
+	unsigned int time = rCacheSize + 1;
+	rOutClusters.clear();
+
+	for (size_t c = 0; c < rClusters.size(); c++)
+	{
+		size_t start = rClusters[c];
+		size_t end = c + 1 < rClusters.size() ? rClusters[c + 1] : rTriangleCount;
+
+		_cache_reset(time, rCacheSize);
+		size_t clusterMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			for (unsigned int j = 0; j < 3; j++)
+			{
+				clusterMisses += _cache_insert(rpIndices[t * 3 + j], cacheTime, time, rCacheSize) ? 1 : 0;
+			}
+		}
+		float clusterThreshold = rThreshold * (float)clusterMisses / (float)(end - start);
+
+		_cache_reset(time, rCacheSize);
+		rOutClusters.push_back((unsigned int)start);
+		size_t splitStart = start;
+		size_t misses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			for (unsigned int j = 0; j < 3; j++)
+			{
+				misses += _cache_insert(rpIndices[t * 3 + j], cacheTime, time, rCacheSize) ? 1 : 0;
+			}
+
+			if (t + 1 < end && (float)misses <= clusterThreshold * (float)(t + 1 - splitStart))
+			{
+				rOutClusters.push_back((unsigned int)(t + 1));
+				splitStart = t + 1;
+				misses = 0;
+				_cache_reset(time, rCacheSize);
+			}
+		}
+	}
+}
+
+void mesh_optimize_overdraw(unsigned int* rpIndices, size_t rIndexCount, const float* rpPositions, size_t rVertexStride, size_t rVertexCount,
+	const std::vector<unsigned int>& rClusters, unsigned int rCacheSize, float rThreshold)
+{
+	size_t triangleCount = rIndexCount / 3;
+	if (triangleCount == 0 || rClusters.empty())
+	{
+		return;
+	}
+
+	std::vector<unsigned int> clusters;
+	_split_clusters(rpIndices, triangleCount, rVertexCount, rClusters, rCacheSize, rThreshold, clusters);
+
+	const unsigned char* pPositionBytes = (const unsigned char*)rpPositions;
+	auto position = [&](unsigned int rVertex)
+	{
+		const float* p = (const float*)(pPositionBytes + rVertex * rVertexStride);
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	glm::vec3 meshCentroid(0.0f);
+	for (size_t v = 0; v < rVertexCount; v++)
+	{
+		meshCentroid += position((unsigned int)v);
+	}
+	meshCentroid /= (float)std::max(rVertexCount, (size_t)1);
+
+	// Clusters facing away from the center are in front of the rest from most views, draw them first
+	std::vector<float> sortKeys(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		size_t start = clusters[c];
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = start; t < end; t++)
+		{
+			glm::vec3 p0 = position(rpIndices[t * 3 + 0]);
+			glm::vec3 p1 = position(rpIndices[t * 3 + 1]);
+			glm::vec3 p2 = position(rpIndices[t * 3 + 2]);
+			glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(triangleNormal);
+
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+
+		float normalLength = glm::length(normal);
+		if (area > 0.0f && normalLength > 0.0f)
+		{
+			sortKeys[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+		}
+		else
+		{
+			sortKeys[c] = 0.0f;
+		}
+	}
+
+	std::vector<unsigned int> order(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		order[c] = (unsigned int)c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> sorted(rpIndices, rpIndices + triangleCount * 3);
+	size_t outCount = 0;
+	for (unsigned int c : order)
+	{
+		size_t start = clusters[c];
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		for (size_t i = start * 3; i < end * 3; i++)
+		{
+			rpIndices[outCount++] = sorted[i];
+		}
+	}
+}
+
+size_t mesh_optimize_vertex_fetch(void* rpVertices, size_t rVertexCount, size_t rVertexSize, unsigned int* rpIndices, size_t rIndexCount)
+{
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(rVertexCount, unused);
+	unsigned int nextVertex = 0;
+	for (size_t i = 0; i < rIndexCount; i++)
+	{
+		unsigned int& newVertex = remap[rpIndices[i]];
+		if (newVertex == unused)
+		{
+			newVertex = nextVertex++;
+		}
+		rpIndices[i] = newVertex;
+	}
+
+	unsigned char* pVertexBytes = (unsigned char*)rpVertices;
+	std::vector<unsigned char> source(pVertexBytes, pVertexBytes + rVertexCount * rVertexSize);
+	for (size_t v = 0; v < rVertexCount; v++)
+	{
+		if (remap[v] != unused)
+		{
+			memcpy(pVertexBytes + remap[v] * rVertexSize, source.data() + v * rVertexSize, rVertexSize);
+		}
+	}
+	return nextVertex;
+}
+
+size_t mesh_optimize(void* rpVertices, size_t rVertexCount, size_t rVertexSize, unsigned int* rpIndices, size_t rIndexCount, const char* rpName)
+{
+	if (rIndexCount < 3 || rVertexCount == 0)
+	{
+		return rVertexCount;
+	}
+
+	MeshCacheStats before = mesh_analyze_vertex_cache(rpIndices, rIndexCount, rVertexCount, MESH_OPTIMIZER_CACHE_SIZE);
+
+	std::vector<unsigned int> indices(rIndexCount);
+	std::vector<unsigned int> clusters;
+	mesh_optimize_vertex_cache(indices.data(), rpIndices, rIndexCount, rVertexCount, MESH_OPTIMIZER_CACHE_SIZE, &clusters);
+	mesh_optimize_overdraw(indices.data(), rIndexCount, (const float*)rpVertices, rVertexSize, rVertexCount, clusters,
+		MESH_OPTIMIZER_CACHE_SIZE, MESH_OPTIMIZER_OVERDRAW_THRESHOLD);
+	memcpy(rpIndices, indices.data(), (rIndexCount / 3) * 3 * sizeof(unsigned int));
+
+	size_t vertexCount = mesh_optimize_vertex_fetch(rpVertices, rVertexCount, rVertexSize, rpIndices, rIndexCount);
+
+	if (rpName)
+	{
+		MeshCacheStats after = mesh_analyze_vertex_cache(rpIndices, rIndexCount, vertexCount, MESH_OPTIMIZER_CACHE_SIZE);
+		std::cout << "MESH::OPTIMIZER - " << rpName << ": " << rIndexCount / 3 << " triangles, "
+			<< "ACMR " << before.Acmr << " -> " << after.Acmr << ", ATVR " << before.Atvr << " -> " << after.Atvr
+			<< ", vertices " << rVertexCount << " -> " << vertexCount << std::endl;
+	}
+	return vertexCount;
+}
@@ -0,0 +1,62 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <vector>
+
+// Reorders indexed triangle lists for the GPU, run when a mesh is created or imported:
+// 1. Vertex cache: Tipsify (Sander et al. 2007) fans around the last used vertices so they are still
+//    in the post-transform cache. It also splits the triangles in clusters where the fan jumps away.
+// 2. Overdraw: the clusters are split where their cache efficiency is already close to the mesh one and
+//    sorted so the ones facing outwards are drawn first, occluding the rest of the mesh.
+// 3. Vertex fetch: vertices are renumbered in the order the indices first use them, unused ones are dropped.
+// ACMR is the average of vertices transformed per triangle (0.5 at best, 3 at worst), ATVR the vertices
+// transformed per unique vertex (1 at best).
+
+// Entries of the emulated post-transform cache (FIFO), also the Tipsify target
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+
+// A cluster is split once its ACMR is within this factor of the whole cluster one. Higher gives smaller
+// clusters, so better overdraw ordering for worse vertex cache use
+#define MESH_OPTIMIZER_OVERDRAW_THRESHOLD 1.05f
+
+// create_mesh prints the statistics of meshes with at least this many triangles
+#define MESH_OPTIMIZER_REPORT_TRIANGLES 1024
+
+typedef struct
+{
+	float Acmr;
+	float Atvr;
+} MeshCacheStats;
+
+/// <summary>
+/// Emulates a FIFO post-transform cache of rCacheSize entries over the triangle list
+/// </summary>
+MeshCacheStats mesh_analyze_vertex_cache(const unsigned int* rpIndices, size_t rIndexCount, size_t rVertexCount, unsigned int rCacheSize);
+
+/// <summary>
+/// Tipsify. rpOutIndices may not alias rpIndices
+/// </summary>
+/// <param name="rpOutClusters">Optional. First triangle of every cluster, starting with 0</param>
+void mesh_optimize_vertex_cache(unsigned int* rpOutIndices, const unsigned int* rpIndices, size_t rIndexCount, size_t rVertexCount,
+	unsigned int rCacheSize, std::vector<unsigned int>* rpOutClusters);
+
+/// <summary>
+/// Sorts the clusters of a list reordered by mesh_optimize_vertex_cache. Positions are the first 3 floats of each vertex
+/// </summary>
+void mesh_optimize_overdraw(unsigned int* rpIndices, size_t rIndexCount, const float* rpPositions, size_t rVertexStride, size_t rVertexCount,
+	const std::vector<unsigned int>& rClusters, unsigned int rCacheSize, float rThreshold);
+
+/// <summary>
+/// Renumbers the vertices in the order they are first used and moves their data to match.
+/// Returns the vertex count left, unused vertices are dropped
+/// </summary>
+size_t mesh_optimize_vertex_fetch(void* rpVertices, size_t rVertexCount, size_t rVertexSize, unsigned int* rpIndices, size_t rIndexCount);
+
+/// <summary>
+/// Runs the three passes in place on one triangle list. Positions are the first 3 floats of each vertex.
+/// Returns the vertex count left. When rpName is not null the statistics before and after are printed
+/// </summary>
+size_t mesh_optimize(void* rpVertices, size_t rVertexCount, size_t rVertexSize, unsigned int* rpIndices, size_t rIndexCount, const char* rpName);
+
+#endif // !MESH_OPTIMIZER_H
@@ -6,4 +6,9 @@ void model_init(Model* pModel, Mesh* pMesh)
 	pModel->p_Mesh = pMesh;
 	pModel->MaterialCount = pMesh->SubmeshCount;
 	pModel->p_MaterialHandles = (MaterialHandle*)CE_MALLOC(sizeof(MaterialHandle)*pMesh->SubmeshCount);
+	pModel->BoundsMin = glm::vec3(0.0f);
+	pModel->BoundsMax = glm::vec3(0.0f);
+	pModel->p_BuoyancyPoints = nullptr;
+	pModel->BuoyancyPointCount = 0;
+	pModel->BuoyancyPointVolume = 0.0f;
 }
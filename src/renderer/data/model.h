@@ -10,6 +10,16 @@ typedef struct
 
 	MaterialHandle* p_MaterialHandles;
 	unsigned int MaterialCount; // TODO: Usually, the submesh count and material count should be equal. But sometimes we could have all submeshes sharing material?
+
+	// Model space bounds of all submeshes
+	glm::vec3 BoundsMin;
+	glm::vec3 BoundsMax;
+
+	// Buoyancy sample points in model space, voxelized from the mesh at import. Each one
+	// stands for BuoyancyPointVolume of the model volume. nullptr for procedural models
+	glm::vec3* p_BuoyancyPoints;
+	unsigned int BuoyancyPointCount;
+	float BuoyancyPointVolume;
 } Model;
 
 typedef struct
@@ -6,20 +6,281 @@
 #include <string>
 #include <regex>
 #include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
 
-void create_shader(Shader* rpShader, const char* rVertexShaderFile, const char* rFragmentShaderFile)
+// Files read by read_shader_from_file, shared by every shader that includes them
+static std::unordered_map<std::string, std::string> s_SourceFiles;
+
+static ShaderSetupStats s_SetupStats = {};
+static ShaderUniformStats s_UniformStats = {};
+
+struct ShaderUniformTable
+{
+	std::unordered_map<unsigned long long, ShaderUniform> Uniforms;
+};
+
+// By program. Elements of an unordered_map keep their address, so Shader::pUniforms stays valid
+static std::unordered_map<unsigned int, ShaderUniformTable> s_UniformTables;
+
+static std::vector<ShaderProgramDeletedFunc> s_ProgramDeletedFuncs;
+
+typedef struct
+{
+	char Magic[4];
+	unsigned int Version;
+	unsigned int Format;
+	unsigned int Length;
+} ShaderBinaryHeader;
+
+static const char SHADER_BINARY_MAGIC[4] = { 'O', 'C', 'S', 'B' };
+
+// FNV-1a
+static unsigned long long _hash_bytes(unsigned long long rHash, const std::string& rBytes)
+{
+	for (char c : rBytes)
+	{
+		rHash ^= (unsigned char)c;
+		rHash *= 1099511628211ull;
+	}
+	return rHash;
+}
+
+// The binary of a program is only valid for the driver that produced it
+static std::string _get_binary_cache_path(const std::string& rVertexStr, const std::string& rFragStr)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	hash = _hash_bytes(hash, rVertexStr);
+	hash = _hash_bytes(hash, std::string(1, '\0'));
+	hash = _hash_bytes(hash, rFragStr);
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+	{
+		const char* pValue = (const char*)glGetString(name);
+		hash = _hash_bytes(hash, pValue ? pValue : "");
+	}
+
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "%016llx.bin", hash);
+	return std::string(SHADER_CACHE_DIRECTORY) + fileName;
+}
+
+unsigned long long shader_hash_defines(const std::vector<ShaderDefine>& rDefines)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	for (const ShaderDefine& define : rDefines)
+	{
+		hash = _hash_bytes(hash, define.Name + "=" + std::to_string(define.Value) + ";");
+	}
+	return hash;
+}
+
+// The defines go right after the #version line, which must stay the first one
+static void _insert_defines(std::string& rStr, const std::vector<ShaderDefine>& rDefines)
 {
+	if (rDefines.empty())
+	{
+		return;
+	}
+
+	std::string defines;
+	for (const ShaderDefine& define : rDefines)
+	{
+		defines += "#define " + define.Name + " " + std::to_string(define.Value) + "\n";
+	}
+
+	size_t insertAt = 0;
+	size_t versionLine = rStr.find("#version");
+	if (versionLine != std::string::npos)
+	{
+		size_t lineEnd = rStr.find('\n', versionLine);
+		if (lineEnd == std::string::npos)
+		{
+			rStr += "\n";
+			lineEnd = rStr.size() - 1;
+		}
+		insertAt = lineEnd + 1;
+	}
+	rStr.insert(insertAt, defines);
+}
+
+static bool _is_binary_cache_supported()
+{
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0;
+}
+
+// Returns 0 if the file is missing, stale or rejected by the driver
+static unsigned int _load_program_binary(const std::string& rPath)
+{
+	std::ifstream in(rPath, std::ios::binary);
+	if (!in)
+	{
+		return 0;
+	}
+
+	ShaderBinaryHeader header;
+	in.read((char*)&header, sizeof(header));
+	if (!in || memcmp(header.Magic, SHADER_BINARY_MAGIC, sizeof(SHADER_BINARY_MAGIC)) != 0 || header.Version != SHADER_CACHE_VERSION)
+	{
+		return 0;
+	}
+	std::vector<char> binary(header.Length);
+	in.read(binary.data(), header.Length);
+	if (!in)
+	{
+		return 0;
+	}
+
+	unsigned int program = glCreateProgram();
+	glProgramBinary(program, header.Format, binary.data(), (GLsizei)header.Length);
+
+	// Drivers reject binaries of other versions here
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+static void _save_program_binary(unsigned int rProgram, const std::string& rPath)
+{
+	GLint length = 0;
+	glGetProgramiv(rProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(rProgram, length, &length, &format, binary.data());
+
+	ShaderBinaryHeader header;
+	memcpy(header.Magic, SHADER_BINARY_MAGIC, sizeof(SHADER_BINARY_MAGIC));
+	header.Version = SHADER_CACHE_VERSION;
+	header.Format = format;
+	header.Length = (unsigned int)length;
+
+	std::error_code error;
+	std::filesystem::create_directories(SHADER_CACHE_DIRECTORY, error);
+	std::ofstream out(rPath, std::ios::binary | std::ios::trunc);
+	out.write((const char*)&header, sizeof(header));
+	out.write(binary.data(), length);
+	if (!out)
+	{
+		std::cout << "ERROR::SHADER::CACHE - Could not write " << rPath << std::endl;
+	}
+}
+
+static unsigned long long _hash_name(const char* rpName)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	for (const char* c = rpName; *c != '\0'; c++)
+	{
+		hash ^= (unsigned char)*c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// The only glGetUniformLocation calls for programs created by create_shader
+static const ShaderUniformTable* _reflect_uniforms(unsigned int rProgram)
+{
+	auto found = s_UniformTables.find(rProgram);
+	if (found != s_UniformTables.end())
+	{
+		return &found->second;
+	}
+
+	ShaderUniformTable& table = s_UniformTables[rProgram];
+	int uniformCount = 0;
+	glGetProgramiv(rProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+	char name[256];
+	for (int i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(rProgram, i, sizeof(name), &nameLength, &size, &type, name);
+
+		// Arrays are reported once as "name[0]", every element is added and the bare name too
+		std::string baseName(name, nameLength);
+		bool isArray = baseName.size() > 3 && baseName.compare(baseName.size() - 3, 3, "[0]") == 0;
+		if (isArray)
+		{
+			baseName.resize(baseName.size() - 3);
+		}
+
+		for (int element = 0; element < size; element++)
+		{
+			std::string elementName = isArray ? baseName + "[" + std::to_string(element) + "]" : baseName;
+			ShaderUniform uniform = { rProgram, glGetUniformLocation(rProgram, elementName.c_str()), type };
+			// Members of uniform blocks have no location
+			if (uniform.Location < 0)
+			{
+				continue;
+			}
+			table.Uniforms[_hash_name(elementName.c_str())] = uniform;
+			if (isArray && element == 0)
+			{
+				table.Uniforms[_hash_name(baseName.c_str())] = uniform;
+			}
+		}
+	}
+	return &table;
+}
+
+static void _set_builtin_uniforms(Shader* rpShader, unsigned int rProgram)
+{
+	rpShader->ShaderProgram = rProgram;
+	rpShader->pUniforms = _reflect_uniforms(rProgram);
+	rpShader->ModelMatrixUniform = shader_get_uniform(rpShader, "Model").Location;
+	rpShader->ViewMatrixUniform = shader_get_uniform(rpShader, "View").Location;
+	rpShader->ProjectionMatrixUniform = shader_get_uniform(rpShader, "Projection").Location;
+}
+
+void create_shader(Shader* rpShader, const char* rVertexShaderFile, const char* rFragmentShaderFile, const std::vector<ShaderDefine>& rDefines)
+{
+	auto start = std::chrono::high_resolution_clock::now();
 	int  success;
 	char infoLog[512];
+	rpShader->pMirror = nullptr;
 
-	// vvv Vertex shader --------------
-	// Read vertex shader file
+	// Read both stages first, the binary cache is keyed by their expanded sources
 	std::string vertexStr;
 	if (read_shader_from_file(vertexStr, rVertexShaderFile))
 	{
 		std::cout << "Error when creating vertex shader!" << std::endl;
 	}
+	std::string fragStr;
+	if (read_shader_from_file(fragStr, rFragmentShaderFile))
+	{
+		std::cout << "Error when creating fragment shader!" << std::endl;
+	}
+	_insert_defines(vertexStr, rDefines);
+	_insert_defines(fragStr, rDefines);
+
+	bool binaryCache = _is_binary_cache_supported();
+	std::string binaryPath = binaryCache ? _get_binary_cache_path(vertexStr, fragStr) : std::string();
+	unsigned int cachedProgram = binaryCache ? _load_program_binary(binaryPath) : 0;
+	if (cachedProgram != 0)
+	{
+		_set_builtin_uniforms(rpShader, cachedProgram);
+		s_SetupStats.ProgramCount++;
+		s_SetupStats.CachedProgramCount++;
+		s_SetupStats.Milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		return;
+	}
+
+	// vvv Vertex shader --------------
 	const char* vertexChars = vertexStr.c_str();
 
 	// Create vertex shader
@@ -48,12 +309,6 @@ void create_shader(Shader* rpShader, const char* rVertexShaderFile, const char*
 	// ^^^ ----------------------------
 
 	// vvv Fragment shader ------------
-	
-	std::string fragStr;
-	if (read_shader_from_file(fragStr, rFragmentShaderFile))
-	{
-		std::cout << "Error when creating fragment shader!" << std::endl;
-	}
 	const char* fragChars = fragStr.c_str();
 
 	// Create Fragment shader
@@ -73,6 +328,10 @@ void create_shader(Shader* rpShader, const char* rVertexShaderFile, const char*
 	unsigned int shaderProgram = glCreateProgram();
 	glAttachShader(shaderProgram, vertexShader);
 	glAttachShader(shaderProgram, fragShader);
+	if (binaryCache)
+	{
+		glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(shaderProgram);
 
 	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
@@ -91,15 +350,211 @@ void create_shader(Shader* rpShader, const char* rVertexShaderFile, const char*
 		out << "\n############################################\n" << infoLog;
 		out.close();
 	}
+	else if (binaryCache)
+	{
+		_save_program_binary(shaderProgram, binaryPath);
+	}
 
 	// Delete shaders
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragShader);
 
-	rpShader->ShaderProgram = shaderProgram;
-	rpShader->ModelMatrixUniform = glGetUniformLocation(rpShader->ShaderProgram, "Model");
-	rpShader->ViewMatrixUniform = glGetUniformLocation(rpShader->ShaderProgram, "View");
-	rpShader->ProjectionMatrixUniform = glGetUniformLocation(rpShader->ShaderProgram, "Projection");
+	_set_builtin_uniforms(rpShader, shaderProgram);
+	s_SetupStats.ProgramCount++;
+	s_SetupStats.Milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void shader_set_program(Shader* rpShader, unsigned int rProgram)
+{
+	_set_builtin_uniforms(rpShader, rProgram);
+}
+
+void shader_delete_program(unsigned int rProgram)
+{
+	for (const ShaderProgramDeletedFunc& func : s_ProgramDeletedFuncs)
+	{
+		func(rProgram);
+	}
+	s_UniformTables.erase(rProgram);
+	gl_state_forget_program(rProgram);
+	glDeleteProgram(rProgram);
+}
+
+void shader_add_program_deleted_callback(const ShaderProgramDeletedFunc& rFunc)
+{
+	s_ProgramDeletedFuncs.push_back(rFunc);
+}
+
+void shader_set_mirror(Shader* rpShader, Shader* rpMirror)
+{
+	rpShader->pMirror = rpMirror;
+	if (rpMirror != nullptr)
+	{
+		shader_copy_uniforms(rpShader->ShaderProgram, rpMirror->ShaderProgram);
+	}
+}
+
+void shader_copy_uniforms(unsigned int rSource, unsigned int rDestination)
+{
+	int uniformCount = 0;
+	glGetProgramiv(rSource, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+	char name[256];
+	for (int i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(rSource, i, sizeof(name), &nameLength, &size, &type, name);
+
+		// Arrays are reported once as "name[0]", their elements are copied one by one
+		std::string baseName(name, nameLength);
+		if (size > 1 && baseName.size() > 3 && baseName.compare(baseName.size() - 3, 3, "[0]") == 0)
+		{
+			baseName.resize(baseName.size() - 3);
+		}
+
+		for (int element = 0; element < size; element++)
+		{
+			std::string elementName = size > 1 ? baseName + "[" + std::to_string(element) + "]" : baseName;
+			int sourceLocation = glGetUniformLocation(rSource, elementName.c_str());
+			int destinationLocation = glGetUniformLocation(rDestination, elementName.c_str());
+			// Members of uniform blocks have no location
+			if (sourceLocation < 0 || destinationLocation < 0)
+			{
+				continue;
+			}
+
+			float f[16];
+			int n[4];
+			switch (type)
+			{
+			case GL_FLOAT:
+				glGetUniformfv(rSource, sourceLocation, f);
+				glProgramUniform1fv(rDestination, destinationLocation, 1, f);
+				break;
+			case GL_FLOAT_VEC2:
+				glGetUniformfv(rSource, sourceLocation, f);
+				glProgramUniform2fv(rDestination, destinationLocation, 1, f);
+				break;
+			case GL_FLOAT_VEC3:
+				glGetUniformfv(rSource, sourceLocation, f);
+				glProgramUniform3fv(rDestination, destinationLocation, 1, f);
+				break;
+			case GL_FLOAT_VEC4:
+				glGetUniformfv(rSource, sourceLocation, f);
+				glProgramUniform4fv(rDestination, destinationLocation, 1, f);
+				break;
+			case GL_FLOAT_MAT3:
+				glGetUniformfv(rSource, sourceLocation, f);
+				glProgramUniformMatrix3fv(rDestination, destinationLocation, 1, GL_FALSE, f);
+				break;
+			case GL_FLOAT_MAT4:
+				glGetUniformfv(rSource, sourceLocation, f);
+				glProgramUniformMatrix4fv(rDestination, destinationLocation, 1, GL_FALSE, f);
+				break;
+			case GL_INT_VEC2:
+			case GL_BOOL_VEC2:
+				glGetUniformiv(rSource, sourceLocation, n);
+				glProgramUniform2iv(rDestination, destinationLocation, 1, n);
+				break;
+			case GL_INT_VEC3:
+			case GL_BOOL_VEC3:
+				glGetUniformiv(rSource, sourceLocation, n);
+				glProgramUniform3iv(rDestination, destinationLocation, 1, n);
+				break;
+			case GL_INT_VEC4:
+			case GL_BOOL_VEC4:
+				glGetUniformiv(rSource, sourceLocation, n);
+				glProgramUniform4iv(rDestination, destinationLocation, 1, n);
+				break;
+			default:
+				// int, bool and the sampler units
+				glGetUniformiv(rSource, sourceLocation, n);
+				glProgramUniform1iv(rDestination, destinationLocation, 1, n);
+				break;
+			}
+		}
+	}
+}
+
+ShaderUniform shader_get_uniform(const Shader* rpShader, const char* rUniformName)
+{
+	if (rpShader->pUniforms == nullptr)
+	{
+		return { rpShader->ShaderProgram, glGetUniformLocation(rpShader->ShaderProgram, rUniformName), 0 };
+	}
+
+	auto found = rpShader->pUniforms->Uniforms.find(_hash_name(rUniformName));
+	if (found == rpShader->pUniforms->Uniforms.end())
+	{
+		return { rpShader->ShaderProgram, -1, 0 };
+	}
+	return found->second;
+}
+
+int shader_find_uniform(const Shader* rpShader, const char* rUniformName)
+{
+	if (rpShader->pUniforms == nullptr)
+	{
+		s_UniformStats.DriverLookups++;
+	}
+	else
+	{
+		s_UniformStats.TableLookups++;
+	}
+	return shader_get_uniform(rpShader, rUniformName).Location;
+}
+
+ShaderUniformStats shader_get_uniform_stats()
+{
+	return s_UniformStats;
+}
+
+void shader_reset_uniform_stats()
+{
+	s_UniformStats = {};
+}
+
+void set_uniform_vec2(const ShaderUniform& rUniform, glm::vec2 rValue)
+{
+	s_UniformStats.HandleWrites++;
+	glProgramUniform2f(rUniform.Program, rUniform.Location, rValue.x, rValue.y);
+}
+
+void set_uniform_vec3(const ShaderUniform& rUniform, glm::vec3 rValue)
+{
+	s_UniformStats.HandleWrites++;
+	glProgramUniform3f(rUniform.Program, rUniform.Location, rValue.x, rValue.y, rValue.z);
+}
+
+void set_uniform_vec4(const ShaderUniform& rUniform, glm::vec4 rValue)
+{
+	s_UniformStats.HandleWrites++;
+	glProgramUniform4f(rUniform.Program, rUniform.Location, rValue.x, rValue.y, rValue.z, rValue.w);
+}
+
+void set_uniform_float(const ShaderUniform& rUniform, float rValue)
+{
+	s_UniformStats.HandleWrites++;
+	glProgramUniform1f(rUniform.Program, rUniform.Location, rValue);
+}
+
+void set_uniform_int(const ShaderUniform& rUniform, int rValue)
+{
+	s_UniformStats.HandleWrites++;
+	glProgramUniform1i(rUniform.Program, rUniform.Location, rValue);
+}
+
+void set_uniform_mat4(const ShaderUniform& rUniform, const glm::mat4x4& rValue)
+{
+	s_UniformStats.HandleWrites++;
+	glProgramUniformMatrix4fv(rUniform.Program, rUniform.Location, 1, GL_FALSE, glm::value_ptr(rValue));
+}
+
+ShaderSetupStats shader_get_setup_stats()
+{
+	return s_SetupStats;
 }
 
 int process_shader_includes(std::string& rStr, const std::string& rPath, std::unordered_set<std::string>& includedFiles);
@@ -120,46 +575,48 @@ int process_shader_includes(std::string& rStr, const std::string& rPath, std::un
 
 	includedFiles.insert(rPath);
 
-	std::ifstream file;
-
-	try
+	auto cached = s_SourceFiles.find(rPath);
+	if (cached == s_SourceFiles.end())
 	{
-		file.open(rPath);
-		std::stringstream shaderStream;
-		std::string line;
-
-		while (std::getline(file, line))
+		std::ifstream file(rPath);
+		if (!file)
 		{
-			std::smatch match;
-			std::regex includeRegex("^\\s*#include\\s+\"([^\"]+)\"\\s*");
-
-				if (std::regex_match(line, match, includeRegex))
-				{
-					std::string includePath = match[1].str();
-					std::string includeContent;
-					int result = process_shader_includes(includeContent, includePath, includedFiles);
-					if (result != 0)
-					{
-						return result;
-					}
-					shaderStream << "// Begin include: " << includePath << "\n";
-					shaderStream << includeContent << "\n";
-					shaderStream << "// End include: " << includePath << "\n";
-				}
-				else
-				{
-					shaderStream << line << "\n";
-				}
+			std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << rPath << std::endl;
+			return -1;
 		}
-
-		file.close();
-		rStr = shaderStream.str();
+		std::stringstream fileStream;
+		fileStream << file.rdbuf();
+		cached = s_SourceFiles.emplace(rPath, fileStream.str()).first;
 	}
-	catch (std::ifstream::failure& e)
+
+	static const std::regex includeRegex("^\\s*#include\\s+\"([^\"]+)\"\\s*");
+
+	std::stringstream shaderStream;
+	std::istringstream source(cached->second);
+	std::string line;
+	while (std::getline(source, line))
 	{
-		std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << rPath << ", " << e.what() << std::endl;
-		return -1;
+		// Only the lines that can be an include go through the regex
+		std::smatch match;
+		if (line.find("#include") != std::string::npos && std::regex_match(line, match, includeRegex))
+		{
+			std::string includePath = match[1].str();
+			std::string includeContent;
+			int result = process_shader_includes(includeContent, includePath, includedFiles);
+			if (result != 0)
+			{
+				return result;
+			}
+			shaderStream << "// Begin include: " << includePath << "\n";
+			shaderStream << includeContent << "\n";
+			shaderStream << "// End include: " << includePath << "\n";
+		}
+		else
+		{
+			shaderStream << line << "\n";
+		}
 	}
 
+	rStr = shaderStream.str();
 	return 0;
 }
@@ -2,12 +2,50 @@
 #define SHADER_H
 
 #include <string>
+#include <vector>
+#include <functional>
 #include <glad/glad.h>
+#include "../gl_state_cache.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-typedef struct {
+// Linked programs are stored with glGetProgramBinary in SHADER_CACHE_DIRECTORY, keyed by a hash of the expanded
+// sources of both stages and the driver strings, and restored with glProgramBinary when the key matches.
+// Included files are read once and shared by every shader. Bump SHADER_CACHE_VERSION to drop the stored binaries
+#define SHADER_CACHE_DIRECTORY "shader_cache/"
+#define SHADER_CACHE_VERSION 1
+
+// The active uniforms of every program are reflected once after linking into a table keyed by a hash of their
+// name (array elements included), so the set_uniform_* helpers never ask the driver for a location.
+// Hot paths can resolve a ShaderUniform handle once and write through it. A handle belongs to one program:
+// resolve it again when the Shader changes program (see shader_variants.h)
+
+// Reflected uniforms of one program, owned by shader.cpp
+struct ShaderUniformTable;
+
+typedef struct
+{
+	unsigned int Program;
+	// -1 when the program has no such active uniform, writes to it are ignored
+	int Location;
+	// GL_FLOAT_VEC3, GL_SAMPLER_2D...
+	unsigned int Type;
+} ShaderUniform;
+
+// Uniform writes since the last shader_reset_uniform_stats. Each one used to be a glGetUniformLocation call
+typedef struct
+{
+	unsigned int TableLookups;
+	unsigned int HandleWrites;
+	// Lookups of shaders without a table, still sent to the driver
+	unsigned int DriverLookups;
+} ShaderUniformStats;
+
+typedef struct Shader {
 	unsigned int ShaderProgram;
+	const ShaderUniformTable* pUniforms;
+	// Receives every write made through the name based set_uniform_* helpers, nullptr for none (see shader_set_mirror)
+	struct Shader* pMirror;
 
 	unsigned int ModelMatrixUniform;
 	unsigned int ViewMatrixUniform;
@@ -20,40 +58,158 @@ typedef struct
 	unsigned int GenerationId;
 } ShaderHandle;
 
-void create_shader(Shader* rpShader, const char* rVertexShaderFile, const char* rFragmentShaderFile);
+typedef std::function<void(unsigned int rProgram)> ShaderProgramDeletedFunc;
+
+// Preprocessor constant inserted after #version, "#define Name Value"
+typedef struct
+{
+	std::string Name;
+	int Value;
+} ShaderDefine;
+
+// Programs created since startup and the time spent in create_shader
+typedef struct
+{
+	unsigned int ProgramCount;
+	unsigned int CachedProgramCount;
+	double Milliseconds;
+} ShaderSetupStats;
+
+/// <summary>
+/// Compiles and links both stages, or restores them from the binary cache
+/// </summary>
+/// <param name="rDefines">Inserted in both stages, the binary cache key includes them</param>
+void create_shader(Shader* rpShader, const char* rVertexShaderFile, const char* rFragmentShaderFile, const std::vector<ShaderDefine>& rDefines = {});
+
+/// <summary>
+/// Hash of a define set, order dependent. The empty set is the generic variant
+/// </summary>
+unsigned long long shader_hash_defines(const std::vector<ShaderDefine>& rDefines);
+
+ShaderSetupStats shader_get_setup_stats();
+
+/// <summary>
+/// Makes rpShader use rProgram and looks up its Model/View/Projection uniforms. The previous program is not deleted
+/// </summary>
+void shader_set_program(Shader* rpShader, unsigned int rProgram);
+
+/// <summary>
+/// Deletes a program and its uniform table. Only for programs not used by any Shader
+/// </summary>
+void shader_delete_program(unsigned int rProgram);
+
+/// <summary>
+/// rFunc is called with every program passed to shader_delete_program before it is deleted. Caches keyed by
+/// program name must drop it there, GL can give the same name to the next program
+/// </summary>
+void shader_add_program_deleted_callback(const ShaderProgramDeletedFunc& rFunc);
+
+/// <summary>
+/// Repeats on rpMirror every write made to rpShader through the name based set_uniform_* helpers, so a program
+/// sharing its settings (a depth only build) follows them without querying the driver. The current values are
+/// copied once. nullptr stops mirroring. Handle writes are not mirrored
+/// </summary>
+void shader_set_mirror(Shader* rpShader, Shader* rpMirror);
+
+/// <summary>
+/// Copies the value of every default block uniform of rSource to the same uniform of rDestination.
+/// Uniforms compiled out of either program are skipped
+/// </summary>
+void shader_copy_uniforms(unsigned int rSource, unsigned int rDestination);
+
+/// <summary>
+/// Handle of a uniform of the current program of rpShader. Array elements are found as "name[i]", "name" is the first one
+/// </summary>
+ShaderUniform shader_get_uniform(const Shader* rpShader, const char* rUniformName);
+
+/// <summary>
+/// Location of a uniform of the current program of rpShader, -1 if it is not active
+/// </summary>
+int shader_find_uniform(const Shader* rpShader, const char* rUniformName);
+
+ShaderUniformStats shader_get_uniform_stats();
+void shader_reset_uniform_stats();
 
 int read_shader_from_file(std::string& rSt, const char* rPath);
 
 inline void use_shader(Shader* rpShader)
 {
-	glUseProgram(rpShader->ShaderProgram);
+	gl_state_use_program(rpShader->ShaderProgram);
 }
 
+// The set_uniform_* helpers write to rpShader even when another program is bound, and to its mirror
+
 inline void set_uniform_1i(Shader* rpShader, const char* rUniformName, unsigned int rValue)
 {
-	glUniform1i(glGetUniformLocation(rpShader->ShaderProgram, rUniformName), rValue);
+	glProgramUniform1i(rpShader->ShaderProgram, shader_find_uniform(rpShader, rUniformName), rValue);
+	if (rpShader->pMirror != nullptr)
+	{
+		set_uniform_1i(rpShader->pMirror, rUniformName, rValue);
+	}
 }
 
 inline void set_uniform_vec3(Shader* rpShader, const char* rUniformName, glm::vec3 rValue)
 {
-	glUniform3f(glGetUniformLocation(rpShader->ShaderProgram, rUniformName), rValue.x, rValue.y, rValue.z);
+	glProgramUniform3f(rpShader->ShaderProgram, shader_find_uniform(rpShader, rUniformName), rValue.x, rValue.y, rValue.z);
+	if (rpShader->pMirror != nullptr)
+	{
+		set_uniform_vec3(rpShader->pMirror, rUniformName, rValue);
+	}
 }
 
 inline void set_uniform_vec2(Shader* rpShader, const char* rUniformName, glm::vec2 rValue)
 {
-	glUniform2f(glGetUniformLocation(rpShader->ShaderProgram, rUniformName), rValue.x, rValue.y);
+	glProgramUniform2f(rpShader->ShaderProgram, shader_find_uniform(rpShader, rUniformName), rValue.x, rValue.y);
+	if (rpShader->pMirror != nullptr)
+	{
+		set_uniform_vec2(rpShader->pMirror, rUniformName, rValue);
+	}
+}
+
+inline void set_uniform_vec4(Shader* rpShader, const char* rUniformName, glm::vec4 rValue)
+{
+	glProgramUniform4f(rpShader->ShaderProgram, shader_find_uniform(rpShader, rUniformName), rValue.x, rValue.y, rValue.z, rValue.w);
+	if (rpShader->pMirror != nullptr)
+	{
+		set_uniform_vec4(rpShader->pMirror, rUniformName, rValue);
+	}
 }
 
 inline void set_uniform_float(Shader* rpShader, const char* rUniformName, float rValue)
 {
-	glUniform1f(glGetUniformLocation(rpShader->ShaderProgram, rUniformName), rValue);
+	glProgramUniform1f(rpShader->ShaderProgram, shader_find_uniform(rpShader, rUniformName), rValue);
+	if (rpShader->pMirror != nullptr)
+	{
+		set_uniform_float(rpShader->pMirror, rUniformName, rValue);
+	}
 }
 
 inline void set_uniform_int(Shader* rpShader, const char* rUniformName, int rValue)
 {
-	glUniform1i(glGetUniformLocation(rpShader->ShaderProgram, rUniformName), rValue);
+	glProgramUniform1i(rpShader->ShaderProgram, shader_find_uniform(rpShader, rUniformName), rValue);
+	if (rpShader->pMirror != nullptr)
+	{
+		set_uniform_int(rpShader->pMirror, rUniformName, rValue);
+	}
 }
 
+inline void set_uniform_mat4(Shader* rpShader, const char* rUniformName, const glm::mat4x4& rValue)
+{
+	glProgramUniformMatrix4fv(rpShader->ShaderProgram, shader_find_uniform(rpShader, rUniformName), 1, GL_FALSE, glm::value_ptr(rValue));
+	if (rpShader->pMirror != nullptr)
+	{
+		set_uniform_mat4(rpShader->pMirror, rUniformName, rValue);
+	}
+}
+
+// Same helpers through a handle resolved with shader_get_uniform
+
+void set_uniform_vec2(const ShaderUniform& rUniform, glm::vec2 rValue);
+void set_uniform_vec3(const ShaderUniform& rUniform, glm::vec3 rValue);
+void set_uniform_vec4(const ShaderUniform& rUniform, glm::vec4 rValue);
+void set_uniform_float(const ShaderUniform& rUniform, float rValue);
+void set_uniform_int(const ShaderUniform& rUniform, int rValue);
+void set_uniform_mat4(const ShaderUniform& rUniform, const glm::mat4x4& rValue);
 
 inline void shader_set_model_matrix(Shader* rpShader, glm::mat4x4 rMatrix)
 {
@@ -0,0 +1,132 @@
+#include "shader_variants.h"
+
+#include <iostream>
+#include <algorithm>
+#include "../gpu_timer.h"
+
+static void _switch_program(ShaderVariants* rpVariants, unsigned long long rHash, unsigned int rProgram)
+{
+	if (rpVariants->ActiveHash == rHash)
+	{
+		return;
+	}
+
+	shader_copy_uniforms(rpVariants->pShader->ShaderProgram, rProgram);
+	shader_set_program(rpVariants->pShader, rProgram);
+	rpVariants->ActiveHash = rHash;
+}
+
+void shader_variants_init(ShaderVariants* rpVariants, Shader* rpShader, const char* rVertexShaderFile, const char* rFragmentShaderFile,
+	const std::vector<ShaderDefine>& rBaseDefines)
+{
+	rpVariants->pShader = rpShader;
+	rpVariants->VertexPath = rVertexShaderFile;
+	rpVariants->FragmentPath = rFragmentShaderFile;
+	rpVariants->BaseDefines = rBaseDefines;
+	rpVariants->Programs.clear();
+
+	rpVariants->GenericHash = shader_hash_defines({});
+	rpVariants->ActiveHash = rpVariants->GenericHash;
+	rpVariants->Programs[rpVariants->GenericHash] = rpShader->ShaderProgram;
+}
+
+void shader_variants_release(ShaderVariants* rpVariants)
+{
+	unsigned int activeProgram = rpVariants->pShader ? rpVariants->pShader->ShaderProgram : 0;
+	for (auto& [hash, program] : rpVariants->Programs)
+	{
+		if (program != 0 && program != activeProgram)
+		{
+			shader_delete_program(program);
+		}
+	}
+	rpVariants->Programs.clear();
+}
+
+void shader_variants_select(ShaderVariants* rpVariants, const std::vector<ShaderDefine>& rDefines)
+{
+	unsigned long long hash = shader_hash_defines(rDefines);
+	if (hash == rpVariants->ActiveHash)
+	{
+		return;
+	}
+
+	auto found = rpVariants->Programs.find(hash);
+	if (found == rpVariants->Programs.end())
+	{
+		std::vector<ShaderDefine> defines = rpVariants->BaseDefines;
+		defines.insert(defines.end(), rDefines.begin(), rDefines.end());
+
+		Shader variant;
+		create_shader(&variant, rpVariants->VertexPath.c_str(), rpVariants->FragmentPath.c_str(), defines);
+
+		int linked = 0;
+		glGetProgramiv(variant.ShaderProgram, GL_LINK_STATUS, &linked);
+		if (!linked)
+		{
+			// Remembered as 0 so it is not compiled again, the generic variant is used instead
+			std::cout << "SHADER::VARIANTS - " << rpVariants->FragmentPath << " failed to link a variant, using the generic one" << std::endl;
+			shader_delete_program(variant.ShaderProgram);
+			variant.ShaderProgram = 0;
+		}
+		found = rpVariants->Programs.emplace(hash, variant.ShaderProgram).first;
+	}
+
+	if (found->second == 0)
+	{
+		_switch_program(rpVariants, rpVariants->GenericHash, rpVariants->Programs[rpVariants->GenericHash]);
+		return;
+	}
+	_switch_program(rpVariants, hash, found->second);
+}
+
+bool shader_variants_is_generic(const ShaderVariants* rpVariants)
+{
+	return rpVariants->ActiveHash == rpVariants->GenericHash;
+}
+
+void shader_variants_benchmark(ShaderVariants* rpVariants, const std::vector<ShaderDefine>& rDefines, unsigned int rFrameCount,
+	const std::function<void()>& rRenderFrame)
+{
+	const unsigned long long previousHash = rpVariants->ActiveHash;
+	const unsigned int previousProgram = rpVariants->pShader->ShaderProgram;
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	std::cout << "SHADER::VARIANTS::BENCHMARK - " << rpVariants->FragmentPath << ", " << viewport[2] << "x" << viewport[3] << ", "
+		<< rFrameCount << " frames per variant" << std::endl;
+	for (const ShaderDefine& define : rDefines)
+	{
+		std::cout << "  " << define.Name << " " << define.Value << std::endl;
+	}
+
+	GpuTimer timer = create_gpu_timer();
+	double variantMs[2] = {};
+	const char* variantNames[2] = { "generic", "specialized" };
+	for (int variant = 0; variant < 2; variant++)
+	{
+		shader_variants_select(rpVariants, variant == 0 ? std::vector<ShaderDefine>() : rDefines);
+
+		// Not measured, lets the driver settle after the program change
+		rRenderFrame();
+
+		double gpuMs = 0.0;
+		for (unsigned int i = 0; i < rFrameCount; i++)
+		{
+			gpu_timer_begin(&timer);
+			rRenderFrame();
+			gpu_timer_end(&timer);
+			gpuMs += gpu_timer_get_ms(&timer);
+		}
+		variantMs[variant] = gpuMs / std::max(rFrameCount, 1u);
+		std::cout << "  " << variantNames[variant] << ": " << variantMs[variant] << " ms GPU" << std::endl;
+	}
+	release_gpu_timer(timer);
+
+	if (variantMs[1] > 0.0)
+	{
+		std::cout << "  speedup: " << variantMs[0] / variantMs[1] << "x" << std::endl;
+	}
+
+	_switch_program(rpVariants, previousHash, previousProgram);
+}
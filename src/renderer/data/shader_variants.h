@@ -0,0 +1,50 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include "shader.h"
+
+// Specialized variants of one shader, compiled on demand from a define set and kept by its hash. The selected
+// variant is swapped into the Shader in place, so materials and pointers to it keep working. Uniform values
+// live in each program, so the ones of the previous program are copied to the new one on every switch.
+
+typedef struct
+{
+	Shader* pShader;
+	std::string VertexPath;
+	std::string FragmentPath;
+	// Added before the defines of every variant. The Shader must have been created with them, it is the generic variant
+	std::vector<ShaderDefine> BaseDefines;
+
+	// Linked programs by shader_hash_defines. The generic one is the program the Shader was created with
+	std::unordered_map<unsigned long long, unsigned int> Programs;
+	unsigned long long GenericHash;
+	unsigned long long ActiveHash;
+} ShaderVariants;
+
+void shader_variants_init(ShaderVariants* rpVariants, Shader* rpShader, const char* rVertexShaderFile, const char* rFragmentShaderFile,
+	const std::vector<ShaderDefine>& rBaseDefines = {});
+
+/// <summary>
+/// Deletes every variant program except the active one, which stays owned by the Shader
+/// </summary>
+void shader_variants_release(ShaderVariants* rpVariants);
+
+/// <summary>
+/// Makes the Shader use the variant of rDefines, compiling it the first time. The empty set is the generic variant
+/// </summary>
+void shader_variants_select(ShaderVariants* rpVariants, const std::vector<ShaderDefine>& rDefines);
+
+bool shader_variants_is_generic(const ShaderVariants* rpVariants);
+
+/// <summary>
+/// Renders rFrameCount frames with the generic variant and with the one of rDefines, printing the GPU time of both.
+/// The active variant is restored after. rRenderFrame must draw a full frame without swapping buffers
+/// </summary>
+void shader_variants_benchmark(ShaderVariants* rpVariants, const std::vector<ShaderDefine>& rDefines, unsigned int rFrameCount,
+	const std::function<void()>& rRenderFrame);
+
+#endif // !SHADER_VARIANTS_H
@@ -10,7 +10,7 @@ void create_texture(Texture* rpTexture, const char* rPath)
 	unsigned int textureId;
 	glGenTextures(1, &textureId);
 
-	glBindTexture(GL_TEXTURE_2D, textureId);
+	gl_state_bind_texture(0, GL_TEXTURE_2D, textureId);
 
 	// Set wrapping and filtering options
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -46,7 +46,7 @@ void create_texture(Texture* rpTexture, const char* rPath)
 	rpTexture->Height = height;
 	rpTexture->Texture = textureId;
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
 }
 
 void create_texture(Texture* rpTexture, int n_channels, int width, int height)
@@ -54,7 +54,7 @@ void create_texture(Texture* rpTexture, int n_channels, int width, int height)
 	unsigned int textureId;
 	glGenTextures(1, &textureId);
 
-	glBindTexture(GL_TEXTURE_2D, textureId);
+	gl_state_bind_texture(0, GL_TEXTURE_2D, textureId);
 
 	// Set wrapping and filtering options
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -73,11 +73,12 @@ void create_texture(Texture* rpTexture, int n_channels, int width, int height)
 	rpTexture->Width = width;
 	rpTexture->Height = height;
 	rpTexture->Texture = textureId;
-	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
 }
 
 void release_texture(Texture* pTexture)
 {
+	gl_state_forget_texture(pTexture->Texture);
 	glDeleteTextures(1, &pTexture->Texture);
 }
 
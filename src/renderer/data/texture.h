@@ -2,6 +2,7 @@
 #define TEXTURE_H
 
 #include <glad/glad.h>
+#include "../gl_state_cache.h"
 
 typedef struct
 {
@@ -20,9 +21,9 @@ void create_texture(Texture* rpTexture, const char* rPath);
 
 void create_texture(Texture* rpTexture, int n_channels, int width, int height);
 
-inline void use_texture(Texture* rpTexture)
+inline void use_texture(Texture* rpTexture, unsigned int rUnit = 0)
 {
-	glBindTexture(GL_TEXTURE_2D, rpTexture->Texture);
+	gl_state_bind_texture(rUnit, GL_TEXTURE_2D, rpTexture->Texture);
 }
 
 void release_texture(Texture* pTexture);
@@ -0,0 +1,246 @@
+#include "gl_state_cache.h"
+
+static GLStateCache s_State = {};
+static GLStateStats s_Stats = {};
+
+// Counts the call and tells if it has to be issued
+static bool _changes(bool rChanges)
+{
+	if (rChanges || !s_State.Valid)
+	{
+		s_Stats.Issued++;
+		return true;
+	}
+	s_Stats.Skipped++;
+	return false;
+}
+
+static int _get_target_index(GLenum rTarget)
+{
+	switch (rTarget)
+	{
+	case GL_TEXTURE_2D:
+		return (int)GLTextureTarget::Texture2D;
+	case GL_TEXTURE_CUBE_MAP:
+		return (int)GLTextureTarget::TextureCubeMap;
+	case GL_TEXTURE_2D_ARRAY:
+		return (int)GLTextureTarget::Texture2DArray;
+	default:
+		return -1;
+	}
+}
+
+static void _set_capability(GLenum rCapability, bool rEnabled)
+{
+	if (rEnabled)
+	{
+		glEnable(rCapability);
+	}
+	else
+	{
+		glDisable(rCapability);
+	}
+}
+
+void gl_state_init()
+{
+	s_State.Valid = false;
+	gl_state_use_program(0);
+	gl_state_bind_vertex_array(0);
+	gl_state_bind_framebuffer(0);
+	const GLenum targets[] = { GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY };
+	for (unsigned int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+	{
+		for (GLenum target : targets)
+		{
+			gl_state_bind_texture(unit, target, 0);
+		}
+	}
+	gl_state_set_depth_test(true);
+	gl_state_set_depth_write(true);
+	gl_state_set_depth_func(GL_LESS);
+	gl_state_set_color_write(true);
+	gl_state_set_cull_face(true, GL_BACK);
+	gl_state_set_blend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// Unit 0 is the one left active, like the GL default
+	gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+	s_State.Valid = true;
+	s_Stats = {};
+}
+
+void gl_state_invalidate()
+{
+	s_State.Valid = false;
+}
+
+void gl_state_use_program(unsigned int rProgram)
+{
+	if (_changes(s_State.Program != rProgram))
+	{
+		glUseProgram(rProgram);
+		s_State.Program = rProgram;
+	}
+}
+
+void gl_state_bind_vertex_array(unsigned int rVertexArray)
+{
+	if (_changes(s_State.VertexArray != rVertexArray))
+	{
+		glBindVertexArray(rVertexArray);
+		s_State.VertexArray = rVertexArray;
+	}
+}
+
+void gl_state_bind_framebuffer(unsigned int rFramebuffer)
+{
+	if (_changes(s_State.Framebuffer != rFramebuffer))
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, rFramebuffer);
+		s_State.Framebuffer = rFramebuffer;
+	}
+}
+
+void gl_state_bind_texture(unsigned int rUnit, GLenum rTarget, unsigned int rTexture)
+{
+	int target = _get_target_index(rTarget);
+	bool tracked = target >= 0 && rUnit < GL_STATE_TEXTURE_UNITS;
+	if (tracked && !_changes(s_State.Textures[rUnit][target] != rTexture))
+	{
+		return;
+	}
+
+	if (_changes(s_State.ActiveTextureUnit != rUnit))
+	{
+		glActiveTexture(GL_TEXTURE0 + rUnit);
+		s_State.ActiveTextureUnit = rUnit;
+	}
+	glBindTexture(rTarget, rTexture);
+	if (tracked)
+	{
+		s_State.Textures[rUnit][target] = rTexture;
+	}
+	else
+	{
+		s_Stats.Issued++;
+	}
+}
+
+void gl_state_set_depth_test(bool rEnabled)
+{
+	if (_changes(s_State.DepthTest != rEnabled))
+	{
+		_set_capability(GL_DEPTH_TEST, rEnabled);
+		s_State.DepthTest = rEnabled;
+	}
+}
+
+void gl_state_set_depth_write(bool rEnabled)
+{
+	if (_changes(s_State.DepthWrite != rEnabled))
+	{
+		glDepthMask(rEnabled ? GL_TRUE : GL_FALSE);
+		s_State.DepthWrite = rEnabled;
+	}
+}
+
+void gl_state_set_depth_func(GLenum rFunc)
+{
+	if (_changes(s_State.DepthFunc != rFunc))
+	{
+		glDepthFunc(rFunc);
+		s_State.DepthFunc = rFunc;
+	}
+}
+
+void gl_state_set_color_write(bool rEnabled)
+{
+	if (_changes(s_State.ColorWrite != rEnabled))
+	{
+		GLboolean mask = rEnabled ? GL_TRUE : GL_FALSE;
+		glColorMask(mask, mask, mask, mask);
+		s_State.ColorWrite = rEnabled;
+	}
+}
+
+void gl_state_set_cull_face(bool rEnabled, GLenum rMode)
+{
+	if (_changes(s_State.CullFace != rEnabled))
+	{
+		_set_capability(GL_CULL_FACE, rEnabled);
+		s_State.CullFace = rEnabled;
+	}
+	if (rEnabled && _changes(s_State.CullFaceMode != rMode))
+	{
+		glCullFace(rMode);
+		s_State.CullFaceMode = rMode;
+	}
+}
+
+void gl_state_set_blend(bool rEnabled, GLenum rSource, GLenum rDestination)
+{
+	if (_changes(s_State.Blend != rEnabled))
+	{
+		_set_capability(GL_BLEND, rEnabled);
+		s_State.Blend = rEnabled;
+	}
+	if (rEnabled && _changes(s_State.BlendSource != rSource || s_State.BlendDestination != rDestination))
+	{
+		glBlendFunc(rSource, rDestination);
+		s_State.BlendSource = rSource;
+		s_State.BlendDestination = rDestination;
+	}
+}
+
+void gl_state_forget_program(unsigned int rProgram)
+{
+	if (s_State.Program == rProgram)
+	{
+		s_State.Program = 0;
+	}
+}
+
+void gl_state_forget_vertex_array(unsigned int rVertexArray)
+{
+	if (s_State.VertexArray == rVertexArray)
+	{
+		s_State.VertexArray = 0;
+	}
+}
+
+void gl_state_forget_framebuffer(unsigned int rFramebuffer)
+{
+	if (s_State.Framebuffer == rFramebuffer)
+	{
+		s_State.Framebuffer = 0;
+	}
+}
+
+void gl_state_forget_texture(unsigned int rTexture)
+{
+	for (unsigned int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+	{
+		for (unsigned int& texture : s_State.Textures[unit])
+		{
+			if (texture == rTexture)
+			{
+				texture = 0;
+			}
+		}
+	}
+}
+
+const GLStateCache& gl_state_get()
+{
+	return s_State;
+}
+
+GLStateStats gl_state_get_stats()
+{
+	return s_Stats;
+}
+
+void gl_state_reset_stats()
+{
+	s_Stats = {};
+}
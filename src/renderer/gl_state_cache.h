@@ -0,0 +1,98 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+// Shadow copy of the GL state the renderer changes. Every bind and state change goes through here and the
+// calls that would set the current value again are skipped. Code that binds behind its back must call
+// gl_state_invalidate. Deleting a bound object unbinds it in GL, the gl_state_forget_* functions do the same here.
+// Dear ImGui saves and restores the state it touches, so the cache stays valid across its draws.
+
+// Texture units tracked, binds to higher units are always issued
+#define GL_STATE_TEXTURE_UNITS 16
+
+// Tracked texture targets, other targets are always issued
+enum class GLTextureTarget
+{
+	Texture2D = 0,
+	TextureCubeMap,
+	Texture2DArray,
+	Count
+};
+
+typedef struct
+{
+	unsigned int Program;
+	unsigned int VertexArray;
+	unsigned int Framebuffer;
+
+	unsigned int ActiveTextureUnit;
+	unsigned int Textures[GL_STATE_TEXTURE_UNITS][(int)GLTextureTarget::Count];
+
+	bool DepthTest;
+	bool DepthWrite;
+	GLenum DepthFunc;
+
+	bool ColorWrite;
+
+	bool CullFace;
+	GLenum CullFaceMode;
+
+	bool Blend;
+	GLenum BlendSource;
+	GLenum BlendDestination;
+
+	// False until gl_state_init or after gl_state_invalidate, every call is issued then
+	bool Valid;
+} GLStateCache;
+
+// Calls since the last gl_state_reset_stats
+typedef struct
+{
+	unsigned int Issued;
+	unsigned int Skipped;
+} GLStateStats;
+
+/// <summary>
+/// Sets the default state (depth test with GL_LESS, alpha blending, back face culling) and starts tracking it
+/// </summary>
+void gl_state_init();
+
+/// <summary>
+/// Forgets every tracked value, the next call of each kind is issued
+/// </summary>
+void gl_state_invalidate();
+
+void gl_state_use_program(unsigned int rProgram);
+void gl_state_bind_vertex_array(unsigned int rVertexArray);
+void gl_state_bind_framebuffer(unsigned int rFramebuffer);
+
+/// <summary>
+/// Binds rTexture to rTarget of texture unit rUnit, selecting the unit only if needed
+/// </summary>
+void gl_state_bind_texture(unsigned int rUnit, GLenum rTarget, unsigned int rTexture);
+
+void gl_state_set_depth_test(bool rEnabled);
+void gl_state_set_depth_write(bool rEnabled);
+void gl_state_set_depth_func(GLenum rFunc);
+void gl_state_set_color_write(bool rEnabled);
+
+/// <summary>
+/// Enables culling of rMode faces (GL_BACK, GL_FRONT, GL_FRONT_AND_BACK) or disables culling
+/// </summary>
+void gl_state_set_cull_face(bool rEnabled, GLenum rMode = GL_BACK);
+
+void gl_state_set_blend(bool rEnabled, GLenum rSource = GL_SRC_ALPHA, GLenum rDestination = GL_ONE_MINUS_SRC_ALPHA);
+
+// Deleted objects are unbound by GL, their names can be reused by the next object created
+void gl_state_forget_program(unsigned int rProgram);
+void gl_state_forget_vertex_array(unsigned int rVertexArray);
+void gl_state_forget_framebuffer(unsigned int rFramebuffer);
+void gl_state_forget_texture(unsigned int rTexture);
+
+const GLStateCache& gl_state_get();
+
+GLStateStats gl_state_get_stats();
+void gl_state_reset_stats();
+
+#endif // !GL_STATE_CACHE_H
@@ -0,0 +1,40 @@
+#include "gpu_timer.h"
+
+GpuTimer create_gpu_timer()
+{
+    GpuTimer timer{};
+    glGenQueries(1, &timer.Query);
+    timer.Running = false;
+    return timer;
+}
+
+void gpu_timer_begin(GpuTimer* rp_timer)
+{
+    glBeginQuery(GL_TIME_ELAPSED, rp_timer->Query);
+    rp_timer->Running = true;
+}
+
+void gpu_timer_end(GpuTimer* rp_timer)
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    rp_timer->Running = false;
+}
+
+double gpu_timer_get_ms(GpuTimer* rp_timer)
+{
+    if (rp_timer->Running)
+    {
+        gpu_timer_end(rp_timer);
+    }
+
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(rp_timer->Query, GL_QUERY_RESULT, &nanoseconds);
+    return (double)nanoseconds / 1e6;
+}
+
+void release_gpu_timer(GpuTimer& r_timer)
+{
+    glDeleteQueries(1, &r_timer.Query);
+    r_timer.Query = 0;
+    r_timer.Running = false;
+}
@@ -0,0 +1,32 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+// GL_TIME_ELAPSED query around a block of GL commands. Meant for benchmarks:
+// reading the result waits until the GPU has finished the block.
+
+typedef struct
+{
+	unsigned int Query;
+	bool Running;
+} GpuTimer;
+
+GpuTimer create_gpu_timer();
+
+void gpu_timer_begin(GpuTimer* rp_timer);
+void gpu_timer_end(GpuTimer* rp_timer);
+
+/// <summary>
+/// Waits for the result of the last begin/end block
+/// </summary>
+/// <returns>GPU time in milliseconds</returns>
+double gpu_timer_get_ms(GpuTimer* rp_timer);
+
+/// <summary>
+/// Deletes the query
+/// </summary>
+/// <param name="r_timer">Timer to delete. Its Query will be set to 0</param>
+void release_gpu_timer(GpuTimer& r_timer);
+
+#endif // !GPU_TIMER_H
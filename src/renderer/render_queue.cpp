@@ -0,0 +1,92 @@
+#include "render_queue.h"
+#include <algorithm>
+#include <cstring>
+
+#define RENDER_QUEUE_PROGRAM_BITS 12
+#define RENDER_QUEUE_MATERIAL_BITS 16
+#define RENDER_QUEUE_DEPTH_BITS 32
+
+unsigned long long render_queue_make_key(RenderPass rPass, unsigned int rProgram, unsigned int rMaterial, float rDepth)
+{
+	// The bits of a positive float grow with its value, they sort like the float itself
+	float depth = rDepth > 0.0f ? rDepth : 0.0f;
+	unsigned int depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	unsigned long long key = (unsigned long long)rPass;
+	key = (key << RENDER_QUEUE_PROGRAM_BITS) | (rProgram & ((1u << RENDER_QUEUE_PROGRAM_BITS) - 1));
+	key = (key << RENDER_QUEUE_MATERIAL_BITS) | (rMaterial & ((1u << RENDER_QUEUE_MATERIAL_BITS) - 1));
+	key = (key << RENDER_QUEUE_DEPTH_BITS) | depthBits;
+	return key;
+}
+
+void render_queue_clear(RenderQueue* rpQueue)
+{
+	rpQueue->Packets.clear();
+	rpQueue->Transforms.clear();
+	rpQueue->Instances.clear();
+	rpQueue->Batches.clear();
+	rpQueue->BatchLookup.clear();
+}
+
+unsigned int render_queue_add_transform(RenderQueue* rpQueue, const glm::mat4x4& rTransform)
+{
+	rpQueue->Transforms.push_back(rTransform);
+	return (unsigned int)rpQueue->Transforms.size() - 1;
+}
+
+void render_queue_add(RenderQueue* rpQueue, const DrawPacket& rPacket)
+{
+	rpQueue->Packets.push_back(rPacket);
+}
+
+unsigned int render_queue_get_batch(RenderQueue* rpQueue, const Mesh* rpMesh, unsigned int rSubmeshIndex, MaterialHandle rMaterial, bool* rpCreated)
+{
+	auto inserted = rpQueue->BatchLookup.emplace(std::make_tuple(rpMesh, rSubmeshIndex, rMaterial.Id), (unsigned int)rpQueue->Batches.size());
+	*rpCreated = inserted.second;
+	if (inserted.second)
+	{
+		rpQueue->Batches.push_back({ rpMesh, 0, 0, 0.0f });
+	}
+	return inserted.first->second;
+}
+
+void render_queue_add_instance(RenderQueue* rpQueue, unsigned int rBatch, unsigned int rTransformIndex, float rDepth)
+{
+	rpQueue->Instances.push_back({ rBatch, rTransformIndex, rDepth });
+}
+
+void render_queue_sort(RenderQueue* rpQueue)
+{
+	std::sort(rpQueue->Instances.begin(), rpQueue->Instances.end(), [](const RenderInstance& a, const RenderInstance& b)
+		{
+			return a.Batch != b.Batch ? a.Batch < b.Batch : a.Depth < b.Depth;
+		});
+
+	for (unsigned int i = 0; i < rpQueue->Instances.size(); i++)
+	{
+		RenderBatch& batch = rpQueue->Batches[rpQueue->Instances[i].Batch];
+		if (batch.InstanceCount == 0)
+		{
+			batch.FirstInstance = i;
+			batch.Depth = rpQueue->Instances[i].Depth;
+		}
+		batch.InstanceCount++;
+	}
+
+	// Batches are keyed by their nearest instance, known only now
+	const unsigned long long depthMask = (1ull << RENDER_QUEUE_DEPTH_BITS) - 1;
+	for (DrawPacket& packet : rpQueue->Packets)
+	{
+		if (packet.Batch != RENDER_QUEUE_NO_BATCH)
+		{
+			unsigned long long depthKey = render_queue_make_key(RenderPass::DepthPrepass, 0, 0, rpQueue->Batches[packet.Batch].Depth);
+			packet.SortKey = (packet.SortKey & ~depthMask) | depthKey;
+		}
+	}
+
+	std::sort(rpQueue->Packets.begin(), rpQueue->Packets.end(), [](const DrawPacket& a, const DrawPacket& b)
+		{
+			return a.SortKey < b.SortKey;
+		});
+}
@@ -0,0 +1,104 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include "data/mesh.h"
+#include "data/material.h"
+
+// Draws of one camera, collected while the scene is walked and submitted once sorted.
+// The sort key packs, from the most significant bits:
+//   pass (4 bits) | shader program (12 bits) | material (16 bits) | view depth (32 bits)
+// so passes come in order, state changes are grouped and draws sharing a state go front to back.
+// Program and material ids are masked, ids colliding only change the order, never the result.
+// Draws of an instanced shader sharing a mesh, submesh and material form a batch drawn once for all its instances.
+// Its instances are stored front to back and the batch is sorted at the depth of the nearest one.
+
+// Batch of a packet that is not instanced
+#define RENDER_QUEUE_NO_BATCH UINT32_MAX
+
+// Passes in submission order. The depth pre-pass lays the depth of the draws that have a depth shader so
+// their color pass only shades visible fragments. The sky is drawn last so early-Z rejects the pixels covered by geometry
+enum class RenderPass
+{
+	DepthPrepass = 0,
+	Opaque,
+	Sky
+};
+
+typedef struct
+{
+	unsigned long long SortKey;
+	RenderPass Pass;
+
+	Mesh* pMesh;
+	unsigned int SubmeshIndex;
+	MaterialHandle Material;
+	// Index in RenderQueue::Transforms, shared by the submeshes of a mesh. Unused by batched packets
+	unsigned int TransformIndex;
+	// Index in RenderQueue::Batches or RENDER_QUEUE_NO_BATCH
+	unsigned int Batch;
+
+	// Shader of the depth pre-pass draw. In the opaque pass, set when the pre-pass already wrote the depth of the draw
+	Shader* pDepthShader;
+} DrawPacket;
+
+typedef struct
+{
+	unsigned int Batch;
+	unsigned int TransformIndex;
+	float Depth;
+} RenderInstance;
+
+typedef struct
+{
+	const Mesh* pMesh;
+	// Range of RenderQueue::Instances, set by render_queue_sort
+	unsigned int FirstInstance;
+	unsigned int InstanceCount;
+	// Depth of the nearest instance
+	float Depth;
+} RenderBatch;
+
+typedef struct
+{
+	std::vector<DrawPacket> Packets;
+	std::vector<glm::mat4x4> Transforms;
+
+	std::vector<RenderInstance> Instances;
+	std::vector<RenderBatch> Batches;
+	// Batch of a mesh, submesh and material id
+	std::map<std::tuple<const Mesh*, unsigned int, unsigned int>, unsigned int> BatchLookup;
+} RenderQueue;
+
+/// <summary>
+/// Packs the sort key of a draw. rDepth is the view space distance, negative values are clamped to 0
+/// </summary>
+unsigned long long render_queue_make_key(RenderPass rPass, unsigned int rProgram, unsigned int rMaterial, float rDepth);
+
+/// <summary>
+/// Empties the queue, keeping its memory for the next camera
+/// </summary>
+void render_queue_clear(RenderQueue* rpQueue);
+
+unsigned int render_queue_add_transform(RenderQueue* rpQueue, const glm::mat4x4& rTransform);
+void render_queue_add(RenderQueue* rpQueue, const DrawPacket& rPacket);
+
+/// <summary>
+/// Batch of the draws of rpMesh's submesh rSubmeshIndex with rMaterial. rpCreated tells if it did not exist yet,
+/// its packets must then be added with the batch index
+/// </summary>
+unsigned int render_queue_get_batch(RenderQueue* rpQueue, const Mesh* rpMesh, unsigned int rSubmeshIndex, MaterialHandle rMaterial, bool* rpCreated);
+
+void render_queue_add_instance(RenderQueue* rpQueue, unsigned int rBatch, unsigned int rTransformIndex, float rDepth);
+
+/// <summary>
+/// Orders the instances of each batch front to back, sets the batch ranges and depths, then orders the packets
+/// by increasing sort key
+/// </summary>
+void render_queue_sort(RenderQueue* rpQueue);
+
+#endif // !RENDER_QUEUE_H
@@ -4,6 +4,7 @@
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include "data/mesh.h"
+#include "gl_state_cache.h"
 
 static RenderData _RenderData{};
 
@@ -19,13 +20,11 @@ void renderer_init_opengl()
 	glDebugMessageCallback(gl_debug_message_callback, NULL);
 #endif
 
-	glEnable(GL_DEPTH_TEST);
+	// Depth test, alpha blending and back face culling
+	gl_state_init();
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
+	// Strips are split by the largest index of their type, never reached by the triangle lists
+	glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
 
 	window_set_viewport_change_callback(renderer_change_viewport_callback);
 }
@@ -51,25 +50,22 @@ void renderer_set_face_culling_type(FaceCullingType type)
 	{
 		case FaceCullingType::NONE:
 		{
-			glDisable(GL_CULL_FACE);
+			gl_state_set_cull_face(false);
 		} break;
 
 		case FaceCullingType::FRONT:
 		{
-			glEnable(GL_CULL_FACE);
-			glCullFace(GL_FRONT);
+			gl_state_set_cull_face(true, GL_FRONT);
 		} break;
 
 		case FaceCullingType::BACK:
 		{
-			glEnable(GL_CULL_FACE);
-			glCullFace(GL_BACK);
+			gl_state_set_cull_face(true, GL_BACK);
 		} break;
 
 		case FaceCullingType::FRONT_AND_BACK:
 		{
-			glEnable(GL_CULL_FACE);
-			glCullFace(GL_FRONT_AND_BACK);
+			gl_state_set_cull_face(true, GL_FRONT_AND_BACK);
 		} break;
 
 		default:
@@ -97,11 +93,54 @@ void renderer_finish_render()
 
 void draw_indexed(const VertexArray& r_vao, const IndexBuffer& r_ibo, unsigned int r_indexCount, unsigned int r_startIndex)
 {
-	glBindVertexArray(r_vao.Id);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r_ibo.Id);
+	// The index buffer is part of the vertex array state (vao_add_ibo)
+	gl_state_bind_vertex_array(r_vao.Id);
 	glDrawElements(GL_TRIANGLES, r_indexCount, GL_UNSIGNED_INT, (void*)r_startIndex);
 }
 
+void draw_submesh(const Mesh& r_mesh, const Submesh& r_submesh)
+{
+	gl_state_bind_vertex_array(r_mesh.Vao.Id);
+	if (r_mesh.Ibo.Id == 0)
+	{
+		if (r_submesh.InstanceCount == 0)
+		{
+			glDrawArrays(r_mesh.PrimitiveType, r_submesh.StartIndex, r_submesh.IndexCount);
+		}
+		else
+		{
+			glDrawArraysInstanced(r_mesh.PrimitiveType, r_submesh.StartIndex, r_submesh.IndexCount, r_submesh.InstanceCount);
+		}
+		return;
+	}
+
+	size_t indexSize = r_mesh.IndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	const void* pOffset = (const void*)(mesh_get_index_byte_offset(r_mesh) + r_submesh.StartIndex * indexSize);
+	if (r_submesh.InstanceCount == 0)
+	{
+		glDrawElementsBaseVertex(r_mesh.PrimitiveType, r_submesh.IndexCount, r_mesh.IndexType, pOffset, mesh_get_base_vertex(r_mesh));
+	}
+	else
+	{
+		glDrawElementsInstancedBaseVertex(r_mesh.PrimitiveType, r_submesh.IndexCount, r_mesh.IndexType, pOffset, r_submesh.InstanceCount, mesh_get_base_vertex(r_mesh));
+	}
+}
+
+void draw_submesh_instances(const Mesh& r_mesh, const Submesh& r_submesh, unsigned int r_instanceCount, unsigned int r_baseInstance)
+{
+	gl_state_bind_vertex_array(r_mesh.Vao.Id);
+	if (r_mesh.Ibo.Id == 0)
+	{
+		glDrawArraysInstancedBaseInstance(r_mesh.PrimitiveType, r_submesh.StartIndex, r_submesh.IndexCount, r_instanceCount, r_baseInstance);
+		return;
+	}
+
+	size_t indexSize = r_mesh.IndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	const void* pOffset = (const void*)(mesh_get_index_byte_offset(r_mesh) + r_submesh.StartIndex * indexSize);
+	glDrawElementsInstancedBaseVertexBaseInstance(r_mesh.PrimitiveType, r_submesh.IndexCount, r_mesh.IndexType, pOffset,
+		r_instanceCount, mesh_get_base_vertex(r_mesh), r_baseInstance);
+}
+
 #if _DEBUG
 static void APIENTRY gl_debug_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
 {
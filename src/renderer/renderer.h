@@ -7,6 +7,7 @@
 
 #include "data/buffers/index_buffer.h"
 #include "data/buffers/vertex_array.h"
+#include "data/mesh.h"
 
 //#define WIREFRAME_MODE
 
@@ -44,6 +45,17 @@ void renderer_change_viewport_callback(int rWidth, int rHeight);
 
 void draw_indexed(const VertexArray& r_vao, const IndexBuffer& r_ibo, unsigned int r_indexCount, unsigned int r_startIndex);
 
+/// <summary>
+/// Draws one submesh with the index format and primitive of the mesh. Instanced if the submesh has instances,
+/// without indices if the mesh has no index buffer
+/// </summary>
+void draw_submesh(const Mesh& r_mesh, const Submesh& r_submesh);
+
+/// <summary>
+/// Draws r_instanceCount instances of one submesh, their VAO_INSTANCE_INDEX_LOCATION attribute starting at r_baseInstance
+/// </summary>
+void draw_submesh_instances(const Mesh& r_mesh, const Submesh& r_submesh, unsigned int r_instanceCount, unsigned int r_baseInstance);
+
 #if _DEBUG
 void APIENTRY gl_debug_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
 #endif
@@ -10,6 +10,14 @@
 #include "renderer.h"
 #include "../assets/public/assets_handler.h"
 #include "data/cubemap.h"
+#include "data/buffers/stream_buffer.h"
+#include "render_queue.h"
+#include "gpu_timer.h"
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <iostream>
 //#include "../assets/public/assets_handler.h"
 
 
@@ -22,20 +30,391 @@ static Mesh* sp_Skybox;
 
 static Scene* sp_CurrentScene;
 
+// Draws of the current camera, submitted by end_render
+static RenderQueue s_RenderQueue;
+
+// Depth pre-pass shaders by MaterialHandle::Id. Each one mirrors the uniform writes of its material shader
+static bool s_DepthPrepass = false;
+static std::unordered_map<unsigned int, Shader*> s_DepthShaders;
+
+// Same layouts as the std140 blocks of res/shaders/frame_data.glsl, lights.glsl and basic_material.glsl.
+// A vec3 takes 16 bytes unless a float follows it
+typedef struct
+{
+	glm::mat4x4 View;
+	glm::mat4x4 Projection;
+	glm::vec3 ViewPosition;
+	float Time;
+} SceneFrameData;
+
+typedef struct
+{
+	glm::vec3 AmbientColor;
+	float Padding0;
+	glm::vec3 DiffuseColor;
+	float Padding1;
+	glm::vec3 SpecularColor;
+	float Padding2;
+	glm::vec3 Direction;
+	float Padding3;
+} SceneDirectionalLightData;
+
+typedef struct
+{
+	glm::vec3 AmbientColor;
+	float Padding0;
+	glm::vec3 DiffuseColor;
+	float Padding1;
+	glm::vec3 SpecularColor;
+	float Padding2;
+	glm::vec3 Position;
+	float Constant;
+	float Linear;
+	float Quadratic;
+	float Padding3[2];
+} ScenePointLightData;
+
+typedef struct
+{
+	SceneDirectionalLightData DirectionalLight;
+	ScenePointLightData PointLight;
+} SceneLightData;
+
+typedef struct
+{
+	glm::vec3 Ambient;
+	float Padding0;
+	glm::vec3 Specular;
+	float Padding1;
+	glm::vec3 Diffuse;
+	float Shininess;
+} SceneMaterialData;
+
+static_assert(sizeof(SceneFrameData) == 144, "SceneFrameData must match the std140 FrameData block");
+static_assert(sizeof(SceneLightData) == 144, "SceneLightData must match the std140 LightData block");
+static_assert(sizeof(SceneMaterialData) == 48, "SceneMaterialData must match the std140 MaterialData block");
+
+// FrameData and LightData of every begin_render, one segment each
+static StreamBuffer s_FrameRing;
+static GLsizeiptr s_LightDataOffset;
+static bool s_FrameRingPending;
+
+// MaterialData of every material at s_MaterialStride * MaterialHandle::Id. s_Materials mirrors the GPU copy,
+// a slot is only uploaded when the material no longer matches it
+static unsigned int s_MaterialBuffer;
+static GLsizeiptr s_MaterialStride;
+static std::vector<SceneMaterialData> s_Materials;
+static std::vector<bool> s_MaterialUploaded;
+static unsigned int s_BoundMaterial;
+
+// Same layout as SceneInstance in transforms.glsl (std430)
+typedef struct
+{
+	glm::mat4x4 Model;
+	// w is 1 for quantized meshes
+	glm::vec4 PositionOffset;
+	glm::vec4 PositionScale;
+} SceneInstanceData;
+
+static_assert(sizeof(SceneInstanceData) == 96, "SceneInstanceData must match the std430 SceneInstance struct");
+
+// Instances of every end_render, front to back inside each batch.
+// Recreated twice as large when a camera has more instances than a segment holds
+#define SCENE_INSTANCE_INITIAL_CAPACITY 1024
+static StreamBuffer s_InstanceRing;
+static bool s_InstanceRingPending;
+
+// The bound range is one block, at most GL_MAX_SHADER_STORAGE_BLOCK_SIZE (16 MB at least, about 170k instances).
+// Past that the instances are bound by windows of s_MaxWindowInstances, starting on a multiple of
+// s_WindowAlignInstances so the offset meets GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT. Draws read their
+// BaseInstance relative to the bound window
+static unsigned int s_MaxWindowInstances;
+static unsigned int s_WindowAlignInstances;
+static GLintptr s_InstanceSegmentOffset;
+static unsigned int s_InstanceCount;
+static unsigned int s_BoundWindow;
+
+// Same layout as the commands read by glMultiDrawElementsIndirect
+typedef struct
+{
+	unsigned int Count;
+	unsigned int InstanceCount;
+	unsigned int FirstIndex;
+	int BaseVertex;
+	unsigned int BaseInstance;
+} SceneDrawCommand;
+
+// Batches of the same pass, material, heap page and index format follow each other once sorted, each run of them is
+// one glMultiDrawElementsIndirect. Other packets are runs of one drawn directly. The commands of every run of an
+// end_render are written at once in s_IndirectRing, grown like s_InstanceRing
+#define SCENE_INDIRECT_INITIAL_CAPACITY 256
+typedef struct
+{
+	unsigned int FirstPacket;
+	unsigned int PacketCount;
+	bool Indirect;
+	GLintptr CommandOffset;
+	// First instance of the window the commands of the run are relative to
+	unsigned int InstanceWindow;
+} SceneDrawRun;
+
+static StreamBuffer s_IndirectRing;
+static bool s_IndirectRingPending;
+static std::vector<SceneDrawRun> s_DrawRuns;
+static std::vector<SceneDrawCommand> s_DrawCommands;
+static SceneDrawStats s_DrawStats = {};
+
+// Uniforms still written per draw by each queued draw, resolved once per program
+typedef struct
+{
+	ShaderUniform QuantizedVertices;
+	ShaderUniform PositionOffset;
+	ShaderUniform PositionScale;
+	// SCENE_INSTANCED shaders (transforms.glsl) declare the InstanceData block, they are drawn in batches
+	bool Instanced;
+} SceneUniforms;
+
+// By program, a Shader switching variant gets the handles of its new program. Entries are dropped when
+// shader_delete_program deletes their program
+static std::unordered_map<unsigned int, SceneUniforms> s_SceneUniforms;
+
+static const SceneUniforms& _get_scene_uniforms(Shader* rpShader)
+{
+	auto found = s_SceneUniforms.find(rpShader->ShaderProgram);
+	if (found != s_SceneUniforms.end())
+	{
+		return found->second;
+	}
+
+	SceneUniforms& uniforms = s_SceneUniforms[rpShader->ShaderProgram];
+	uniforms.QuantizedVertices = shader_get_uniform(rpShader, "uQuantizedVertices");
+	uniforms.PositionOffset = shader_get_uniform(rpShader, "uPositionOffset");
+	uniforms.PositionScale = shader_get_uniform(rpShader, "uPositionScale");
+	uniforms.Instanced = glGetProgramResourceIndex(rpShader->ShaderProgram, GL_SHADER_STORAGE_BLOCK, "InstanceData") != GL_INVALID_INDEX;
+	return uniforms;
+}
+
+static GLsizeiptr _align_uniform_offset(GLsizeiptr rSize)
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	return (rSize + alignment - 1) / alignment * alignment;
+}
+
+static GLsizeiptr _align_storage_offset(GLsizeiptr rSize)
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	return (rSize + alignment - 1) / alignment * alignment;
+}
+
 void init_scene_renderer(Mesh *pSkybox)
 {
 	create_shader(&s_SkyboxShader, "res/shaders/skybox_shader.vert", "res/shaders/skybox_shader.frag");
-	
+
 	sp_Skybox = pSkybox;
+
+	s_LightDataOffset = _align_uniform_offset(sizeof(SceneFrameData));
+	s_FrameRing = create_stream_buffer(GL_UNIFORM_BUFFER, s_LightDataOffset + _align_uniform_offset(sizeof(SceneLightData)));
+	s_FrameRingPending = false;
+
+	s_InstanceRing = create_stream_buffer(GL_SHADER_STORAGE_BUFFER, _align_storage_offset(SCENE_INSTANCE_INITIAL_CAPACITY * sizeof(SceneInstanceData)));
+	s_InstanceRingPending = false;
+
+	GLint64 maxBlockSize = 0;
+	glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize);
+	s_MaxWindowInstances = (unsigned int)std::min<GLint64>(maxBlockSize / sizeof(SceneInstanceData), UINT32_MAX);
+	s_WindowAlignInstances = 1;
+	while (_align_storage_offset(s_WindowAlignInstances * sizeof(SceneInstanceData)) != s_WindowAlignInstances * sizeof(SceneInstanceData))
+	{
+		s_WindowAlignInstances++;
+	}
+	s_BoundWindow = UINT32_MAX;
+
+	s_IndirectRing = create_stream_buffer(GL_DRAW_INDIRECT_BUFFER, SCENE_INDIRECT_INITIAL_CAPACITY * sizeof(SceneDrawCommand));
+	s_IndirectRingPending = false;
+
+	s_MaterialStride = _align_uniform_offset(sizeof(SceneMaterialData));
+	s_MaterialBuffer = 0;
+	s_BoundMaterial = UINT32_MAX;
+
+	shader_add_program_deleted_callback([](unsigned int rProgram)
+	{
+		s_SceneUniforms.erase(rProgram);
+	});
+}
+
+static void _write_frame_data()
+{
+	// The draws that read the previous segment have been issued by now
+	if (s_FrameRingPending)
+	{
+		stream_buffer_fence(&s_FrameRing);
+	}
+
+	unsigned char* pSegment = (unsigned char*)stream_buffer_begin(&s_FrameRing);
+
+	SceneFrameData frame;
+	frame.View = s_ViewMatrix;
+	frame.Projection = s_ProjectionMatrix;
+	frame.ViewPosition = sp_Camera->Position;
+	frame.Time = (float)window_get_time_since_start();
+	memcpy(pSegment, &frame, sizeof(frame));
+
+	// Missing lights are left black
+	SceneLightData lights = {};
+	const LightEnvironment* pLights = &sp_CurrentScene->SceneRenderData.LightEnv;
+	if (pLights->p_DirectionalLight != nullptr)
+	{
+		const DirectionalLight* pLight = pLights->p_DirectionalLight;
+		lights.DirectionalLight.AmbientColor = pLight->AmbientColor;
+		lights.DirectionalLight.DiffuseColor = pLight->DiffuseColor;
+		lights.DirectionalLight.SpecularColor = pLight->SpecularColor;
+		lights.DirectionalLight.Direction = pLight->Direction;
+	}
+	if (pLights->p_PointLight != nullptr)
+	{
+		const PointLight* pLight = pLights->p_PointLight;
+		lights.PointLight.AmbientColor = pLight->AmbientColor;
+		lights.PointLight.DiffuseColor = pLight->DiffuseColor;
+		lights.PointLight.SpecularColor = pLight->SpecularColor;
+		lights.PointLight.Position = pLight->Position;
+		lights.PointLight.Constant = pLight->Constant;
+		lights.PointLight.Linear = pLight->Linear;
+		lights.PointLight.Quadratic = pLight->Quadratic;
+	}
+	memcpy(pSegment + s_LightDataOffset, &lights, sizeof(lights));
+
+	GLintptr offset = stream_buffer_end(&s_FrameRing);
+	glBindBufferRange(GL_UNIFORM_BUFFER, SCENE_FRAME_DATA_BINDING, s_FrameRing.Id, offset, sizeof(SceneFrameData));
+	glBindBufferRange(GL_UNIFORM_BUFFER, SCENE_LIGHT_DATA_BINDING, s_FrameRing.Id, offset + s_LightDataOffset, sizeof(SceneLightData));
+	s_FrameRingPending = true;
+}
+
+// First instance of the window holding rFirstInstance, 0 while every instance fits in one block
+static unsigned int _get_instance_window(unsigned int rFirstInstance)
+{
+	if (s_InstanceCount <= s_MaxWindowInstances)
+	{
+		return 0;
+	}
+	return rFirstInstance / s_WindowAlignInstances * s_WindowAlignInstances;
+}
+
+static void _bind_instance_window(unsigned int rWindow)
+{
+	if (rWindow == s_BoundWindow)
+	{
+		return;
+	}
+
+	unsigned int count = std::min(s_InstanceCount - rWindow, s_MaxWindowInstances);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, SCENE_INSTANCE_DATA_BINDING, s_InstanceRing.Id,
+		s_InstanceSegmentOffset + (GLintptr)rWindow * sizeof(SceneInstanceData), (GLsizeiptr)count * sizeof(SceneInstanceData));
+	s_BoundWindow = rWindow;
+}
+
+static void _write_instance_data()
+{
+	const std::vector<RenderInstance>& instances = s_RenderQueue.Instances;
+	if (instances.empty())
+	{
+		return;
+	}
+
+	// The draws that read the previous segment have been issued by now
+	if (s_InstanceRingPending)
+	{
+		stream_buffer_fence(&s_InstanceRing);
+		s_InstanceRingPending = false;
+	}
+
+	GLsizeiptr size = instances.size() * sizeof(SceneInstanceData);
+	if (size > s_InstanceRing.SegmentSize)
+	{
+		release_stream_buffer(s_InstanceRing);
+		s_InstanceRing = create_stream_buffer(GL_SHADER_STORAGE_BUFFER, _align_storage_offset(size * 2));
+	}
+	// aInstanceIndex must reach the last instance
+	vao_reserve_instance_indices((unsigned int)instances.size());
+
+	SceneInstanceData* pInstances = (SceneInstanceData*)stream_buffer_begin(&s_InstanceRing);
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		const Mesh* pMesh = s_RenderQueue.Batches[instances[i].Batch].pMesh;
+		SceneInstanceData& instance = pInstances[i];
+		instance.Model = s_RenderQueue.Transforms[instances[i].TransformIndex];
+		instance.PositionOffset = glm::vec4(pMesh->PositionOffset, pMesh->Quantized ? 1.0f : 0.0f);
+		instance.PositionScale = glm::vec4(pMesh->PositionScale, 0.0f);
+	}
+
+	s_InstanceSegmentOffset = stream_buffer_end(&s_InstanceRing);
+	s_InstanceCount = (unsigned int)instances.size();
+	s_BoundWindow = UINT32_MAX;
+	_bind_instance_window(0);
+	s_InstanceRingPending = true;
+}
+
+// Grows the buffer to hold rSlot. Every slot is uploaded again on its next use
+static void _reserve_material_slot(unsigned int rSlot)
+{
+	if (rSlot < s_Materials.size())
+	{
+		return;
+	}
+
+	size_t capacity = std::max<size_t>(16, s_Materials.size());
+	while (capacity <= rSlot)
+	{
+		capacity *= 2;
+	}
+	s_Materials.resize(capacity);
+	s_MaterialUploaded.assign(capacity, false);
+
+	if (s_MaterialBuffer != 0)
+	{
+		glDeleteBuffers(1, &s_MaterialBuffer);
+	}
+	glGenBuffers(1, &s_MaterialBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, s_MaterialBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, s_MaterialStride * capacity, nullptr, GL_DYNAMIC_DRAW);
+	s_BoundMaterial = UINT32_MAX;
+}
+
+static void _use_material(MaterialHandle rHandle, const Material& rMaterial)
+{
+	_reserve_material_slot(rHandle.Id);
+
+	SceneMaterialData data = {};
+	data.Ambient = rMaterial.Ambient;
+	data.Specular = rMaterial.Specular;
+	data.Diffuse = rMaterial.Diffuse;
+	data.Shininess = rMaterial.Shininess;
+
+	GLintptr offset = s_MaterialStride * rHandle.Id;
+	if (!s_MaterialUploaded[rHandle.Id] || memcmp(&s_Materials[rHandle.Id], &data, sizeof(data)) != 0)
+	{
+		s_Materials[rHandle.Id] = data;
+		s_MaterialUploaded[rHandle.Id] = true;
+		glBindBuffer(GL_UNIFORM_BUFFER, s_MaterialBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(data), &data);
+	}
+
+	if (s_BoundMaterial != rHandle.Id)
+	{
+		glBindBufferRange(GL_UNIFORM_BUFFER, SCENE_MATERIAL_DATA_BINDING, s_MaterialBuffer, offset, sizeof(SceneMaterialData));
+		s_BoundMaterial = rHandle.Id;
+	}
 }
 
 void begin_render(Scene* rp_Scene, CameraInfo* rpCamera)
 {
 	sp_CurrentScene = rp_Scene;
 	sp_Camera = rpCamera;
-	
+
 	_calculate_view_matrix();
 	_calculate_projection_matrix();
+	_write_frame_data();
 
 	if(rpCamera->BackgroundType == SkyType::Color)
 	{
@@ -48,142 +427,383 @@ void begin_render(Scene* rp_Scene, CameraInfo* rpCamera)
 		renderer_prepare_frame();
 	}
 
-	
-	
-	/*// TODO: all this uniforms should become part of uniform buffers
-	// write all uniforms to shaders
-	LightEnvironment* pLights = &sp_CurrentScene->SceneRenderData.LightEnv;
+	render_queue_clear(&s_RenderQueue);
+	if (rpCamera->BackgroundType == SkyType::Skybox)
+	{
+		DrawPacket sky = {};
+		sky.Pass = RenderPass::Sky;
+		sky.SortKey = render_queue_make_key(RenderPass::Sky, s_SkyboxShader.ShaderProgram, 0, 0.0f);
+		sky.pMesh = sp_Skybox;
+		sky.Batch = RENDER_QUEUE_NO_BATCH;
+		render_queue_add(&s_RenderQueue, sky);
+	}
+}
 
-	for (int i = 0; i < sp_CurrentScene->SceneRenderData.MaterialTable.Materials.size(); i++)
+// Drawn at the far plane (the vertex shader outputs xyww), GL_LEQUAL lets it pass where nothing was drawn
+static void _draw_skybox()
+{
+	gl_state_set_color_write(true);
+	gl_state_set_depth_write(true);
+	gl_state_set_depth_func(GL_LEQUAL);
+	Cubemap &skybox = sp_Camera->Background.Skybox;
+
+	use_shader(&s_SkyboxShader);
+	set_uniform_1i(&s_SkyboxShader, "uSkybox", 0);
+
+	gl_state_bind_texture(0, GL_TEXTURE_CUBE_MAP, skybox.TextureId);
+
+	glm::mat4 view = glm::mat4(glm::mat3(s_ViewMatrix)); 
+	shader_set_view_matrix(&s_SkyboxShader, view);
+	shader_set_projection_matrix(&s_SkyboxShader, s_ProjectionMatrix);
+
+	draw_indexed(sp_Skybox->Vao, sp_Skybox->Ibo, 36, 0);
+
+	gl_state_set_depth_func(GL_LESS);
+}
+
+// Binds the shader, material and depth state of the pass of rPacket, returns the shader
+static Shader* _use_packet_state(const DrawPacket& rPacket)
+{
+	// View, projection, camera and lights come from the blocks written by begin_render
+	Material& mat = *ah_get_material(rPacket.Material);
+	Shader* shader = ah_get_shader(mat.Shader);
+	if (rPacket.Pass == RenderPass::DepthPrepass)
 	{
-		Material* pMaterial = sp_CurrentScene->SceneRenderData.MaterialTable.Materials.at(i);
-		if (pMaterial != nullptr)
-		{
-			Shader* pShader = ah_get_shader(pMaterial->Shader);
-			use_shader(pShader);
-			write_directional_light_to_shader(pShader, pLights->p_DirectionalLight);
-			write_point_light_to_shader(pShader, pLights->p_PointLight);
+		shader = rPacket.pDepthShader;
+		use_shader(shader);
+
+		gl_state_set_color_write(false);
+		gl_state_set_depth_write(true);
+		gl_state_set_depth_func(GL_LESS);
+		return shader;
+	}
+
+	use_shader(shader);
+	_use_material(rPacket.Material, mat);
 
-			write_material_to_shader(pMaterial);
+	use_texture(ah_get_texture(mat.AlbedoMap), 0);
+	gl_state_bind_texture(0, GL_TEXTURE_CUBE_MAP, sp_Camera->Background.Skybox.TextureId);
 
-			set_uniform_vec3(pShader, "uViewPosition", sp_Camera->Position);
-			shader_set_view_matrix(pShader, s_ViewMatrix);
-			shader_set_projection_matrix(pShader, s_ProjectionMatrix);
+	// After the pre-pass only the fragments that wrote the depth buffer are shaded
+	bool prepassed = rPacket.pDepthShader != nullptr;
+	gl_state_set_color_write(true);
+	gl_state_set_depth_write(!prepassed);
+	gl_state_set_depth_func(prepassed ? GL_EQUAL : GL_LESS);
+	return shader;
+}
+
+static void _draw_packet(const DrawPacket& rPacket)
+{
+	Mesh* pMesh = rPacket.pMesh;
+	Shader* shader = _use_packet_state(rPacket);
+	s_DrawStats.DrawCalls++;
+
+	// Instanced shaders read the model matrix and the quantization of the mesh from the instance buffer
+	if (rPacket.Batch != RENDER_QUEUE_NO_BATCH)
+	{
+		// A batch larger than a window is drawn in several parts
+		const RenderBatch& batch = s_RenderQueue.Batches[rPacket.Batch];
+		unsigned int first = batch.FirstInstance;
+		unsigned int end = batch.FirstInstance + batch.InstanceCount;
+		while (first < end)
+		{
+			unsigned int window = _get_instance_window(first);
+			unsigned int count = std::min(end - first, s_MaxWindowInstances - (first - window));
+			_bind_instance_window(window);
+			draw_submesh_instances(*pMesh, pMesh->Submeshes[rPacket.SubmeshIndex], count, first - window);
+			first += count;
 		}
-	}*/
+		return;
+	}
+
+	const SceneUniforms& uniforms = _get_scene_uniforms(shader);
+	set_uniform_int(uniforms.QuantizedVertices, pMesh->Quantized ? 1 : 0);
+	if (pMesh->Quantized)
+	{
+		set_uniform_vec3(uniforms.PositionOffset, pMesh->PositionOffset);
+		set_uniform_vec3(uniforms.PositionScale, pMesh->PositionScale);
+	}
+	shader_set_model_matrix(shader, s_RenderQueue.Transforms[rPacket.TransformIndex]);
+	draw_submesh(*pMesh, pMesh->Submeshes[rPacket.SubmeshIndex]);
+}
+
+static bool _is_indirect(const DrawPacket& rPacket)
+{
+	return rPacket.Pass != RenderPass::Sky && rPacket.Batch != RENDER_QUEUE_NO_BATCH && rPacket.pMesh->HeapAllocation.pPage != nullptr;
+}
+
+static bool _share_indirect_run(const DrawPacket& rFirst, const DrawPacket& rPacket)
+{
+	return _is_indirect(rPacket) && rPacket.Pass == rFirst.Pass && rPacket.Material.Id == rFirst.Material.Id
+		&& rPacket.pDepthShader == rFirst.pDepthShader && rPacket.pMesh->HeapAllocation.pPage == rFirst.pMesh->HeapAllocation.pPage
+		&& rPacket.pMesh->IndexType == rFirst.pMesh->IndexType && rPacket.pMesh->PrimitiveType == rFirst.pMesh->PrimitiveType;
 }
 
-void render_skybox(CameraInfo *pCamera)
+// Splits the sorted packets in runs and writes the commands of the indirect ones
+static void _build_draw_runs()
 {
-	if(pCamera->BackgroundType == SkyType::Skybox)
+	s_DrawRuns.clear();
+	s_DrawCommands.clear();
+
+	const std::vector<DrawPacket>& packets = s_RenderQueue.Packets;
+	for (unsigned int i = 0; i < packets.size(); )
 	{
-		glDepthFunc(GL_LEQUAL);
-		Cubemap &skybox = pCamera->Background.Skybox;
+		SceneDrawRun run = { i, 1, _is_indirect(packets[i]), 0, 0 };
 
-		use_shader(&s_SkyboxShader);
-		set_uniform_1i(&s_SkyboxShader, "uSkybox", 0);
+		// Every batch of the run must fit in the window of its lowest instance, the batches larger than a
+		// window are drawn directly
+		unsigned int runFirst = 0;
+		unsigned int runEnd = 0;
+		if (run.Indirect)
+		{
+			const RenderBatch& firstBatch = s_RenderQueue.Batches[packets[i].Batch];
+			runFirst = firstBatch.FirstInstance;
+			runEnd = firstBatch.FirstInstance + firstBatch.InstanceCount;
+			run.Indirect = runEnd - _get_instance_window(runFirst) <= s_MaxWindowInstances;
+		}
+		if (run.Indirect)
+		{
+			while (i + run.PacketCount < packets.size() && _share_indirect_run(packets[i], packets[i + run.PacketCount]))
+			{
+				const RenderBatch& batch = s_RenderQueue.Batches[packets[i + run.PacketCount].Batch];
+				unsigned int first = std::min(runFirst, batch.FirstInstance);
+				unsigned int end = std::max(runEnd, batch.FirstInstance + batch.InstanceCount);
+				if (end - _get_instance_window(first) > s_MaxWindowInstances)
+				{
+					break;
+				}
+				runFirst = first;
+				runEnd = end;
+				run.PacketCount++;
+			}
+			run.InstanceWindow = _get_instance_window(runFirst);
+
+			run.CommandOffset = s_DrawCommands.size() * sizeof(SceneDrawCommand);
+			for (unsigned int p = i; p < i + run.PacketCount; p++)
+			{
+				const Mesh& mesh = *packets[p].pMesh;
+				const Submesh& submesh = mesh.Submeshes[packets[p].SubmeshIndex];
+				const RenderBatch& batch = s_RenderQueue.Batches[packets[p].Batch];
+				unsigned int indexSize = mesh.IndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+				SceneDrawCommand command;
+				command.Count = submesh.IndexCount;
+				command.InstanceCount = batch.InstanceCount;
+				command.FirstIndex = (unsigned int)(mesh_get_index_byte_offset(mesh) / indexSize) + submesh.StartIndex;
+				command.BaseVertex = mesh_get_base_vertex(mesh);
+				command.BaseInstance = batch.FirstInstance - run.InstanceWindow;
+				s_DrawCommands.push_back(command);
+			}
+		}
+		s_DrawRuns.push_back(run);
+		i += run.PacketCount;
+	}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, skybox.TextureId);
+	if (s_DrawCommands.empty())
+	{
+		return;
+	}
 
-		glm::mat4 view = glm::mat4(glm::mat3(s_ViewMatrix)); 
-		shader_set_view_matrix(&s_SkyboxShader, view);
-		shader_set_projection_matrix(&s_SkyboxShader, s_ProjectionMatrix);
+	// The draws that read the previous segment have been issued by now
+	if (s_IndirectRingPending)
+	{
+		stream_buffer_fence(&s_IndirectRing);
+		s_IndirectRingPending = false;
+	}
 
-		draw_indexed(sp_Skybox->Vao, sp_Skybox->Ibo, 36, 0);
+	GLsizeiptr size = s_DrawCommands.size() * sizeof(SceneDrawCommand);
+	if (size > s_IndirectRing.SegmentSize)
+	{
+		release_stream_buffer(s_IndirectRing);
+		s_IndirectRing = create_stream_buffer(GL_DRAW_INDIRECT_BUFFER, size * 2);
+	}
 
-		glDepthFunc(GL_LESS);
+	void* pCommands = stream_buffer_begin(&s_IndirectRing);
+	memcpy(pCommands, s_DrawCommands.data(), size);
+	GLintptr offset = stream_buffer_end(&s_IndirectRing);
+	for (SceneDrawRun& run : s_DrawRuns)
+	{
+		run.CommandOffset += offset;
 	}
+	s_IndirectRingPending = true;
 }
 
-void end_render()
+static void _draw_indirect_run(const SceneDrawRun& rRun)
 {
-	fb_unbind();
+	const DrawPacket& first = s_RenderQueue.Packets[rRun.FirstPacket];
+	_use_packet_state(first);
+
+	_bind_instance_window(rRun.InstanceWindow);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, s_IndirectRing.Id);
+	gl_state_bind_vertex_array(first.pMesh->Vao.Id);
+	glMultiDrawElementsIndirect(first.pMesh->PrimitiveType, first.pMesh->IndexType, (const void*)rRun.CommandOffset, rRun.PacketCount, 0);
+
+	s_DrawStats.DrawCalls++;
+	s_DrawStats.IndirectCommands += rRun.PacketCount;
 }
 
-void draw_mesh(Mesh* rp_mesh, glm::mat4x4 r_transform, MaterialHandle* r_materials, unsigned int r_matCount)
+void end_render()
 {
-	LightEnvironment* pLights = &sp_CurrentScene->SceneRenderData.LightEnv;
-	for (unsigned int i = 0; i < rp_mesh->SubmeshCount; i++)
+	render_queue_sort(&s_RenderQueue);
+	_write_instance_data();
+	_build_draw_runs();
+	for (const SceneDrawRun& run : s_DrawRuns)
 	{
-		// all rendering stuff
-
-		// TODO: all this uniforms should become part of uniform buffers
-		// to avoid writing same uniforms multiple times
-		assert(r_matCount == 1 || r_matCount == rp_mesh->SubmeshCount, "ERROR::Draw_Mesh - No general material used, expected then same number of materials than submeshes\n");
-		Material& mat = *ah_get_material(r_materials[r_matCount == 1 ? 0 : r_matCount]);
-		Shader* shader = ah_get_shader(mat.Shader);
-		use_shader(shader);
+		const DrawPacket& packet = s_RenderQueue.Packets[run.FirstPacket];
+		if (packet.Pass == RenderPass::Sky)
+		{
+			_draw_skybox();
+			s_DrawStats.DrawCalls++;
+		}
+		else if (run.Indirect)
+		{
+			_draw_indirect_run(run);
+		}
+		else
+		{
+			_draw_packet(packet);
+		}
+	}
 
-		if(pLights->p_DirectionalLight != nullptr)
-			write_directional_light_to_shader(shader, pLights->p_DirectionalLight);
-			
-		if(pLights->p_PointLight != nullptr)	
-		write_point_light_to_shader(shader, pLights->p_PointLight);
+	// Clears are masked by the depth write and color write states
+	gl_state_set_color_write(true);
+	gl_state_set_depth_write(true);
+	gl_state_set_depth_func(GL_LESS);
 
-		write_material_to_shader(&mat);
+	fb_unbind();
+}
 
-		set_uniform_vec3(shader, "uViewPosition", sp_Camera->Position);
-		shader_set_view_matrix(shader, s_ViewMatrix);
-		shader_set_projection_matrix(shader, s_ProjectionMatrix);
+void queue_mesh(Mesh* rp_mesh, glm::mat4x4 r_transform, MaterialHandle* r_materials, unsigned int r_matCount)
+{
+	assert(r_matCount == 1 || r_matCount == rp_mesh->SubmeshCount, "ERROR::Queue_Mesh - No general material used, expected then same number of materials than submeshes\n");
 
-		glActiveTexture(GL_TEXTURE0);
-		use_texture(ah_get_texture(mat.AlbedoMap));
+	// Distance along the view direction of the mesh origin
+	float depth = -(s_ViewMatrix * r_transform[3]).z;
+	unsigned int transformIndex = render_queue_add_transform(&s_RenderQueue, r_transform);
 
-		glBindTexture(GL_TEXTURE_CUBE_MAP, sp_Camera->Background.Skybox.TextureId);  
+	for (unsigned int i = 0; i < rp_mesh->SubmeshCount; i++)
+	{
+		DrawPacket packet;
+		packet.Pass = RenderPass::Opaque;
+		packet.pMesh = rp_mesh;
+		packet.SubmeshIndex = i;
+		packet.Material = r_materials[r_matCount == 1 ? 0 : i];
+		packet.TransformIndex = transformIndex;
+		packet.Batch = RENDER_QUEUE_NO_BATCH;
+		packet.pDepthShader = nullptr;
+
+		// Instanced shaders get one set of packets per batch, the following draws only add an instance to it
+		Shader* shader = ah_get_shader(ah_get_material(packet.Material)->Shader);
+		if (_get_scene_uniforms(shader).Instanced)
+		{
+			bool created = false;
+			packet.Batch = render_queue_get_batch(&s_RenderQueue, rp_mesh, i, packet.Material, &created);
+			render_queue_add_instance(&s_RenderQueue, packet.Batch, transformIndex, depth);
+			if (!created)
+			{
+				continue;
+			}
+		}
 
-		shader_set_model_matrix(shader, r_transform);
+		auto depthShader = s_DepthPrepass ? s_DepthShaders.find(packet.Material.Id) : s_DepthShaders.end();
+		if (depthShader != s_DepthShaders.end())
+		{
+			DrawPacket prepass = packet;
+			prepass.Pass = RenderPass::DepthPrepass;
+			prepass.pDepthShader = depthShader->second;
+			prepass.SortKey = render_queue_make_key(RenderPass::DepthPrepass, prepass.pDepthShader->ShaderProgram, packet.Material.Id, depth);
+			render_queue_add(&s_RenderQueue, prepass);
+			packet.pDepthShader = depthShader->second;
+		}
 
-		draw_indexed(rp_mesh->Vao, rp_mesh->Ibo, rp_mesh->Submeshes[i].IndexCount, rp_mesh->Submeshes[i].StartIndex);
+		packet.SortKey = render_queue_make_key(RenderPass::Opaque, shader->ShaderProgram, packet.Material.Id, depth);
+		render_queue_add(&s_RenderQueue, packet);
 	}
-	
 }
 
 
-static void _calculate_view_matrix()
+SceneDrawStats scene_renderer_get_draw_stats()
 {
-	s_ViewMatrix = glm::mat4(1.0f);
-	s_ViewMatrix = glm::rotate(s_ViewMatrix, glm::radians(sp_Camera->Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-	s_ViewMatrix = glm::rotate(s_ViewMatrix, glm::radians(sp_Camera->Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-	s_ViewMatrix = glm::rotate(s_ViewMatrix, glm::radians(sp_Camera->Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-	s_ViewMatrix = glm::translate(s_ViewMatrix, -sp_Camera->Position);
+	return s_DrawStats;
 }
 
-static void _calculate_projection_matrix()
+void scene_renderer_reset_draw_stats()
 {
-	const RenderData& renderData = get_renderer_data();
-	if (sp_Camera != nullptr && renderData.ViewportSizePx != glm::vec2(0, 0))
+	s_DrawStats = {};
+}
+
+void scene_renderer_set_material_depth_shader(MaterialHandle rMaterial, Shader* rpDepthShader)
+{
+	Shader* pShader = ah_get_shader(ah_get_material(rMaterial)->Shader);
+	shader_set_mirror(pShader, rpDepthShader);
+	if (rpDepthShader == nullptr)
 	{
-		s_ProjectionMatrix = glm::perspective(glm::radians(sp_Camera->Fov),
-			renderData.ViewportSizePx.x / renderData.ViewportSizePx.y,
-			sp_Camera->NearPlane,
-			sp_Camera->FarPlane);
+		s_DepthShaders.erase(rMaterial.Id);
+		return;
 	}
+	s_DepthShaders[rMaterial.Id] = rpDepthShader;
 }
 
-void write_point_light_to_shader(Shader* rpShader, PointLight* rp_Light)
+void scene_renderer_set_depth_prepass(bool rEnabled)
 {
-	set_uniform_vec3(rpShader, "uPointLight.AmbientColor", rp_Light->AmbientColor);
-	set_uniform_vec3(rpShader, "uPointLight.DiffuseColor", rp_Light->DiffuseColor);
-	set_uniform_vec3(rpShader, "uPointLight.SpecularColor", rp_Light->SpecularColor);
-	set_uniform_vec3(rpShader, "uPointLight.Position", rp_Light->Position);
-	set_uniform_float(rpShader, "uPointLight.Constant", rp_Light->Constant);
-	set_uniform_float(rpShader, "uPointLight.Linear", rp_Light->Linear);
-	set_uniform_float(rpShader, "uPointLight.Quadratic", rp_Light->Quadratic);
+	s_DepthPrepass = rEnabled;
 }
-void write_directional_light_to_shader(Shader* rpShader, DirectionalLight* rp_Light)
+
+bool scene_renderer_is_depth_prepass_enabled()
 {
-	set_uniform_vec3(rpShader, "uDirectionalLight.AmbientColor", rp_Light->AmbientColor);
-	set_uniform_vec3(rpShader, "uDirectionalLight.DiffuseColor", rp_Light->DiffuseColor);
-	set_uniform_vec3(rpShader, "uDirectionalLight.SpecularColor", rp_Light->SpecularColor);
-	set_uniform_vec3(rpShader, "uDirectionalLight.Direction", rp_Light->Direction);
+	return s_DepthPrepass;
 }
 
-void write_material_to_shader(Material* rp_material)
+void scene_renderer_depth_prepass_benchmark(unsigned int rFrameCount, const std::function<void()>& rRenderFrame)
 {
-	Shader* shader = ah_get_shader(rp_material->Shader);
-	set_uniform_vec3(shader, "uMaterial.Ambient", rp_material->Ambient);
-	set_uniform_vec3(shader, "uMaterial.Specular", rp_material->Specular);
-	set_uniform_vec3(shader, "uMaterial.Diffuse", rp_material->Diffuse);
-	set_uniform_float(shader, "uMaterial.Shininess", rp_material->Shininess);
-}
\ No newline at end of file
+	const bool previous = s_DepthPrepass;
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	std::cout << "SCENE_RENDERER::DEPTH_PREPASS::BENCHMARK - " << viewport[2] << "x" << viewport[3] << ", "
+		<< rFrameCount << " frames per mode" << std::endl;
+
+	GpuTimer timer = create_gpu_timer();
+	double modeMs[2] = {};
+	const char* modeNames[2] = { "single pass", "depth pre-pass" };
+	for (int mode = 0; mode < 2; mode++)
+	{
+		s_DepthPrepass = mode == 1;
+
+		// Not measured, compiles and copies what the first frame of the mode needs
+		rRenderFrame();
+
+		double gpuMs = 0.0;
+		for (unsigned int i = 0; i < rFrameCount; i++)
+		{
+			gpu_timer_begin(&timer);
+			rRenderFrame();
+			gpu_timer_end(&timer);
+			gpuMs += gpu_timer_get_ms(&timer);
+		}
+		modeMs[mode] = gpuMs / std::max(rFrameCount, 1u);
+		std::cout << "  " << modeNames[mode] << ": " << modeMs[mode] << " ms GPU" << std::endl;
+	}
+	release_gpu_timer(timer);
+
+	if (modeMs[1] > 0.0)
+	{
+		std::cout << "  speedup: " << modeMs[0] / modeMs[1] << "x" << std::endl;
+	}
+
+	s_DepthPrepass = previous;
+}
+
+static void _calculate_view_matrix()
+{
+	s_ViewMatrix = camera_get_view_matrix(sp_Camera);
+}
+
+static void _calculate_projection_matrix()
+{
+	const RenderData& renderData = get_renderer_data();
+	if (sp_Camera != nullptr && renderData.ViewportSizePx != glm::vec2(0, 0))
+	{
+		s_ProjectionMatrix = camera_get_projection_matrix(sp_Camera, renderData.ViewportSizePx.x / renderData.ViewportSizePx.y);
+	}
+}
@@ -1,6 +1,7 @@
 #ifndef SCENE_RENDERER_H
 #define SCENE_RENDERER_H
 
+#include <functional>
 #include "renderer.h"
 #include "camera.h"
 #include "data/mesh.h"
@@ -8,22 +9,66 @@
 #include "light/directional_light.h"
 #include "../scene/scene.h"
 
+// Uniform block bindings. Must match res/shaders/frame_data.glsl, lights.glsl and basic_material.glsl.
+// FrameData and LightData are streamed once per camera and frame, MaterialData is written when a material changes
+#define SCENE_FRAME_DATA_BINDING 0
+#define SCENE_LIGHT_DATA_BINDING 1
+#define SCENE_MATERIAL_DATA_BINDING 2
+
+// Shader storage binding of the instance model matrices. Must match transforms.glsl
+#define SCENE_INSTANCE_DATA_BINDING 3
+
+// Draw calls issued by end_render since the last scene_renderer_reset_draw_stats. A glMultiDrawElementsIndirect
+// counts as one call, its commands are counted in IndirectCommands
+typedef struct
+{
+	unsigned int DrawCalls;
+	unsigned int IndirectCommands;
+} SceneDrawStats;
+
 void init_scene_renderer(Mesh *pSkybox);
 
+/// <summary>
+/// Starts the draws of rpCamera. Its skybox, if any, is queued to be drawn after the meshes
+/// </summary>
 void begin_render(Scene* rp_Scene, CameraInfo* rpCamera);
+
+/// <summary>
+/// Sorts and draws the queued meshes of the camera, then unbinds its render target
+/// </summary>
 void end_render();
 
-void render_skybox(CameraInfo* pCamera);
+/// <summary>
+/// Queues a draw per submesh, drawn by end_render grouped by shader and material and front to back.
+/// Submeshes whose shader is SCENE_INSTANCED are drawn once for every mesh queued with the same material, those of
+/// meshes in the geometry heap in a single glMultiDrawElementsIndirect per material
+/// </summary>
+void queue_mesh(Mesh* rp_mesh, glm::mat4x4 r_transform, MaterialHandle* r_materials, unsigned int r_matCount);
 
-void draw_mesh(Mesh* rp_mesh, glm::mat4x4 r_transform, MaterialHandle* r_materials, unsigned int r_matCount);
+SceneDrawStats scene_renderer_get_draw_stats();
+void scene_renderer_reset_draw_stats();
 
-static void _calculate_view_matrix();
-static void _calculate_projection_matrix();
+/// <summary>
+/// Gives rMaterial a depth pre-pass drawn with rpDepthShader, nullptr removes it. rpDepthShader must compute the exact
+/// same positions as the material shader (invariant gl_Position), and be SCENE_INSTANCED if the material shader is.
+/// The material shader mirrors its uniform writes to it from now on (shader_set_mirror)
+/// </summary>
+void scene_renderer_set_material_depth_shader(MaterialHandle rMaterial, Shader* rpDepthShader);
+
+/// <summary>
+/// When enabled, the materials with a depth shader are drawn depth only first, then shaded with GL_EQUAL depth testing
+/// </summary>
+void scene_renderer_set_depth_prepass(bool rEnabled);
+bool scene_renderer_is_depth_prepass_enabled();
 
-void write_point_light_to_shader(Shader* rpShader, PointLight* rp_Light);
-void write_directional_light_to_shader(Shader* rpShader, DirectionalLight* rp_Light);
+/// <summary>
+/// Renders rFrameCount frames without and with the depth pre-pass, printing the GPU time of both.
+/// rRenderFrame must draw a full frame without swapping buffers
+/// </summary>
+void scene_renderer_depth_prepass_benchmark(unsigned int rFrameCount, const std::function<void()>& rRenderFrame);
 
-void write_material_to_shader(Material* rp_material);
+static void _calculate_view_matrix();
+static void _calculate_projection_matrix();
 
 #endif // !SCENE_RENDERER_H
 
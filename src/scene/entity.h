@@ -10,6 +10,8 @@ typedef struct
 	ModelHandle ModelHandle;
 } EntityRenderData;
 
+// Transform and render data of an entity. Entities are created from it and then live in the
+// SoA arrays of the EntityRegistry
 typedef struct
 {
 	glm::vec3 Position;
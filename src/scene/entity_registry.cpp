@@ -0,0 +1,312 @@
+#include "entity_registry.h"
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include "../core/job_system.h"
+#include "../core/ErrorHandler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENTITY_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Matrices composed per batch, and dirty entities per job range
+#define ENTITY_MATRIX_BATCH 4
+#define ENTITY_MATRIX_GRAIN 1024
+
+#define ENTITY_DEG_TO_RAD 0.017453292519943295f
+
+void entity_registry_init(EntityRegistry* rpRegistry)
+{
+	*rpRegistry = EntityRegistry{};
+	rpRegistry->AliveCount = 0;
+}
+
+static inline void _set_dirty(EntityRegistry* rpRegistry, unsigned int rSlot)
+{
+	rpRegistry->DirtyBits[rSlot >> 6] |= (uint64_t)1 << (rSlot & 63);
+}
+
+static inline void _clear_dirty(EntityRegistry* rpRegistry, unsigned int rSlot)
+{
+	rpRegistry->DirtyBits[rSlot >> 6] &= ~((uint64_t)1 << (rSlot & 63));
+}
+
+static inline unsigned int _lowest_bit(uint64_t rBits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, rBits);
+	return (unsigned int)index;
+#else
+	return (unsigned int)__builtin_ctzll(rBits);
+#endif
+}
+
+static unsigned int _grow_slots(EntityRegistry* rpRegistry)
+{
+	unsigned int slot = (unsigned int)rpRegistry->Generations.size();
+	unsigned int count = slot + 1;
+
+	rpRegistry->PositionX.resize(count);
+	rpRegistry->PositionY.resize(count);
+	rpRegistry->PositionZ.resize(count);
+	rpRegistry->RotationX.resize(count);
+	rpRegistry->RotationY.resize(count);
+	rpRegistry->RotationZ.resize(count);
+	rpRegistry->ScaleX.resize(count);
+	rpRegistry->ScaleY.resize(count);
+	rpRegistry->ScaleZ.resize(count);
+	rpRegistry->RenderData.resize(count);
+	rpRegistry->WorldMatrices.resize(count, glm::mat4(1.0f));
+	rpRegistry->Generations.resize(count, 0);
+	rpRegistry->Alive.resize(count, 0);
+	rpRegistry->DirtyBits.resize((count + 63) / 64, 0);
+
+	return slot;
+}
+
+EntityHandle entity_registry_create(EntityRegistry* rpRegistry, const Entity& rEntity)
+{
+	unsigned int slot;
+	if (!rpRegistry->FreeSlots.empty())
+	{
+		slot = rpRegistry->FreeSlots.back();
+		rpRegistry->FreeSlots.pop_back();
+	}
+	else
+	{
+		slot = _grow_slots(rpRegistry);
+	}
+
+	rpRegistry->PositionX[slot] = rEntity.Position.x;
+	rpRegistry->PositionY[slot] = rEntity.Position.y;
+	rpRegistry->PositionZ[slot] = rEntity.Position.z;
+	rpRegistry->RotationX[slot] = rEntity.Rotation.x;
+	rpRegistry->RotationY[slot] = rEntity.Rotation.y;
+	rpRegistry->RotationZ[slot] = rEntity.Rotation.z;
+	rpRegistry->ScaleX[slot] = rEntity.Scale.x;
+	rpRegistry->ScaleY[slot] = rEntity.Scale.y;
+	rpRegistry->ScaleZ[slot] = rEntity.Scale.z;
+	rpRegistry->RenderData[slot] = rEntity.meshRendererData;
+	rpRegistry->Alive[slot] = 1;
+	rpRegistry->AliveCount++;
+	_set_dirty(rpRegistry, slot);
+
+	return EntityHandle{ slot, rpRegistry->Generations[slot] };
+}
+
+bool entity_registry_is_valid(const EntityRegistry* rpRegistry, EntityHandle rHandle)
+{
+	return rHandle.Id < rpRegistry->Generations.size()
+		&& rpRegistry->Alive[rHandle.Id]
+		&& rpRegistry->Generations[rHandle.Id] == rHandle.GenerationId;
+}
+
+void entity_registry_destroy(EntityRegistry* rpRegistry, EntityHandle rHandle)
+{
+	if (!entity_registry_is_valid(rpRegistry, rHandle))
+	{
+		THROW_ERROR("ERROR::entity_registry_destroy - Trying to destroy a non existent entity");
+		return;
+	}
+
+	rpRegistry->Alive[rHandle.Id] = 0;
+	rpRegistry->Generations[rHandle.Id]++;
+	rpRegistry->AliveCount--;
+	_clear_dirty(rpRegistry, rHandle.Id);
+	rpRegistry->FreeSlots.push_back(rHandle.Id);
+}
+
+Entity entity_registry_get(const EntityRegistry* rpRegistry, EntityHandle rHandle)
+{
+	unsigned int slot = rHandle.Id;
+
+	Entity entity;
+	entity.Position = glm::vec3(rpRegistry->PositionX[slot], rpRegistry->PositionY[slot], rpRegistry->PositionZ[slot]);
+	entity.Rotation = glm::vec3(rpRegistry->RotationX[slot], rpRegistry->RotationY[slot], rpRegistry->RotationZ[slot]);
+	entity.Scale = glm::vec3(rpRegistry->ScaleX[slot], rpRegistry->ScaleY[slot], rpRegistry->ScaleZ[slot]);
+	entity.meshRendererData = rpRegistry->RenderData[slot];
+	return entity;
+}
+
+void entity_registry_set_position(EntityRegistry* rpRegistry, EntityHandle rHandle, const glm::vec3& rPosition)
+{
+	unsigned int slot = rHandle.Id;
+	rpRegistry->PositionX[slot] = rPosition.x;
+	rpRegistry->PositionY[slot] = rPosition.y;
+	rpRegistry->PositionZ[slot] = rPosition.z;
+	_set_dirty(rpRegistry, slot);
+}
+
+void entity_registry_set_rotation(EntityRegistry* rpRegistry, EntityHandle rHandle, const glm::vec3& rRotation)
+{
+	unsigned int slot = rHandle.Id;
+	rpRegistry->RotationX[slot] = rRotation.x;
+	rpRegistry->RotationY[slot] = rRotation.y;
+	rpRegistry->RotationZ[slot] = rRotation.z;
+	_set_dirty(rpRegistry, slot);
+}
+
+void entity_registry_set_scale(EntityRegistry* rpRegistry, EntityHandle rHandle, const glm::vec3& rScale)
+{
+	unsigned int slot = rHandle.Id;
+	rpRegistry->ScaleX[slot] = rScale.x;
+	rpRegistry->ScaleY[slot] = rScale.y;
+	rpRegistry->ScaleZ[slot] = rScale.z;
+	_set_dirty(rpRegistry, slot);
+}
+
+// World matrix = T * Rx * Ry * Rz * S, the same as translating, rotating around X, Y, Z and scaling with glm.
+// The columns of R = Rx * Ry * Rz are written out so the batch kernel needs no matrix products:
+//   col0 = ( cy*cz,  sx*sy*cz + cx*sz, -cx*sy*cz + sx*sz)
+//   col1 = (-cy*sz, -sx*sy*sz + cx*cz,  cx*sy*sz + sx*cz)
+//   col2 = ( sy,    -sx*cy,             cx*cy)
+typedef struct
+{
+	float Sx[ENTITY_MATRIX_BATCH], Cx[ENTITY_MATRIX_BATCH];
+	float Sy[ENTITY_MATRIX_BATCH], Cy[ENTITY_MATRIX_BATCH];
+	float Sz[ENTITY_MATRIX_BATCH], Cz[ENTITY_MATRIX_BATCH];
+	float ScaleX[ENTITY_MATRIX_BATCH], ScaleY[ENTITY_MATRIX_BATCH], ScaleZ[ENTITY_MATRIX_BATCH];
+	float PositionX[ENTITY_MATRIX_BATCH], PositionY[ENTITY_MATRIX_BATCH], PositionZ[ENTITY_MATRIX_BATCH];
+} _TransformBatch;
+
+static void _gather_batch(const EntityRegistry* rpRegistry, const unsigned int* rpSlots, unsigned int rCount, _TransformBatch* rpBatch)
+{
+	for (unsigned int i = 0; i < ENTITY_MATRIX_BATCH; i++)
+	{
+		// Unused lanes repeat the last entity, their result is not stored
+		unsigned int slot = rpSlots[i < rCount ? i : rCount - 1];
+		float x = rpRegistry->RotationX[slot] * ENTITY_DEG_TO_RAD;
+		float y = rpRegistry->RotationY[slot] * ENTITY_DEG_TO_RAD;
+		float z = rpRegistry->RotationZ[slot] * ENTITY_DEG_TO_RAD;
+		rpBatch->Sx[i] = sinf(x); rpBatch->Cx[i] = cosf(x);
+		rpBatch->Sy[i] = sinf(y); rpBatch->Cy[i] = cosf(y);
+		rpBatch->Sz[i] = sinf(z); rpBatch->Cz[i] = cosf(z);
+		rpBatch->ScaleX[i] = rpRegistry->ScaleX[slot];
+		rpBatch->ScaleY[i] = rpRegistry->ScaleY[slot];
+		rpBatch->ScaleZ[i] = rpRegistry->ScaleZ[slot];
+		rpBatch->PositionX[i] = rpRegistry->PositionX[slot];
+		rpBatch->PositionY[i] = rpRegistry->PositionY[slot];
+		rpBatch->PositionZ[i] = rpRegistry->PositionZ[slot];
+	}
+}
+
+#ifdef ENTITY_SIMD_SSE2
+static void _compose_batch(const _TransformBatch& rBatch, glm::mat4* rpOut[ENTITY_MATRIX_BATCH], unsigned int rCount)
+{
+	__m128 sx = _mm_loadu_ps(rBatch.Sx), cx = _mm_loadu_ps(rBatch.Cx);
+	__m128 sy = _mm_loadu_ps(rBatch.Sy), cy = _mm_loadu_ps(rBatch.Cy);
+	__m128 sz = _mm_loadu_ps(rBatch.Sz), cz = _mm_loadu_ps(rBatch.Cz);
+	__m128 scaleX = _mm_loadu_ps(rBatch.ScaleX);
+	__m128 scaleY = _mm_loadu_ps(rBatch.ScaleY);
+	__m128 scaleZ = _mm_loadu_ps(rBatch.ScaleZ);
+
+	__m128 sxsy = _mm_mul_ps(sx, sy);
+	__m128 cxsy = _mm_mul_ps(cx, sy);
+
+	// One register per matrix element, one lane per entity
+	__m128 m[4][4];
+	m[0][0] = _mm_mul_ps(_mm_mul_ps(cy, cz), scaleX);
+	m[0][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sxsy, cz), _mm_mul_ps(cx, sz)), scaleX);
+	m[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sx, sz), _mm_mul_ps(cxsy, cz)), scaleX);
+	m[0][3] = _mm_setzero_ps();
+
+	m[1][0] = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(cy, sz)), scaleY);
+	m[1][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cx, cz), _mm_mul_ps(sxsy, sz)), scaleY);
+	m[1][2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cxsy, sz), _mm_mul_ps(sx, cz)), scaleY);
+	m[1][3] = _mm_setzero_ps();
+
+	m[2][0] = _mm_mul_ps(sy, scaleZ);
+	m[2][1] = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sx, cy)), scaleZ);
+	m[2][2] = _mm_mul_ps(_mm_mul_ps(cx, cy), scaleZ);
+	m[2][3] = _mm_setzero_ps();
+
+	m[3][0] = _mm_loadu_ps(rBatch.PositionX);
+	m[3][1] = _mm_loadu_ps(rBatch.PositionY);
+	m[3][2] = _mm_loadu_ps(rBatch.PositionZ);
+	m[3][3] = _mm_set1_ps(1.0f);
+
+	// Transposing the four elements of a column gives that column for each entity
+	for (int c = 0; c < 4; c++)
+	{
+		_MM_TRANSPOSE4_PS(m[c][0], m[c][1], m[c][2], m[c][3]);
+		for (unsigned int i = 0; i < rCount; i++)
+		{
+			_mm_storeu_ps(&(*rpOut[i])[c][0], m[c][i]);
+		}
+	}
+}
+#else
+static void _compose_batch(const _TransformBatch& rBatch, glm::mat4* rpOut[ENTITY_MATRIX_BATCH], unsigned int rCount)
+{
+	for (unsigned int i = 0; i < rCount; i++)
+	{
+		float sx = rBatch.Sx[i], cx = rBatch.Cx[i];
+		float sy = rBatch.Sy[i], cy = rBatch.Cy[i];
+		float sz = rBatch.Sz[i], cz = rBatch.Cz[i];
+
+		glm::mat4& m = *rpOut[i];
+		m[0] = glm::vec4(cy * cz, sx * sy * cz + cx * sz, sx * sz - cx * sy * cz, 0.0f) * rBatch.ScaleX[i];
+		m[1] = glm::vec4(-cy * sz, cx * cz - sx * sy * sz, cx * sy * sz + sx * cz, 0.0f) * rBatch.ScaleY[i];
+		m[2] = glm::vec4(sy, -sx * cy, cx * cy, 0.0f) * rBatch.ScaleZ[i];
+		m[3] = glm::vec4(rBatch.PositionX[i], rBatch.PositionY[i], rBatch.PositionZ[i], 1.0f);
+	}
+}
+#endif
+
+static void _compose_range(EntityRegistry* rpRegistry, unsigned int rBegin, unsigned int rEnd)
+{
+	const unsigned int* pSlots = rpRegistry->DirtySlots.data();
+	_TransformBatch batch;
+	glm::mat4* pOut[ENTITY_MATRIX_BATCH];
+
+	for (unsigned int i = rBegin; i < rEnd; i += ENTITY_MATRIX_BATCH)
+	{
+		unsigned int count = rEnd - i < ENTITY_MATRIX_BATCH ? rEnd - i : ENTITY_MATRIX_BATCH;
+		for (unsigned int j = 0; j < count; j++)
+		{
+			pOut[j] = &rpRegistry->WorldMatrices[pSlots[i + j]];
+		}
+
+		_gather_batch(rpRegistry, pSlots + i, count, &batch);
+		_compose_batch(batch, pOut, count);
+	}
+}
+
+unsigned int entity_registry_update_world_matrices(EntityRegistry* rpRegistry)
+{
+	std::vector<unsigned int>& dirtySlots = rpRegistry->DirtySlots;
+	dirtySlots.clear();
+
+	// Whole clean words are skipped, so static entities cost one test per 64 of them
+	for (unsigned int w = 0; w < (unsigned int)rpRegistry->DirtyBits.size(); w++)
+	{
+		uint64_t bits = rpRegistry->DirtyBits[w];
+		while (bits != 0)
+		{
+			dirtySlots.push_back(w * 64 + _lowest_bit(bits));
+			bits &= bits - 1;
+		}
+		rpRegistry->DirtyBits[w] = 0;
+	}
+
+	unsigned int count = (unsigned int)dirtySlots.size();
+	if (count <= ENTITY_MATRIX_GRAIN)
+	{
+		_compose_range(rpRegistry, 0, count);
+	}
+	else
+	{
+		job_parallel_for(count, ENTITY_MATRIX_GRAIN, [rpRegistry](unsigned int rBegin, unsigned int rEnd)
+		{
+			_compose_range(rpRegistry, rBegin, rEnd);
+		});
+	}
+
+	return count;
+}
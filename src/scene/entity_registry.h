@@ -0,0 +1,82 @@
+#ifndef ENTITY_REGISTRY_H
+#define ENTITY_REGISTRY_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include "entity.h"
+
+// Entity registry: every component lives in its own array (SoA) indexed by the entity slot.
+// Slots are recycled through a free list, the generation of a slot is bumped when it is
+// destroyed so stale handles are detected. The world matrix of an entity is cached and only
+// recomputed, in batches, for the entities whose transform changed since the last update.
+
+typedef struct
+{
+	unsigned int Id;
+	unsigned int GenerationId;
+} EntityHandle;
+
+typedef struct
+{
+	// Transform, Rotation in euler degrees applied X, then Y, then Z
+	std::vector<float> PositionX;
+	std::vector<float> PositionY;
+	std::vector<float> PositionZ;
+	std::vector<float> RotationX;
+	std::vector<float> RotationY;
+	std::vector<float> RotationZ;
+	std::vector<float> ScaleX;
+	std::vector<float> ScaleY;
+	std::vector<float> ScaleZ;
+
+	std::vector<EntityRenderData> RenderData;
+	std::vector<glm::mat4> WorldMatrices;
+
+	std::vector<unsigned int> Generations;
+	std::vector<uint8_t> Alive;
+	std::vector<uint64_t> DirtyBits;	// One bit per slot
+
+	std::vector<unsigned int> FreeSlots;
+	unsigned int AliveCount;
+
+	// Scratch list of the slots recomputed on the last update
+	std::vector<unsigned int> DirtySlots;
+} EntityRegistry;
+
+void entity_registry_init(EntityRegistry* rpRegistry);
+
+/// <summary>
+/// Creates an entity with the transform and render data of rEntity
+/// </summary>
+EntityHandle entity_registry_create(EntityRegistry* rpRegistry, const Entity& rEntity);
+
+void entity_registry_destroy(EntityRegistry* rpRegistry, EntityHandle rHandle);
+
+bool entity_registry_is_valid(const EntityRegistry* rpRegistry, EntityHandle rHandle);
+
+/// <summary>
+/// Returns a copy of the transform and render data of the entity
+/// </summary>
+Entity entity_registry_get(const EntityRegistry* rpRegistry, EntityHandle rHandle);
+
+void entity_registry_set_position(EntityRegistry* rpRegistry, EntityHandle rHandle, const glm::vec3& rPosition);
+void entity_registry_set_rotation(EntityRegistry* rpRegistry, EntityHandle rHandle, const glm::vec3& rRotation);
+void entity_registry_set_scale(EntityRegistry* rpRegistry, EntityHandle rHandle, const glm::vec3& rScale);
+
+/// <summary>
+/// Recomputes the world matrix of every dirty entity and clears the dirty bits
+/// </summary>
+/// <returns>Number of matrices recomputed</returns>
+unsigned int entity_registry_update_world_matrices(EntityRegistry* rpRegistry);
+
+/// <summary>
+/// Number of slots, alive or not. Slots below this can be tested with Alive
+/// </summary>
+inline unsigned int entity_registry_get_slot_count(const EntityRegistry* rpRegistry)
+{
+	return (unsigned int)rpRegistry->Generations.size();
+}
+
+#endif // !ENTITY_REGISTRY_H
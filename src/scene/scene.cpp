@@ -6,10 +6,7 @@
 
 void init_scene(Scene* rpScene)
 {
-	for (int i = 0; i < MAX_ENTITIES; i++)
-	{
-		rpScene->Entities[i] = NULL;
-	}
+	entity_registry_init(&rpScene->Entities);
 
 	for (int i = 0; i < MAX_CAMERAS; i++)
 	{
@@ -74,27 +71,22 @@ void scene_update(Scene* rpScene)
 
 void scene_render(Scene* rpScene)
 {
+	// Only the entities moved since the last frame get a new world matrix
+	EntityRegistry* pEntities = &rpScene->Entities;
+	entity_registry_update_world_matrices(pEntities);
+
+	const unsigned int slotCount = entity_registry_get_slot_count(pEntities);
 	for (size_t i = 0; i < MAX_CAMERAS; i++)
 	{
 		if (rpScene->Cameras[i] != nullptr)
 		{
 			begin_render(rpScene, rpScene->Cameras[i]);
-			render_skybox(rpScene->Cameras[i]);
-			for (int i = 0; i < MAX_ENTITIES; i++)
+			for (unsigned int e = 0; e < slotCount; e++)
 			{
-				Entity* entity = rpScene->Entities[i];
-				if (entity != NULL)
+				if (pEntities->Alive[e])
 				{
-					glm::mat4 transform = glm::mat4(1.0f);
-					transform = glm::translate(transform, entity->Position);
-					transform = glm::rotate(transform, glm::radians(entity->Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-					transform = glm::rotate(transform, glm::radians(entity->Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-					transform = glm::rotate(transform, glm::radians(entity->Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-					transform = glm::scale(transform, entity->Scale);
-
-
-					Model* model = ah_get_model(entity->meshRendererData.ModelHandle);
-					draw_mesh(model->p_Mesh, transform, model->p_MaterialHandles, model->MaterialCount);
+					Model* model = ah_get_model(pEntities->RenderData[e].ModelHandle);
+					queue_mesh(model->p_Mesh, pEntities->WorldMatrices[e], model->p_MaterialHandles, model->MaterialCount);
 				}
 			}
 
@@ -105,17 +97,14 @@ void scene_render(Scene* rpScene)
 	}
 }
 
-void instantiate_entity(Scene* rp_scene, Entity* entity)
+EntityHandle instantiate_entity(Scene* rp_scene, const Entity& rEntity)
 {
-	// add entity to list of entities
-	for (int i = 0; i < MAX_ENTITIES; i++)
-	{
-		if (rp_scene->Entities[i] == NULL)
-		{
-			rp_scene->Entities[i] = entity;
-			break;
-		}
-	}
+	return entity_registry_create(&rp_scene->Entities, rEntity);
+}
+
+void destroy_entity(Scene* rp_scene, EntityHandle rHandle)
+{
+	entity_registry_destroy(&rp_scene->Entities, rHandle);
 }
 
 
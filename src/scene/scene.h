@@ -3,11 +3,10 @@
 
 #include <string>
 #include "../renderer/camera.h"
-#include "entity.h"
+#include "entity_registry.h"
 #include "../renderer/light/directional_light.h"
 #include "../renderer/light/point_light.h"
 
-#define MAX_ENTITIES 10
 #define MAX_CAMERAS 10
 
 typedef struct
@@ -29,10 +28,7 @@ typedef struct {
 
 	unsigned int MainCamera;
 	unsigned int NumberOfCameras;
-	// TODO: change way to store entities
-	Entity* Entities[MAX_ENTITIES];
-	int NumberOfEntities;
-	// ^^^
+	EntityRegistry Entities;
 	CameraInfo* Cameras[MAX_CAMERAS];
 } Scene;
 
@@ -48,7 +44,12 @@ void scene_update(Scene* rpScene);
 
 void scene_render(Scene* rpScene);
 
-void instantiate_entity(Scene* rp_scene, Entity* entity);
+/// <summary>
+/// Creates an entity with the transform and render data of rEntity. The entity is copied into the scene
+/// </summary>
+EntityHandle instantiate_entity(Scene* rp_scene, const Entity& rEntity);
+
+void destroy_entity(Scene* rp_scene, EntityHandle rHandle);
 
 void add_directional_light(Scene* rp_scene, DirectionalLight* rp_light);
 void add_point_light(Scene* rp_scene, PointLight* rp_light);